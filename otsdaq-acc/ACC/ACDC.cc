@@ -1,4 +1,6 @@
 #include "ACDC.h"
+#include "AccPacket.h"
+#include "SampleUnpacker.h"
 #include "otsdaq/ConfigurationInterface/ConfigurationTree.h"
 
 #include <bitset>
@@ -8,13 +10,14 @@
 #include <iomanip>
 #include <numeric>
 #include <ctime>
+#include <algorithm>
 
 using namespace std;
 
 
-ACDC::ACDC() : boardIndex(-1), nEvents_(0) {}
+ACDC::ACDC() : boardIndex(-1), outputMode(RAW_COUNTS), nEvents_(0), nSamples_(0) {}
 
-ACDC::ACDC(int bi) : boardIndex(bi), nEvents_(0) {}
+ACDC::ACDC(int bi) : boardIndex(bi), outputMode(RAW_COUNTS), nEvents_(0), nSamples_(0) {}
 
 ACDC::~ACDC()
 {
@@ -60,75 +63,61 @@ void ACDC::parseConfig(const ots::ConfigurationTree& config)
 }
 
 //looks at the last ACDC buffer and organizes
-//all of the data into a data map. The boolean
-//argument toggles whether you want to subtract
-//pedestals and convert ADC-counts to mV live
-//or keep the data in units of raw ADC counts. 
-//retval:  ... 1 and 2 are never returned ... 
-//2: other error
-//1: corrupt buffer 
-//0: all good
-int ACDC::parseDataFromBuffer(const vector<uint64_t>& buffer)
+//all of the data into a data map. The output
+//mode (setOutputMode) toggles whether you also want
+//pedestal subtracted mV or ADC-counts live
+//or keep the data in units of raw ADC counts.
+//Runs on the decode workers for every event, so it
+//reports problems only through the return value.
+//retval:
+//1: unexpected event length, the samples present are
+//   decoded and the missing ones set to 0
+//0: all good, an event as the ACC sends it or a complete readout
+//-1: empty buffer
+//-2: corrupt buffer header
+int ACDC::parseDataFromBuffer(span<const uint64_t> buffer)
 {
     //Catch empty buffers
-    if(buffer.size() == 0)
-    {
-        std::cout << "You tried to parse ACDC data without pulling/setting an ACDC buffer" << std::endl;
-        return -1;
-    }
-
-    //clear the data map prior.
-    data.clear();
+    nSamples_ = 0;
+    if(buffer.size() == 0) return -1;
 
     //check for fixed words in header
-    if(((buffer[1] >> 48) & 0xffff) != 0xac9c || (buffer[4] & 0xffff) != 0xcac9)
-    {
-        printf("%lx, %lx\n", (buffer[1] >> 48) & 0xffff, buffer[4] & 0xffff);
-        std::cout << "Data buffer header corrupt" << std::endl;
-        return -2;
-    }
-
-    //Fill data map
-    int channel_count = 0;
-    int cap_count = 0;
-    decltype(data.emplace()) empl_retval;
-    for(unsigned int i = 5; i < buffer.size(); ++i)
+    if(buffer.size() < 5 || ((buffer[1] >> 48) & 0xffff) != 0xac9c || (buffer[4] & 0xffff) != 0xcac9) return -2;
+
+    //Fill data array, five 12 bit samples per word starting after the 5 header words
+    const size_t nSampleWords = AccEventFormat::FULL_SAMPLE_WORDS;
+    size_t nWords = buffer.size() - AccEventFormat::HEADER_WORDS;
+    bool calibrating = outputMode != RAW_COUNTS && calibration;
+    nSamples_ = min(nWords, nSampleWords)*SampleUnpacker::SAMPLES_PER_WORD;
+    if(calibrating) unpackCalibrated(buffer.data() + 5, min(nWords, nSampleWords));
+    else SampleUnpacker::unpack(buffer.data() + 5, min(nWords, nSampleWords), data.data());
+
+    //the ACC sends fewer samples than a complete readout, the rest of the reused array is cleared
+    if(nWords < nSampleWords)
     {
-        for(int j = 4; j >=0; --j)
-        {
-            if(cap_count == 0) empl_retval = data.emplace(std::piecewise_construct, std::forward_as_tuple(channel_count), std::forward_as_tuple(256));
-            (*(empl_retval.first)).second[cap_count] = (buffer[i] >> (j*12)) & 0xfff;
-            ++cap_count;
-            if(cap_count >= 256)
-            {
-                cap_count = 0;
-                ++channel_count;
-            }
-        }
+        size_t nSamples = nWords*SampleUnpacker::SAMPLES_PER_WORD;
+        fill(data.data() + nSamples, data.data() + NUM_CH*NUM_SAMP, 0);
+        if(calibrating) calibrate(nSamples, NUM_CH*NUM_SAMP - nSamples);
     }
 
-    if(data.size()!=NUM_CH)
-    {
-        cout << "error 1: Not 30 channels " << data.size() << endl;
-        for(const auto& thing : data) cout << thing.second.size() << std::endl;
-    }
+    return nWords == AccEventFormat::SAMPLE_WORDS || nWords == nSampleWords ? 0 : 1;
+}
 
-    for(int i=0; i<NUM_CH; i++)
+void ACDC::unpackCalibrated(const uint64_t* words, size_t nWords)
+{
+    //64 words = 320 samples per block, a multiple of the SIMD unpacker block sizes
+    const size_t blockWords = 64;
+    for(size_t first = 0; first < nWords; first += blockWords)
     {
-        if(data[i].size()!=NUM_SAMP)
-        {
-            cout << "error 2: not 256 samples in channel " << i << endl;
-        }
+        size_t n = min(blockWords, nWords - first);
+        int firstCell = first*SampleUnpacker::SAMPLES_PER_WORD;
+        SampleUnpacker::unpack(words + first, n, data.data() + firstCell);
+        calibrate(firstCell, n*SampleUnpacker::SAMPLES_PER_WORD);
     }
-
-    return 0;
 }
 
-
-
-
-
-
-
-
-
+void ACDC::calibrate(int firstCell, int n)
+{
+    if(outputMode == CALIBRATED_MV) calibration->toMV(data.data() + firstCell, firstCell, n, &calibrated.mV[0][0] + firstCell);
+    else calibration->toCounts(data.data() + firstCell, firstCell, n, &calibrated.counts[0][0] + firstCell);
+}
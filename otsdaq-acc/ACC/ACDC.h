@@ -7,7 +7,11 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <span>
+#include <cstdint>
 #include "Metadata.h" //load metadata class
+#include "Waveforms.h" //flat waveform storage
+#include "WaveformCalibration.h" //pedestal and linearity tables
 
 using namespace std;
 
@@ -22,6 +26,14 @@ class ConfigurationTree;
 class ACDC
 {
 public:
+	//what parseDataFromBuffer produces besides the raw ADC counts
+	enum OutputMode
+	{
+		RAW_COUNTS,          //raw ADC counts only
+		CALIBRATED_MV,       //also pedestal subtracted mV, see getCalibratedWaveforms().mV
+		PEDESTAL_SUBTRACTED  //also pedestal subtracted ADC counts, see getCalibratedWaveforms().counts
+	};
+
 	ACDC(); //constructor
 	ACDC(int bi); //constructor
 	~ACDC(); //deconstructor
@@ -34,16 +46,24 @@ public:
         int getNEvents() const {return nEvents_;} 
         void setNEvents(int nEvts) {nEvents_ = nEvts;} 
         void incNEvents() {++nEvents_;} 
-	map<int, vector<unsigned short>> returnData(){return data;} //returns the entire data map | index: channel < samplevector
+	map<int, vector<unsigned short>> returnData() const {return data.toMap();} //returns a copy of the entire data map | index: channel < samplevector
+	const Waveforms& getWaveforms() const {return data;} //returns the waveforms of the last parsed event without copying
+	Waveforms::ChannelView getChannel(int ch) const {return data.channel(ch);} //returns the samples of one channel
+	Waveforms::ChipView getChip(int psec) const {return data.chip(psec);} //returns the samples of the 6 channels of one psec chip
 	map<string, unsigned short> returnMeta(){return map_meta;} //returns the entire meta map | index: metakey < value 
+	const CalibratedWaveforms& getCalibratedWaveforms() const {return calibrated;} //calibrated waveforms of the last parsed event, see setOutputMode()
+	OutputMode getOutputMode() const {return outputMode;}
+	int getNumSamples() const {return nSamples_;} //samples present in the last parsed event, the rest of the waveforms is zero
 
 	//----------local set functions
 	void setBoardIndex(int bi); // set the board index for the current acdc
+	void setCalibration(shared_ptr<const WaveformCalibration> calib) {calibration = calib;} //lookup tables for the calibrated output modes, may be shared between boards
+	void setOutputMode(OutputMode mode) {outputMode = mode;} //calibrated modes fall back to RAW_COUNTS while no calibration is set
 
     void parseConfig(const ots::ConfigurationTree& config);
 
 	//----------parse function for data stream 
-	int parseDataFromBuffer(const vector<uint64_t>& buffer); //parses only the psec data component of the ACDC buffer
+	int parseDataFromBuffer(span<const uint64_t> buffer); //parses only the psec data component of the ACDC buffer, calibrates it in the same pass if an output mode is set
 
     class ConfigParams
     {
@@ -61,15 +81,22 @@ public:
     } params_;
 
 private:
+	void unpackCalibrated(const uint64_t* words, size_t nWords); //unpacks and calibrates block by block while the samples are in L1
+	void calibrate(int firstCell, int n); //calibrates n raw samples of data starting at firstCell
+
 	//----------all neccessary classes
 	Metadata meta; //calls the metadata class for file write
 
 	//----------all neccessary global variables
 	int boardIndex; //var: represents the boardindex for the current board
 	vector<unsigned short> lastAcdcBuffer; //most recently received ACDC buffer
-	map<int, vector<unsigned short>> data; //entire data map | index: channel < samplevector
+	Waveforms data; //entire data array, reused for every event | index: channel, sample
+	CalibratedWaveforms calibrated; //calibrated data array, reused for every event | index: channel, sample
+	shared_ptr<const WaveformCalibration> calibration; //pedestal and linearity tables, null if not calibrating
+	OutputMode outputMode;
 	map<string, unsigned short> map_meta; //entire meta map | index: metakey < value
 	int nEvents_;
+	int nSamples_;
 };
 
 #endif
@@ -0,0 +1,116 @@
+#ifndef _ACCPACKET_H_INCLUDED
+#define _ACCPACKET_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+//Layout of one ACDC burst event as the ACC streams it, shared by
+//everything that builds, splits or decodes events: PACKETS_PER_EVENT UDP
+//packets carrying EVENT_WORDS 64 bit words, the HEADER_WORDS header words
+//followed by the PSEC samples packed 5 per word. The ACC sends fewer
+//sample words than a complete 30x256 readout (FULL_SAMPLE_WORDS), the
+//samples it leaves out decode as zero.
+//
+//Header words:
+//  0: AccPacketView::EVENT_MAGIC | board index (bits 7-0)
+//  1: AccPacketView::ACDC_HEADER (bits 63-48) | event counter (bits 31-0)
+//  2: system clock timestamp
+//  3: not used by the software
+//  4: 0xcac9 in bits 15-0
+//The burst stream carries no PSEC metadata frame, so the event counter and
+//timestamp of words 1 and 2 are the only event keys (AcdcDecodedMeta is
+//decoded from the metadata frames of the register readout).
+class AccEventFormat
+{
+public:
+    static constexpr int PACKETS_PER_EVENT = 8;
+    static constexpr size_t HEADER_WORDS = 5;
+    static constexpr size_t EVENT_WORDS = 1445;
+    static constexpr size_t SAMPLE_WORDS = EVENT_WORDS - HEADER_WORDS;
+    static constexpr size_t FULL_SAMPLE_WORDS = 30*256/5; //NUM_CH*NUM_SAMP samples
+
+    static constexpr int EVENT_COUNT_WORD = 1;
+    static constexpr int TIMESTAMP_WORD = 2;
+    static constexpr int HEADER_END_WORD = 4;
+    static constexpr uint64_t HEADER_END_MARKER = 0xcac9; //bits 15-0 of HEADER_END_WORD
+};
+
+//Non-owning, validated view of one burst packet as received from the ACC:
+//a 2 byte header (byte 1 is the rolling packet ID) followed by 64 bit
+//payload words. The packet is checked once on construction; the payload
+//words sit at an odd offset, so they are read with memcpy, which compiles
+//to a plain (unaligned-safe) load instead of an undefined cast.
+class AccPacketView
+{
+public:
+    static constexpr size_t HEADER_BYTES = 2;
+    static constexpr uint64_t EVENT_MAGIC = 0x123456789abcde00; //word 0 of the first packet of an event, low byte is the board index
+    static constexpr uint64_t EVENT_MAGIC_MASK = 0xffffffffffffff00;
+    static constexpr uint64_t ACDC_HEADER = 0xac9c000000000000; //word 1 of the first packet of an event
+    static constexpr uint64_t ACDC_HEADER_MASK = 0xffff000000000000;
+
+    AccPacketView() : data_(nullptr), size_(0), valid_(false), eventHeader_(false), board_(-1) {}
+
+    AccPacketView(const char* data, size_t size) : data_(data), size_(size)
+    {
+        valid_ = size_ >= HEADER_BYTES + sizeof(uint64_t);
+        eventHeader_ = false;
+        board_ = -1;
+        if(nWords() >= 2)
+        {
+            uint64_t w0 = loadWord(0);
+            uint64_t w1 = loadWord(1);
+            eventHeader_ = (w0 & EVENT_MAGIC_MASK) == EVENT_MAGIC && (w1 & ACDC_HEADER_MASK) == ACDC_HEADER;
+            if(eventHeader_) board_ = w0 & 0xff;
+        }
+    }
+
+    explicit AccPacketView(const string& data) : AccPacketView(data.data(), data.size()) {}
+
+    //----------local return functions
+    bool isValid() const {return valid_;} //header present and at least one payload word
+    int packetID() const {return size_ > 1 ? (int)(unsigned char)data_[1] : -1;}
+    bool isEventHeader() const {return eventHeader_;} //first packet of an event (magic word and 0xac9c marker)
+    int boardIndex() const {return board_;} //board named in the event header, -1 if this is not a header packet
+
+    size_t payloadSize() const {return size_ > HEADER_BYTES ? size_ - HEADER_BYTES : 0;} //in bytes
+    const char* payloadData() const {return data_ + HEADER_BYTES;}
+    span<const char> payload() const {return span<const char>(payloadData(), payloadSize());}
+    size_t nWords() const {return payloadSize()/sizeof(uint64_t);} //complete payload words
+
+    uint64_t operator[](size_t i) const {return loadWord(i);} //unchecked
+    uint64_t word(size_t i) const //bounds-checked
+    {
+        if(i >= nWords()) throw out_of_range("AccPacketView: word " + to_string(i) + " out of " + to_string(nWords()));
+        return loadWord(i);
+    }
+
+    //copies words [first, first+count) into an aligned destination
+    void copyWords(uint64_t* dest, size_t first, size_t count) const
+    {
+        if(first + count > nWords()) throw out_of_range("AccPacketView: copy past end of packet");
+        memcpy(dest, payloadData() + first*sizeof(uint64_t), count*sizeof(uint64_t));
+    }
+
+private:
+    uint64_t loadWord(size_t i) const
+    {
+        uint64_t w;
+        memcpy(&w, payloadData() + i*sizeof(uint64_t), sizeof(w));
+        return w;
+    }
+
+    const char* data_;
+    size_t size_;
+    bool valid_;
+    bool eventHeader_;
+    int board_;
+};
+
+#endif
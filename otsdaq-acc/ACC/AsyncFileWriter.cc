@@ -0,0 +1,262 @@
+#include "AsyncFileWriter.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+AsyncFileWriter::Options::Options() :
+    bufferSize(8 << 20),
+    nBuffers(8),
+    directIO(false),
+    sync(SYNC_NONE)
+{
+}
+
+AsyncFileWriter::Stats::Stats() :
+    bytesWritten(0),
+    nStalls(0),
+    stallSeconds(0),
+    buffersInFlight(0),
+    peakBuffersInFlight(0),
+    nBuffers(0)
+{
+}
+
+AsyncFileWriter::AsyncFileWriter() :
+    fd_(-1),
+    directIO_(false),
+    directIOFallback_(false),
+    sync_(SYNC_NONE),
+    bufferSize_(0),
+    current_(-1),
+    stop_(false),
+    bytesWritten_(0),
+    nStalls_(0),
+    stallSeconds_(0),
+    inFlight_(0),
+    peakInFlight_(0),
+    nBuffers_(0),
+    error_(0)
+{
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+    close();
+}
+
+//opens the file, allocates the buffer ring and starts the writer thread.
+//If O_DIRECT is requested but not supported by the file system the file
+//is opened for buffered I/O instead, see isDirectIOFallback().
+bool AsyncFileWriter::open(const string& fileName, const Options& options)
+{
+    close();
+
+    fileName_ = fileName;
+    sync_ = options.sync;
+    bufferSize_ = ((max(options.bufferSize, IO_ALIGNMENT) + IO_ALIGNMENT - 1) / IO_ALIGNMENT) * IO_ALIGNMENT;
+    int nBuffers = max(options.nBuffers, 2);
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    directIO_ = options.directIO;
+    directIOFallback_ = false;
+    if(directIO_)
+    {
+        fd_ = ::open(fileName.c_str(), flags | O_DIRECT, 0644);
+        if(fd_ < 0 && errno == EINVAL)
+        {
+            directIO_ = false;
+            directIOFallback_ = true;
+        }
+    }
+    if(!directIO_) fd_ = ::open(fileName.c_str(), flags, 0644);
+    if(fd_ < 0) return false;
+
+    buffers_.resize(nBuffers);
+    for(int i = 0; i < nBuffers; ++i)
+    {
+        buffers_[i].data = static_cast<char*>(aligned_alloc(IO_ALIGNMENT, bufferSize_));
+        buffers_[i].size = 0;
+        if(buffers_[i].data == nullptr)
+        {
+            releaseBuffers();
+            ::close(fd_);
+            fd_ = -1;
+            return false;
+        }
+        if(i > 0) freeBuffers_.push_back(i);
+    }
+    current_ = 0;
+
+    stop_ = false;
+    bytesWritten_ = 0;
+    nStalls_ = 0;
+    stallSeconds_ = 0;
+    inFlight_ = 0;
+    peakInFlight_ = 0;
+    nBuffers_ = nBuffers;
+    error_ = 0;
+
+    thread_ = thread(&AsyncFileWriter::writerThread, this);
+    return true;
+}
+
+//hands the partially filled buffer to the writer thread, waits until
+//everything reached the kernel and releases the ring.
+void AsyncFileWriter::close()
+{
+    if(fd_ < 0) return;
+
+    if(current_ >= 0 && buffers_[current_].size > 0)
+    {
+        unique_lock<mutex> lock(mut_);
+        fullBuffers_.push_back(current_);
+        ++inFlight_;
+        current_ = -1;
+        fullCond_.notify_one();
+    }
+
+    {
+        unique_lock<mutex> lock(mut_);
+        stop_ = true;
+        fullCond_.notify_one();
+    }
+    if(thread_.joinable()) thread_.join();
+
+    if(sync_ != SYNC_NONE) fdatasync(fd_);
+    ::close(fd_);
+    fd_ = -1;
+
+    releaseBuffers();
+}
+
+void AsyncFileWriter::write(const void* data, size_t size)
+{
+    const char* src = static_cast<const char*>(data);
+    while(size > 0)
+    {
+        if(current_ < 0) return; //file not open
+
+        Buffer& buffer = buffers_[current_];
+        size_t n = min(size, bufferSize_ - buffer.size);
+        memcpy(buffer.data + buffer.size, src, n);
+        buffer.size += n;
+        src += n;
+        size -= n;
+
+        if(buffer.size == bufferSize_) submitCurrent();
+    }
+}
+
+void AsyncFileWriter::submitCurrent()
+{
+    unique_lock<mutex> lock(mut_);
+    fullBuffers_.push_back(current_);
+    ++inFlight_;
+    peakInFlight_ = max(peakInFlight_, inFlight_);
+    fullCond_.notify_one();
+
+    if(freeBuffers_.empty())
+    {
+        //every buffer is waiting for the disk, this is where the receiver would stall
+        ++nStalls_;
+        auto t0 = chrono::steady_clock::now();
+        freeCond_.wait(lock, [this] { return !freeBuffers_.empty(); });
+        stallSeconds_ += chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    }
+
+    current_ = freeBuffers_.front();
+    freeBuffers_.pop_front();
+    buffers_[current_].size = 0;
+}
+
+void AsyncFileWriter::writerThread()
+{
+    while(true)
+    {
+        int index;
+        {
+            unique_lock<mutex> lock(mut_);
+            fullCond_.wait(lock, [this] { return stop_ || !fullBuffers_.empty(); });
+            if(fullBuffers_.empty()) break; //stop requested and nothing left to write
+            index = fullBuffers_.front();
+            fullBuffers_.pop_front();
+        }
+
+        writeBuffer(buffers_[index]);
+        if(sync_ == SYNC_EACH_BUFFER) fdatasync(fd_);
+
+        {
+            unique_lock<mutex> lock(mut_);
+            buffers_[index].size = 0;
+            freeBuffers_.push_back(index);
+            --inFlight_;
+            freeCond_.notify_one();
+        }
+    }
+}
+
+//writes one buffer, retrying on short writes. With O_DIRECT only whole
+//blocks can be written, so a trailing partial block (end of file) is
+//written after switching the descriptor back to buffered mode.
+void AsyncFileWriter::writeBuffer(const Buffer& buffer)
+{
+    size_t done = 0;
+    size_t size = buffer.size;
+    size_t directSize = directIO_ ? (size / IO_ALIGNMENT) * IO_ALIGNMENT : size;
+
+    while(done < size)
+    {
+        if(done == directSize)
+        {
+            int flags = fcntl(fd_, F_GETFL);
+            fcntl(fd_, F_SETFL, flags & ~O_DIRECT);
+            directIO_ = false;
+            directSize = size;
+        }
+
+        ssize_t n = ::write(fd_, buffer.data + done, directSize - done);
+        if(n < 0)
+        {
+            if(errno == EINTR) continue;
+            int expected = 0;
+            error_.compare_exchange_strong(expected, errno);
+            return;
+        }
+        done += n;
+        bytesWritten_ += n;
+    }
+}
+
+void AsyncFileWriter::releaseBuffers()
+{
+    for(Buffer& buffer : buffers_) free(buffer.data);
+    buffers_.clear();
+    freeBuffers_.clear();
+    fullBuffers_.clear();
+    current_ = -1;
+}
+
+double AsyncFileWriter::fillLevel() const
+{
+    unique_lock<mutex> lock(mut_);
+    return buffers_.empty() ? 0. : double(inFlight_) / buffers_.size();
+}
+
+AsyncFileWriter::Stats AsyncFileWriter::getStats() const
+{
+    unique_lock<mutex> lock(mut_);
+    Stats stats;
+    stats.bytesWritten = bytesWritten_;
+    stats.nStalls = nStalls_;
+    stats.stallSeconds = stallSeconds_;
+    stats.buffersInFlight = inFlight_;
+    stats.peakBuffersInFlight = peakInFlight_;
+    stats.nBuffers = nBuffers_;
+    return stats;
+}
@@ -0,0 +1,119 @@
+#ifndef _ASYNCFILEWRITER_H_INCLUDED
+#define _ASYNCFILEWRITER_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//Writes one output file from a dedicated thread. The caller copies data
+//into a ring of large, page aligned buffers which are handed to the
+//writer thread once full, so a disk stall is absorbed in RAM instead of
+//blocking the thread which drains the network buffers.
+class AsyncFileWriter
+{
+public:
+    static constexpr size_t IO_ALIGNMENT = 4096; //alignment required for O_DIRECT
+
+    enum SyncPolicy
+    {
+        SYNC_NONE,        //leave flushing to the kernel
+        SYNC_ON_CLOSE,    //fdatasync once when the file is closed
+        SYNC_EACH_BUFFER  //fdatasync after every buffer
+    };
+
+    class Options
+    {
+    public:
+        Options();
+
+        size_t bufferSize; //bytes per buffer, rounded up to IO_ALIGNMENT
+        int nBuffers;      //number of buffers in the ring
+        bool directIO;     //open the file with O_DIRECT
+        SyncPolicy sync;
+    };
+
+    class Stats
+    {
+    public:
+        Stats();
+
+        uint64_t bytesWritten;   //bytes handed to the kernel so far
+        uint64_t nStalls;        //times write() had to wait for a free buffer
+        double stallSeconds;     //total time spent waiting for a free buffer
+        int buffersInFlight;     //buffers waiting for or being written to disk
+        int peakBuffersInFlight;
+        int nBuffers;
+    };
+
+    AsyncFileWriter();
+    ~AsyncFileWriter(); //closes the file if still open
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    //----------file handling
+    bool open(const string& fileName, const Options& options = Options()); //returns false if the file cannot be opened
+    void close(); //flushes all buffers and joins the writer thread
+    bool is_open() const {return fd_ >= 0;}
+
+    //----------data input
+    void write(const void* data, size_t size); //copies data into the ring, blocks only if all buffers are in flight
+    void write(span<const char> data) {write(data.data(), data.size());}
+
+    //----------local return functions
+    double fillLevel() const; //fraction of the ring currently waiting for the disk
+    Stats getStats() const;
+    int getError() const {return error_;} //errno of the first failed write, 0 if none
+    bool isDirectIO() const {return directIO_;}
+    bool isDirectIOFallback() const {return directIOFallback_;} //O_DIRECT was requested but not supported, the file uses buffered I/O
+    const string& getFileName() const {return fileName_;}
+
+private:
+    struct Buffer
+    {
+        char* data;
+        size_t size; //bytes filled
+    };
+
+    void writerThread();
+    void submitCurrent(); //hands the current buffer to the writer thread and acquires a free one
+    void writeBuffer(const Buffer& buffer);
+    void releaseBuffers();
+
+    string fileName_;
+    int fd_;
+    bool directIO_;
+    bool directIOFallback_;
+    SyncPolicy sync_;
+    size_t bufferSize_;
+
+    vector<Buffer> buffers_;
+    deque<int> freeBuffers_;
+    deque<int> fullBuffers_;
+    int current_; //buffer currently filled by write(), -1 if none
+
+    mutable mutex mut_;
+    condition_variable fullCond_;
+    condition_variable freeCond_;
+    thread thread_;
+    bool stop_;
+
+    atomic<uint64_t> bytesWritten_;
+    uint64_t nStalls_;
+    double stallSeconds_;
+    int inFlight_;
+    int peakInFlight_;
+    int nBuffers_; //ring size of the last open(), still reported after close()
+    atomic<int> error_;
+};
+
+#endif
@@ -0,0 +1,161 @@
+#include "CompressPipeline.h"
+#include "EventAssembler.h"
+#include "WaveformCodec.h"
+
+#include <algorithm>
+#include <chrono>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+CompressPipeline::Options::Options() :
+    nWorkers(0),
+    queueDepth(256),
+    zstdLevel(1)
+{
+}
+
+CompressPipeline::Lane::Lane(RunFileWriter* output, size_t depth) :
+    out(output),
+    full(depth),
+    empty(depth),
+    nEvents(0),
+    bytesIn(0),
+    bytesOut(0),
+    busyNs(0)
+{
+    //fill the pool of reusable event buffers
+    for(size_t i = 0; i < empty.capacity(); ++i)
+    {
+        Buffer buffer;
+        buffer.words.reserve(EventAssembler::EVENT_WORDS);
+        buffer.bytes = 0;
+        empty.push(std::move(buffer));
+    }
+}
+
+CompressPipeline::CompressPipeline() : nWorkers_(0), zstdLevel_(0), stop_(false)
+{
+}
+
+CompressPipeline::~CompressPipeline()
+{
+    stop();
+}
+
+void CompressPipeline::start(const vector<RunFileWriter*>& outputs, const Options& options)
+{
+    stop();
+
+    lanes_.clear();
+    unpinnedWorkers_.clear();
+    for(RunFileWriter* output : outputs) lanes_.emplace_back(new Lane(output, options.queueDepth));
+    if(lanes_.empty()) return;
+
+    int nWorkers = options.nWorkers > 0 ? options.nWorkers : (int)lanes_.size();
+    nWorkers_ = min({nWorkers, (int)lanes_.size(), MAX_WORKERS});
+    zstdLevel_ = WaveformCodec::hasZstd() ? options.zstdLevel : 0;
+
+    stop_ = false;
+    for(int i = 0; i < nWorkers_; ++i)
+    {
+        workers_.emplace_back(&CompressPipeline::workerThread, this, i);
+
+#ifdef __linux__
+        if(i < (int)options.cores.size() && options.cores[i] >= 0)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(options.cores[i], &cpus);
+            if(pthread_setaffinity_np(workers_.back().native_handle(), sizeof(cpus), &cpus) != 0) unpinnedWorkers_.push_back(i);
+        }
+#endif
+    }
+}
+
+void CompressPipeline::stop()
+{
+    stop_ = true;
+    for(thread& worker : workers_)
+    {
+        if(worker.joinable()) worker.join();
+    }
+    workers_.clear();
+}
+
+bool CompressPipeline::push(int lane, span<const uint64_t> words, size_t bytes)
+{
+    if(lane < 0 || lane >= (int)lanes_.size() || workers_.empty()) return false;
+    Lane& l = *lanes_[lane];
+
+    Buffer buffer;
+    if(!l.empty.popWait(buffer)) return false;
+    buffer.words.assign(words.begin(), words.end());
+    buffer.bytes = bytes;
+    l.full.push(std::move(buffer));
+    return true;
+}
+
+CompressPipeline::Stats CompressPipeline::getStats(int lane) const
+{
+    Stats stats;
+    if(lane < 0 || lane >= (int)lanes_.size()) return stats;
+    const Lane& l = *lanes_[lane];
+    stats.nEvents = l.nEvents;
+    stats.bytesIn = l.bytesIn;
+    stats.bytesOut = l.bytesOut;
+    stats.busySeconds = l.busyNs*1e-9;
+    return stats;
+}
+
+//compresses and writes one event of the lane if there is one, returns false if the lane was empty
+bool CompressPipeline::compressOne(int lane)
+{
+    Lane& l = *lanes_[lane];
+    Buffer buffer;
+    if(!l.full.pop(buffer)) return false;
+
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+    WaveformCodec::encode(buffer.words, buffer.bytes, l.encoded, zstdLevel_);
+    l.busyNs += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t0).count();
+
+    l.out->writeEvent(l.encoded.data(), l.encoded.size());
+    ++l.nEvents;
+    l.bytesIn += buffer.bytes;
+    l.bytesOut += l.encoded.size();
+
+    l.empty.push(std::move(buffer));
+    return true;
+}
+
+void CompressPipeline::workerThread(int worker)
+{
+    int idle = 0;
+    while(true)
+    {
+        //read the flag before the pass, so events pushed before stop() was called are still written
+        bool stopping = stop_;
+
+        bool busy = false;
+        for(int lane = worker; lane < (int)lanes_.size(); lane += nWorkers_)
+        {
+            busy |= compressOne(lane);
+        }
+
+        if(busy)
+        {
+            idle = 0;
+            continue;
+        }
+        if(stopping) break; //all lanes of this worker are drained
+
+        //spin briefly, then back off so idle workers do not burn a core
+        ++idle;
+        if(idle < 64) continue;
+        else if(idle < 128) this_thread::yield();
+        else this_thread::sleep_for(chrono::microseconds(50));
+    }
+}
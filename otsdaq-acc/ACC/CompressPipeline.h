@@ -0,0 +1,98 @@
+#ifndef _COMPRESSPIPELINE_H_INCLUDED
+#define _COMPRESSPIPELINE_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+#include "RingBuffer.h"
+#include "RunFile.h"
+
+using namespace std;
+
+//Compresses assembled ACDC events with WaveformCodec on up to 8 worker
+//threads and writes them to the boards' run files. Lanes (one per board)
+//are laid out like in DecodePipeline: an SPSC queue of recycled event
+//buffers each, spread round-robin over the workers. A lane is only ever
+//handled by one worker, so its events reach the file in order. Unlike
+//decoding nothing may be lost here: push() waits for a free buffer
+//instead of dropping the event.
+class CompressPipeline
+{
+public:
+    static constexpr int MAX_WORKERS = 8;
+
+    class Options
+    {
+    public:
+        Options();
+
+        int nWorkers;      //number of compression threads, <= 0 means one per lane (at most MAX_WORKERS)
+        vector<int> cores; //core to pin worker i to, -1 or missing entries leave the worker unpinned
+        size_t queueDepth; //events buffered per lane
+        int zstdLevel;     //zstd level applied after the waveform coding, 0 for none
+    };
+
+    class Stats
+    {
+    public:
+        Stats() : nEvents(0), bytesIn(0), bytesOut(0), busySeconds(0) {}
+
+        uint64_t nEvents;
+        uint64_t bytesIn;    //event bytes before compression
+        uint64_t bytesOut;   //compressed bytes, without the run file records
+        double busySeconds;  //time spent compressing
+    };
+
+    CompressPipeline();
+    ~CompressPipeline(); //stops the workers
+
+    //----------control
+    void start(const vector<RunFileWriter*>& outputs, const Options& options = Options()); //one lane per output, in the given order
+    void stop(); //compresses and writes what is still queued and joins the workers
+    bool isRunning() const {return !workers_.empty();}
+
+    //----------data input, from a single producer thread
+    bool push(int lane, span<const uint64_t> words, size_t bytes); //copies the event, waits while the lane is full
+
+    //----------local return functions
+    int getNumLanes() const {return (int)lanes_.size();}
+    int getNumWorkers() const {return (int)workers_.size();}
+    const vector<int>& getUnpinnedWorkers() const {return unpinnedWorkers_;} //workers start() could not pin to their Options::cores entry
+    Stats getStats(int lane) const;
+
+private:
+    struct Buffer
+    {
+        vector<uint64_t> words;
+        size_t bytes;
+    };
+
+    struct Lane
+    {
+        Lane(RunFileWriter* output, size_t depth);
+
+        RunFileWriter* out;
+        SPSCRingBuffer<Buffer> full;  //producer -> worker
+        SPSCRingBuffer<Buffer> empty; //worker -> producer
+        vector<char> encoded;
+        atomic<uint64_t> nEvents;
+        atomic<uint64_t> bytesIn;
+        atomic<uint64_t> bytesOut;
+        atomic<uint64_t> busyNs;
+    };
+
+    void workerThread(int worker);
+    bool compressOne(int lane);
+
+    vector<unique_ptr<Lane>> lanes_;
+    vector<thread> workers_;
+    vector<int> unpinnedWorkers_;
+    int nWorkers_;
+    int zstdLevel_;
+    atomic<bool> stop_;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "Crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define ACC_CRC_X86 1
+#endif
+
+using namespace std;
+
+namespace
+{
+constexpr uint32_t POLYNOMIAL = 0x82f63b78; //reflected Castagnoli polynomial
+
+struct Table
+{
+    uint32_t entries[256];
+};
+
+constexpr Table makeTable()
+{
+    Table t{};
+    for(uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t c = i;
+        for(int k = 0; k < 8; ++k) c = (c & 1) ? (c >> 1) ^ POLYNOMIAL : c >> 1;
+        t.entries[i] = c;
+    }
+    return t;
+}
+
+constexpr Table table = makeTable();
+
+uint32_t crc32cTable(const unsigned char* p, size_t size, uint32_t crc)
+{
+    for(size_t i = 0; i < size; ++i) crc = table.entries[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+#ifdef ACC_CRC_X86
+__attribute__((target("sse4.2")))
+uint32_t crc32cSSE42(const unsigned char* p, size_t size, uint32_t crc)
+{
+    uint64_t c = crc;
+    for(; size >= 8; p += 8, size -= 8)
+    {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        c = _mm_crc32_u64(c, word);
+    }
+    uint32_t c32 = (uint32_t)c;
+    for(; size > 0; ++p, --size) c32 = _mm_crc32_u8(c32, *p);
+    return c32;
+}
+
+bool hasSSE42()
+{
+    __builtin_cpu_init(); //may be called during static initialization
+    return __builtin_cpu_supports("sse4.2");
+}
+#endif
+}
+
+uint32_t crc32c(const void* data, size_t size, uint32_t crc)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+#ifdef ACC_CRC_X86
+    static const bool sse42 = hasSSE42();
+    if(sse42) return ~crc32cSSE42(p, size, crc);
+#endif
+    return ~crc32cTable(p, size, crc);
+}
@@ -0,0 +1,13 @@
+#ifndef _CRC32C_H_INCLUDED
+#define _CRC32C_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+
+//CRC-32C (Castagnoli), as used for the integrity checks of the run files.
+//Uses the SSE4.2 crc32 instruction when the CPU has it and a table
+//otherwise; both give identical results. Pass the previous result as crc
+//to continue a checksum over several pieces.
+uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+#endif
@@ -0,0 +1,111 @@
+#include "DQMHistograms.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+DQMAccumulator::Options::Options() :
+    polarity(-1),
+    baselineSamples(16),
+    hitThreshold(20)
+{
+}
+
+DQMAccumulator::DQMAccumulator()
+{
+    reset();
+}
+
+void DQMAccumulator::reset()
+{
+    nEvents_.store(0, memory_order_relaxed);
+    nBytes_.store(0, memory_order_relaxed);
+    for(auto& bin : eventSize_) bin.store(0, memory_order_relaxed);
+
+    nAnalysed_.store(0, memory_order_relaxed);
+    for(int ch = 0; ch < NUM_CH; ++ch)
+    {
+        nSamples_[ch].store(0, memory_order_relaxed);
+        nChannelAnalysed_[ch].store(0, memory_order_relaxed);
+        nBaseline_[ch].store(0, memory_order_relaxed);
+        nHits_[ch].store(0, memory_order_relaxed);
+        pedestalSum_[ch].store(0, memory_order_relaxed);
+        pedestalSum2_[ch].store(0, memory_order_relaxed);
+        amplitudeSum_[ch].store(0, memory_order_relaxed);
+        for(auto& bin : amplitude_[ch]) bin.store(0, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+}
+
+void DQMAccumulator::addEvent(size_t bytes)
+{
+    increment(nEvents_);
+    increment(nBytes_, (uint64_t)bytes);
+    size_t bin = min<size_t>((bytes + 7)/8/DQMSnapshot::SIZE_BIN_WORDS, DQMSnapshot::SIZE_BINS - 1);
+    increment(eventSize_[bin]);
+}
+
+//the zero filled samples the ACC did not send would look like a pulse, only the samples present are used
+void DQMAccumulator::addWaveforms(const Waveforms& waveforms, size_t nSamples)
+{
+    for(int ch = 0; ch < NUM_CH; ++ch)
+    {
+        const unsigned short* s = waveforms.samples[ch];
+        int n = Waveforms::channelSamples(ch, nSamples);
+        nSamples_[ch].store(n, memory_order_relaxed);
+        if(n == 0) continue;
+        increment(nChannelAnalysed_[ch]);
+        int nBaseline = min(max(options_.baselineSamples, 1), n);
+        increment(nBaseline_[ch], (uint64_t)nBaseline);
+
+        //integer sums are exact for 12 bit samples
+        uint32_t sum = 0;
+        uint64_t sum2 = 0;
+        for(int i = 0; i < nBaseline; ++i)
+        {
+            sum += s[i];
+            sum2 += (uint32_t)s[i]*s[i];
+        }
+        increment(pedestalSum_[ch], (double)sum);
+        increment(pedestalSum2_[ch], (double)sum2);
+
+        unsigned short peak = options_.polarity < 0 ? *min_element(s, s + n) : *max_element(s, s + n);
+        float baseline = (float)sum/nBaseline;
+        float amplitude = max(options_.polarity < 0 ? baseline - peak : peak - baseline, 0.0f);
+        increment(amplitudeSum_[ch], (double)amplitude);
+        int bin = min((int)amplitude/DQMSnapshot::AMPLITUDE_BIN_COUNTS, DQMSnapshot::AMPLITUDE_BINS - 1);
+        increment(amplitude_[ch][bin]);
+        if(amplitude > options_.hitThreshold) increment(nHits_[ch]);
+    }
+    increment(nAnalysed_);
+}
+
+void DQMAccumulator::fill(DQMSnapshot::Board& board) const
+{
+    board.nEvents = nEvents_.load(memory_order_relaxed);
+    board.nBytes = nBytes_.load(memory_order_relaxed);
+    for(int i = 0; i < DQMSnapshot::SIZE_BINS; ++i) board.eventSize[i] = eventSize_[i].load(memory_order_relaxed);
+
+    //the per channel values of the event being analysed may be partly included, which is fine for monitoring
+    uint64_t nAnalysed = nAnalysed_.load(memory_order_relaxed);
+    board.nAnalysed = nAnalysed;
+    for(int ch = 0; ch < NUM_CH; ++ch)
+    {
+        DQMSnapshot::Channel& channel = board.channels[ch];
+        uint32_t nSamples = nSamples_[ch].load(memory_order_relaxed);
+        channel.status = nAnalysed == 0 ? DQMSnapshot::CHANNEL_NOT_ANALYSED : nSamples == 0 ? DQMSnapshot::CHANNEL_ABSENT
+                       : nSamples < NUM_SAMP ? DQMSnapshot::CHANNEL_PARTIAL : DQMSnapshot::CHANNEL_COMPLETE;
+        channel.nSamples = nSamples;
+        uint64_t nChannelAnalysed = nChannelAnalysed_[ch].load(memory_order_relaxed);
+        double nBaseline = nBaseline_[ch].load(memory_order_relaxed);
+        channel.nAnalysed = nChannelAnalysed;
+        channel.nHits = nHits_[ch].load(memory_order_relaxed);
+        double mean = nBaseline > 0 ? pedestalSum_[ch].load(memory_order_relaxed)/nBaseline : 0;
+        double variance = nBaseline > 0 ? pedestalSum2_[ch].load(memory_order_relaxed)/nBaseline - mean*mean : 0;
+        channel.pedestalMean = mean;
+        channel.pedestalRMS = sqrt(max(variance, 0.0));
+        channel.meanAmplitude = nChannelAnalysed ? amplitudeSum_[ch].load(memory_order_relaxed)/nChannelAnalysed : 0;
+        for(int i = 0; i < DQMSnapshot::AMPLITUDE_BINS; ++i) channel.amplitude[i] = amplitude_[ch][i].load(memory_order_relaxed);
+    }
+}
@@ -0,0 +1,135 @@
+#ifndef _DQMHISTOGRAMS_H_INCLUDED
+#define _DQMHISTOGRAMS_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "Waveforms.h"
+
+using namespace std;
+
+//Online data quality monitoring histograms.
+//
+//DQMSnapshot is the published state: plain fixed size data without
+//pointers, so it can be copied into shared memory (SharedMemorySeqlock)
+//and read by viewers in other processes. Counters and histograms are
+//totals since the start of the run, rates are taken over the last update
+//interval. The ACC does not send every sample of a readout, the channels
+//it sends only in part or not at all are marked by their status; their
+//values only cover the samples present.
+class DQMSnapshot
+{
+public:
+    static constexpr uint32_t VERSION = 2;
+    static constexpr int MAX_BOARDS = 8;
+    static constexpr int SIZE_BINS = 64;
+    static constexpr int SIZE_BIN_WORDS = 32;        //event size histogram bin width, the last bin also counts larger events
+    static constexpr int AMPLITUDE_BINS = 64;
+    static constexpr int AMPLITUDE_BIN_COUNTS = 32;  //amplitude histogram bin width in ADC counts, the last bin also counts larger amplitudes
+
+    enum ChannelStatus
+    {
+        CHANNEL_NOT_ANALYSED = 0, //no event analysed yet
+        CHANNEL_COMPLETE,         //all NUM_SAMP samples in the events
+        CHANNEL_PARTIAL,          //only the first nSamples samples in the events
+        CHANNEL_ABSENT            //not in the events, all values are 0
+    };
+
+    struct Channel
+    {
+        uint32_t status;         //ChannelStatus of the last analysed event
+        uint32_t nSamples;       //samples of the channel in the last analysed event
+        uint64_t nAnalysed;      //analysed events which contained the channel
+        uint64_t nHits;          //events with an amplitude above the hit threshold
+        float hitRate;           //Hz
+        float pedestalMean;      //ADC counts, from the baseline samples
+        float pedestalRMS;       //noise of the baseline samples
+        float meanAmplitude;
+        uint32_t amplitude[AMPLITUDE_BINS];
+    };
+
+    struct Board
+    {
+        int32_t boardIndex;      //-1 for unused entries
+        uint32_t padding;
+        uint64_t nEvents;        //complete events received
+        uint64_t nBytes;
+        uint64_t nAnalysed;      //events that went through the waveform analysis (prescaled)
+        uint64_t nDecodeErrors;
+        uint64_t nNotAnalysed;   //events skipped because the analysis lagged behind
+        float eventRate;         //Hz
+        float dataRate;          //MB/s
+        uint32_t eventSize[SIZE_BINS]; //in 64 bit words
+        Channel channels[NUM_CH];
+    };
+
+    uint32_t version;
+    uint32_t nBoards;
+    uint64_t runNumber;
+    uint64_t updateCount;        //snapshots published in this run
+    int64_t timestamp;           //unix time of the snapshot in ns
+    double runSeconds;           //since the start of the run
+    uint64_t nPackets;
+    uint64_t nPacketsLost;       //from gaps in the packet IDs
+    uint64_t nEventsDropped;     //incomplete events dropped by the event assembly
+    Board boards[MAX_BOARDS];
+};
+
+//Per board accumulator of the monitoring quantities. The event counters
+//are written by the receiving thread, the waveform quantities by the
+//thread analysing the board's events; every field has exactly one writer,
+//so the counters are atomics updated with plain relaxed loads and stores
+//(no locked instructions) and fill() can copy them from any other thread
+//at any time while the writers keep running.
+class DQMAccumulator
+{
+public:
+    class Options
+    {
+    public:
+        Options();
+
+        int polarity;        //-1 for negative pulses
+        int baselineSamples; //first samples of a channel used as baseline
+        int hitThreshold;    //amplitude above the baseline, in ADC counts
+    };
+
+    DQMAccumulator();
+
+    //----------local set functions
+    void setOptions(const Options& options) {options_ = options;}
+    void reset(); //only while no writer is running
+
+    //----------receiving thread
+    void addEvent(size_t bytes);
+
+    //----------analysing thread, only the first nSamples samples of the event are used (see ACDC::getNumSamples())
+    void addWaveforms(const Waveforms& waveforms, size_t nSamples = NUM_CH*NUM_SAMP);
+
+    //----------any thread, copies the totals (rates, decode errors and skipped events are left alone)
+    void fill(DQMSnapshot::Board& board) const;
+
+private:
+    template<typename C, typename V = typename C::value_type>
+    static void increment(C& counter, V n = 1) {counter.store(counter.load(memory_order_relaxed) + n, memory_order_relaxed);}
+
+    Options options_;
+
+    //written by the receiving thread
+    alignas(64) atomic<uint64_t> nEvents_;
+    atomic<uint64_t> nBytes_;
+    atomic<uint32_t> eventSize_[DQMSnapshot::SIZE_BINS];
+
+    //written by the analysing thread
+    alignas(64) atomic<uint64_t> nAnalysed_;
+    atomic<uint32_t> nSamples_[NUM_CH];       //in the last analysed event
+    atomic<uint64_t> nChannelAnalysed_[NUM_CH]; //events which contained the channel
+    atomic<uint64_t> nBaseline_[NUM_CH];      //baseline samples in the pedestal sums
+    atomic<uint64_t> nHits_[NUM_CH];
+    atomic<double> pedestalSum_[NUM_CH];
+    atomic<double> pedestalSum2_[NUM_CH];
+    atomic<double> amplitudeSum_[NUM_CH];
+    atomic<uint32_t> amplitude_[NUM_CH][DQMSnapshot::AMPLITUDE_BINS];
+};
+
+#endif
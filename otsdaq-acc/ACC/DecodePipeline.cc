@@ -0,0 +1,174 @@
+#include "DecodePipeline.h"
+#include "EventAssembler.h"
+
+#include <algorithm>
+#include <chrono>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+DecodePipeline::Options::Options() :
+    nWorkers(0),
+    queueDepth(256),
+    outputMode(ACDC::RAW_COUNTS)
+{
+}
+
+DecodePipeline::Lane::Lane(int board, size_t depth) :
+    acdc(board),
+    full(depth),
+    empty(depth),
+    nQueued(0),
+    nDecoded(0),
+    nDropped(0),
+    nErrors(0),
+    nBadLength(0)
+{
+    //fill the pool of reusable event buffers
+    for(size_t i = 0; i < empty.capacity(); ++i)
+    {
+        vector<uint64_t> buffer;
+        buffer.reserve(EventAssembler::EVENT_WORDS);
+        empty.push(std::move(buffer));
+    }
+}
+
+DecodePipeline::DecodePipeline() : nWorkers_(0), stop_(false)
+{
+}
+
+DecodePipeline::~DecodePipeline()
+{
+    stop();
+}
+
+void DecodePipeline::start(const vector<int>& boardNumbers, const Options& options)
+{
+    stop();
+
+    lanes_.clear();
+    unpinnedWorkers_.clear();
+    for(int board : boardNumbers)
+    {
+        lanes_.emplace_back(new Lane(board, options.queueDepth));
+        if(lanes_.size() <= options.calibrations.size()) lanes_.back()->acdc.setCalibration(options.calibrations[lanes_.size() - 1]);
+        lanes_.back()->acdc.setOutputMode(options.outputMode);
+    }
+    if(lanes_.empty()) return;
+
+    int nWorkers = options.nWorkers > 0 ? options.nWorkers : (int)lanes_.size();
+    nWorkers_ = min({nWorkers, (int)lanes_.size(), MAX_WORKERS});
+
+    stop_ = false;
+    for(int i = 0; i < nWorkers_; ++i)
+    {
+        workers_.emplace_back(&DecodePipeline::workerThread, this, i);
+
+#ifdef __linux__
+        if(i < (int)options.cores.size() && options.cores[i] >= 0)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(options.cores[i], &cpus);
+            if(pthread_setaffinity_np(workers_.back().native_handle(), sizeof(cpus), &cpus) != 0) unpinnedWorkers_.push_back(i);
+        }
+#endif
+    }
+}
+
+void DecodePipeline::stop()
+{
+    stop_ = true;
+    for(thread& worker : workers_)
+    {
+        if(worker.joinable()) worker.join();
+    }
+    workers_.clear();
+}
+
+bool DecodePipeline::push(int lane, span<const uint64_t> event)
+{
+    if(lane < 0 || lane >= (int)lanes_.size()) return false;
+    Lane& l = *lanes_[lane];
+
+    vector<uint64_t> buffer;
+    if(!l.empty.pop(buffer))
+    {
+        //the workers fell behind, drop the event rather than stall the receiver
+        ++l.nDropped;
+        return false;
+    }
+    buffer.assign(event.begin(), event.end());
+    l.full.push(std::move(buffer));
+    ++l.nQueued;
+    return true;
+}
+
+DecodePipeline::Stats DecodePipeline::getStats(int lane) const
+{
+    Stats stats;
+    if(lane < 0 || lane >= (int)lanes_.size()) return stats;
+    const Lane& l = *lanes_[lane];
+    stats.nQueued = l.nQueued;
+    stats.nDecoded = l.nDecoded;
+    stats.nDropped = l.nDropped;
+    stats.nErrors = l.nErrors;
+    stats.nBadLength = l.nBadLength;
+    return stats;
+}
+
+//decodes one event of the lane if there is one, returns false if the lane was empty
+bool DecodePipeline::decodeOne(int lane)
+{
+    Lane& l = *lanes_[lane];
+    vector<uint64_t> buffer;
+    if(!l.full.pop(buffer)) return false;
+
+    int result = l.acdc.parseDataFromBuffer(buffer);
+    if(result >= 0)
+    {
+        if(result > 0) ++l.nBadLength;
+        l.acdc.incNEvents();
+        ++l.nDecoded;
+        if(callback_) callback_(lane, l.acdc, buffer);
+    }
+    else
+    {
+        ++l.nErrors;
+    }
+
+    l.empty.push(std::move(buffer));
+    return true;
+}
+
+void DecodePipeline::workerThread(int worker)
+{
+    int idle = 0;
+    while(true)
+    {
+        //read the flag before the pass, so events pushed before stop() was called are still decoded
+        bool stopping = stop_;
+
+        bool busy = false;
+        for(int lane = worker; lane < (int)lanes_.size(); lane += nWorkers_)
+        {
+            busy |= decodeOne(lane);
+        }
+
+        if(busy)
+        {
+            idle = 0;
+            continue;
+        }
+        if(stopping) break; //all lanes of this worker are drained
+
+        //spin briefly, then back off so idle workers do not burn a core
+        ++idle;
+        if(idle < 64) continue;
+        else if(idle < 128) this_thread::yield();
+        else this_thread::sleep_for(chrono::microseconds(50));
+    }
+}
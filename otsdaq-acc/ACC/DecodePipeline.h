@@ -0,0 +1,101 @@
+#ifndef _DECODEPIPELINE_H_INCLUDED
+#define _DECODEPIPELINE_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+#include "ACDC.h"
+#include "RingBuffer.h"
+
+using namespace std;
+
+//Decodes assembled ACDC events on up to 8 worker threads. Every board
+//gets its own lane: a lock-free SPSC queue of event buffers and its own
+//ACDC object, so boards are decoded in parallel without sharing state.
+//Lanes are spread round-robin over the workers; with one worker per
+//board the throughput scales with the number of connected boards.
+//Event buffers are preallocated and recycled through a second queue per
+//lane, so the steady state does not allocate.
+class DecodePipeline
+{
+public:
+    static constexpr int MAX_WORKERS = 8;
+
+    //called on the worker thread owning the lane after an event was decoded
+    typedef function<void(int lane, const ACDC& acdc, span<const uint64_t> event)> Callback;
+
+    class Options
+    {
+    public:
+        Options();
+
+        int nWorkers;        //number of decode threads, <= 0 means one per lane (at most MAX_WORKERS)
+        vector<int> cores;   //core to pin worker i to, -1 or missing entries leave the worker unpinned
+        size_t queueDepth;   //events buffered per lane
+        ACDC::OutputMode outputMode; //calibrated waveforms handed to the callback, see ACDC::setOutputMode
+        vector<shared_ptr<const WaveformCalibration>> calibrations; //per lane, needed for the calibrated modes
+    };
+
+    class Stats
+    {
+    public:
+        Stats() : nQueued(0), nDecoded(0), nDropped(0), nErrors(0), nBadLength(0) {}
+
+        uint64_t nQueued;  //events accepted by push()
+        uint64_t nDecoded; //events decoded successfully
+        uint64_t nDropped; //events rejected because the lane was full
+        uint64_t nErrors;  //events parseDataFromBuffer rejected
+        uint64_t nBadLength; //decoded events of unexpected length, the missing samples are 0
+    };
+
+    DecodePipeline();
+    ~DecodePipeline(); //stops the workers
+
+    //----------local set functions
+    void setCallback(const Callback& callback) {callback_ = callback;} //set before start()
+
+    //----------control
+    void start(const vector<int>& boardNumbers, const Options& options = Options()); //one lane per board, in the given order
+    void stop(); //decodes what is still queued and joins the workers
+    bool isRunning() const {return !workers_.empty();}
+
+    //----------data input, from a single producer thread
+    bool push(int lane, span<const uint64_t> event); //copies the event into a recycled buffer, false if the lane is full
+
+    //----------local return functions
+    int getNumLanes() const {return (int)lanes_.size();}
+    int getNumWorkers() const {return (int)workers_.size();}
+    const vector<int>& getUnpinnedWorkers() const {return unpinnedWorkers_;} //workers start() could not pin to their Options::cores entry
+    Stats getStats(int lane) const;
+
+private:
+    struct Lane
+    {
+        Lane(int board, size_t depth);
+
+        ACDC acdc;
+        SPSCRingBuffer<vector<uint64_t>> full;  //producer -> worker
+        SPSCRingBuffer<vector<uint64_t>> empty; //worker -> producer
+        atomic<uint64_t> nQueued;
+        atomic<uint64_t> nDecoded;
+        atomic<uint64_t> nDropped;
+        atomic<uint64_t> nErrors;
+        atomic<uint64_t> nBadLength;
+    };
+
+    void workerThread(int worker);
+    bool decodeOne(int lane);
+
+    vector<unique_ptr<Lane>> lanes_;
+    vector<thread> workers_;
+    vector<int> unpinnedWorkers_;
+    int nWorkers_;
+    Callback callback_;
+    atomic<bool> stop_;
+};
+
+#endif
@@ -0,0 +1,228 @@
+#include "EventAssembler.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+EventAssembler::LossStats::LossStats() :
+    nPacketsLost(0),
+    nEventsLost(0),
+    nBursts(0),
+    burstLength{}
+{
+}
+
+EventAssembler::EventAssembler() :
+    quarantine_(false),
+    synced_(false),
+    currentPacket_(0),
+    currentSlot_(-1),
+    completedSlot_(-1),
+    lastPacketID_(-1),
+    previousPacketID_(-1),
+    packetGap_(false),
+    lostPackets_(0),
+    lostSlot_(-1),
+    headerBoard_(-1),
+    headerWords_{0, 0},
+    nDroppedEvents_(0),
+    nLostPackets_(0),
+    nResyncs_(0),
+    lossStats_(1)
+{
+    fill_n(slotOfBoard_, 256, -1);
+    slots_.resize(1);
+}
+
+EventAssembler::~EventAssembler()
+{
+}
+
+//allocates one event slot per configured board, plus the quarantine
+//slot. The slots are sized for a nominal event and reused for every
+//following event.
+void EventAssembler::setBoards(const vector<int>& boardNumbers)
+{
+    boardNumbers_ = boardNumbers;
+    fill_n(slotOfBoard_, 256, -1);
+    for(int i = (int)boardNumbers_.size() - 1; i >= 0; i--)
+    {
+        if(boardNumbers_[i] >= 0 && boardNumbers_[i] < 256) slotOfBoard_[boardNumbers_[i]] = i;
+    }
+    slots_.resize(boardNumbers_.size() + 1);
+    for(Slot& slot : slots_)
+    {
+        slot.words.assign(EVENT_WORDS, 0);
+        slot.bytes = 0;
+    }
+    reset();
+}
+
+void EventAssembler::reset()
+{
+    for(Slot& slot : slots_) slot.bytes = 0;
+    synced_ = false;
+    currentPacket_ = 0;
+    currentSlot_ = -1;
+    completedSlot_ = -1;
+    lastPacketID_ = -1;
+    previousPacketID_ = -1;
+    packetGap_ = false;
+    lostPackets_ = 0;
+    lostSlot_ = -1;
+    nDroppedEvents_ = 0;
+    nLostPackets_ = 0;
+    nResyncs_ = 0;
+    lossStats_.assign(slots_.size() + 1, LossStats());
+}
+
+//takes one packet as received from the ACC (2 byte header + payload).
+//retval: see EventAssembler::Status
+EventAssembler::Status EventAssembler::addPacket(const AccPacketView& packet)
+{
+    completedSlot_ = -1;
+    packetGap_ = false;
+    lostPackets_ = 0;
+    lostSlot_ = -1;
+
+    int currentPacketID = packet.packetID();
+    if(currentPacketID < 0) return NO_EVENT; //not even a packet header
+
+    //Every ID skipped since the last packet, modulo 256, is a lost packet
+    if(lastPacketID_ >= 0)
+    {
+        int missing = (currentPacketID - lastPacketID_ - 1) & 0xff;
+        if(missing > 0) recordLoss(missing);
+    }
+    previousPacketID_ = lastPacketID_;
+    lastPacketID_ = currentPacketID;
+
+    //A header where the IDs say mid event, or none where one is due: the
+    //stream is out of step with the counting, start over from this packet
+    bool header = packet.isEventHeader();
+    if(synced_ && header != (currentPacket_ == 0))
+    {
+        dropOpenEvent();
+        synced_ = false;
+        ++nResyncs_;
+    }
+
+    if(!synced_ || currentPacket_ == 0)
+    {
+        headerWords_[0] = packet.nWords() > 0 ? packet[0] : 0;
+        headerWords_[1] = packet.nWords() > 1 ? packet[1] : 0;
+
+        if(!header)
+        {
+            //Skip to next packet in search of valid header.
+            return HEADER_ERROR;
+        }
+
+        synced_ = true;
+        currentPacket_ = 0;
+        headerBoard_ = packet.boardIndex();
+        currentSlot_ = slotOfBoard_[headerBoard_ & 0xff];
+        bool unknownBoard = currentSlot_ < 0;
+        if(unknownBoard) currentSlot_ = quarantineSlot();
+        if(currentSlot_ >= 0) slots_[currentSlot_].bytes = 0;
+        if(unknownBoard)
+        {
+            //the rest of this event is skipped, or collected in the quarantine slot
+            if(currentSlot_ >= 0) append(slots_[currentSlot_], packet.payload());
+            currentPacket_ = 1;
+            return UNKNOWN_BOARD;
+        }
+    }
+
+    currentPacket_ = (currentPacket_ + 1) % PACKETS_PER_EVENT;
+    if(currentSlot_ < 0)
+    {
+        //Rest of an event that lost its header or names an unknown board
+        return NO_EVENT;
+    }
+
+    append(slots_[currentSlot_], packet.payload());
+
+    if(currentPacket_ == 0)
+    {
+        completedSlot_ = currentSlot_;
+        currentSlot_ = -1;
+        return completedSlot_ == quarantineSlot() ? EVENT_QUARANTINED : EVENT_COMPLETE;
+    }
+    return PACKET_ACCEPTED;
+}
+
+//attributes the packets lost in front of the current one: the first ones
+//to the open event, if any, the rest to the events that started in the gap
+void EventAssembler::recordLoss(int nPackets)
+{
+    packetGap_ = true;
+    lostPackets_ = nPackets;
+    nLostPackets_ += nPackets;
+
+    LossStats& burst = lossStats_[currentSlot_ + 1];
+    ++burst.nBursts;
+    ++burst.burstLength[burstBin(nPackets)];
+
+    if(!synced_)
+    {
+        //no header seen yet, nothing to attribute them to
+        lossStats_[0].nPacketsLost += nPackets;
+        return;
+    }
+
+    int remaining = nPackets;
+    if(currentPacket_ > 0)
+    {
+        int n = min(remaining, PACKETS_PER_EVENT - currentPacket_);
+        lossStats_[currentSlot_ + 1].nPacketsLost += n;
+        if(currentSlot_ >= 0)
+        {
+            ++lossStats_[currentSlot_ + 1].nEventsLost;
+            lostSlot_ = currentSlot_;
+            dropOpenEvent();
+        }
+        remaining -= n;
+    }
+    lossStats_[0].nPacketsLost += remaining;
+    lossStats_[0].nEventsLost += (remaining + PACKETS_PER_EVENT - 1)/PACKETS_PER_EVENT;
+
+    //position of the current packet, past the lost ones
+    currentPacket_ = (currentPacket_ + nPackets) % PACKETS_PER_EVENT;
+    currentSlot_ = -1;
+}
+
+int EventAssembler::burstBin(int nPackets)
+{
+    int bin = 0;
+    while(bin < LOSS_BURST_BINS - 1 && nPackets > (1 << bin)) ++bin;
+    return bin;
+}
+
+//copies the payload behind the bytes already collected. The slot only
+//grows if an event is larger than the nominal size, which happens once.
+void EventAssembler::append(Slot& slot, span<const char> payload)
+{
+    size_t size = payload.size();
+    size_t needed = (slot.bytes + size + 7) / 8;
+    if(needed > slot.words.size()) slot.words.resize(needed, 0);
+
+    char* dest = reinterpret_cast<char*>(slot.words.data());
+    memcpy(dest + slot.bytes, payload.data(), size);
+    slot.bytes += size;
+
+    //keep the last word zero padded for word-wise readers
+    size_t tail = slot.bytes % 8;
+    if(tail) memset(dest + slot.bytes, 0, 8 - tail);
+}
+
+void EventAssembler::dropOpenEvent()
+{
+    if(currentSlot_ >= 0 && currentPacket_ > 0)
+    {
+        slots_[currentSlot_].bytes = 0;
+        ++nDroppedEvents_;
+    }
+    currentSlot_ = -1;
+}
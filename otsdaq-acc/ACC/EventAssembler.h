@@ -0,0 +1,120 @@
+#ifndef _EVENTASSEMBLER_H_INCLUDED
+#define _EVENTASSEMBLER_H_INCLUDED
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <span>
+#include "AccPacket.h"
+
+using namespace std;
+
+//Collects the UDP packets of one ACDC burst event into a preallocated
+//per-board slot. An event is only handed out once all of its packets
+//arrived, so partial events never reach the output files.
+//
+//Packet loss: every event is 8 packets with consecutive IDs (modulo 256),
+//so once an event header was seen the position of every later packet
+//within its event follows from the ID. A gap in the IDs therefore tells
+//which packets were lost: those of the open event (its board is known,
+//the event is dropped) and whole events whose headers were lost (board
+//unknown). The remaining packets of an event that lost its header are
+//skipped and reassembly resumes with the next header, the intact events
+//on either side of a gap are kept.
+class EventAssembler
+{
+public:
+    static constexpr int PACKETS_PER_EVENT = AccEventFormat::PACKETS_PER_EVENT; //one event consists of 8 UDP packets
+    static constexpr size_t EVENT_WORDS = AccEventFormat::EVENT_WORDS; //nominal size of one event in 64 bit words
+    static constexpr int LOSS_BURST_BINS = 9; //burst lengths 1, 2, 3-4, 5-8, ..., 129-255 packets
+
+    enum Status
+    {
+        PACKET_ACCEPTED, //packet appended to the open event
+        EVENT_COMPLETE,  //packet completed the event, see completedSlot()
+        HEADER_ERROR,    //expected an event header but the packet is not one
+        UNKNOWN_BOARD,   //event header names a board which is not configured
+        NO_EVENT,        //no open event, packet ignored until the next header
+        EVENT_QUARANTINED //packet completed an event of a board which is not configured, see quarantineSlot()
+    };
+
+    //packet loss of one board, or of the events whose board is unknown
+    class LossStats
+    {
+    public:
+        LossStats();
+
+        uint64_t nPacketsLost;
+        uint64_t nEventsLost;                     //events that lost at least one packet
+        uint64_t nBursts;                         //gaps starting in an event of this board
+        uint64_t burstLength[LOSS_BURST_BINS];    //packets per gap, bin i counts lengths 2^(i-1)+1 to 2^i
+    };
+
+    EventAssembler();
+    ~EventAssembler();
+
+    //----------local set functions
+    void setBoards(const vector<int>& boardNumbers); //configured board indices, one slot per board
+    void reset(); //drops all open events and forgets the last packet ID
+    void setQuarantine(bool quarantine) {quarantine_ = quarantine;} //collect the events of unknown boards in quarantineSlot() instead of skipping them
+
+    //----------packet input
+    Status addPacket(const AccPacketView& packet);
+    Status addPacket(const char* data, size_t size) {return addPacket(AccPacketView(data, size));} //data includes the 2 byte packet header
+
+    //----------local return functions
+    int getNumSlots() const {return (int)boardNumbers_.size();} //board slots, without the quarantine slot
+    int completedSlot() const {return completedSlot_;} //slot of the event completed by the last packet
+    int quarantineSlot() const {return quarantine_ ? (int)boardNumbers_.size() : -1;} //slot collecting the events of unknown boards, -1 if disabled
+    const char* eventData(int slot) const {return reinterpret_cast<const char*>(slots_[slot].words.data());}
+    size_t eventSize(int slot) const {return slots_[slot].bytes;} //in bytes
+    span<const uint64_t> eventWords(int slot) const {return span<const uint64_t>(slots_[slot].words.data(), (slots_[slot].bytes + 7)/8);} //zero padded to full words
+
+    bool packetGap() const {return packetGap_;} //last packet did not follow its predecessor
+    int lostPackets() const {return lostPackets_;} //packets missing before the last packet
+    int lostSlot() const {return lostSlot_;} //slot of the open event dropped by the last gap, -1 if none
+    int lastPacketID() const {return lastPacketID_;}
+    int previousPacketID() const {return previousPacketID_;}
+    int headerBoard() const {return headerBoard_;} //board byte of the last event header seen
+    uint64_t headerWord(int i) const {return headerWords_[i];} //first two payload words of the last header candidate
+
+    uint64_t getNDroppedEvents() const {return nDroppedEvents_;} //open events dropped incomplete
+    uint64_t getNLostPackets() const {return nLostPackets_;}
+    uint64_t getNResyncs() const {return nResyncs_;} //headers found out of step with the packet IDs
+    const LossStats& getLossStats(int slot) const {return lossStats_[slot + 1];} //slot -1: events whose header was lost
+    static int burstBin(int nPackets);
+
+private:
+    struct Slot
+    {
+        vector<uint64_t> words; //preallocated event storage
+        size_t bytes;           //bytes filled so far
+    };
+
+    void append(Slot& slot, span<const char> payload);
+    void dropOpenEvent();
+    void recordLoss(int nPackets);
+
+    vector<Slot> slots_; //one per board, then the quarantine slot
+    vector<int> boardNumbers_;
+    int slotOfBoard_[256]; //by board byte of the event header, -1 for boards not configured
+    bool quarantine_;
+
+    bool synced_;           //a header was seen and the packet IDs followed it, currentPacket_ is valid
+    int currentPacket_;     //0-7, position of the next packet within its event
+    int currentSlot_;       //slot of the open event, -1 if none
+    int completedSlot_;
+    int lastPacketID_;
+    int previousPacketID_;
+    bool packetGap_;
+    int lostPackets_;
+    int lostSlot_;
+    int headerBoard_;
+    uint64_t headerWords_[2];
+    uint64_t nDroppedEvents_;
+    uint64_t nLostPackets_;
+    uint64_t nResyncs_;
+    vector<LossStats> lossStats_; //index slot + 1
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "EventBuilder.h"
+#include "EventAssembler.h"
+
+using namespace std;
+
+EventBuilder::Options::Options() :
+    timestampTolerance(2),
+    matchEventCount(true),
+    reorderDepth(64),
+    timeout(100000)
+{
+}
+
+EventBuilder::EventBuilder() : nLanes_(0)
+{
+}
+
+void EventBuilder::start(int nLanes, const Options& options)
+{
+    options_ = options;
+    if(options_.reorderDepth == 0) options_.reorderDepth = 1;
+    nLanes_ = min(max(nLanes, 0), MAX_BOARDS);
+    stats_ = Stats();
+
+    open_.clear();
+    open_.reserve(options_.reorderDepth + 1);
+
+    //every open event holds at most one fragment per lane
+    size_t nBuffers = (options_.reorderDepth + 1)*nLanes_;
+    pool_.resize(nBuffers);
+    freeBuffers_.clear();
+    for(size_t i = 0; i < nBuffers; ++i)
+    {
+        pool_[i].reserve(EventAssembler::EVENT_WORDS);
+        freeBuffers_.push_back(i);
+    }
+}
+
+bool EventBuilder::extractKey(span<const uint64_t> event, uint32_t& eventCount, uint64_t& timestamp)
+{
+    if(event.size() < HEADER_WORDS || (event[EVENT_COUNT_WORD] & AccPacketView::ACDC_HEADER_MASK) != AccPacketView::ACDC_HEADER) return false;
+    eventCount = event[EVENT_COUNT_WORD] & 0xffffffff;
+    timestamp = event[TIMESTAMP_WORD];
+    return true;
+}
+
+void EventBuilder::serialize(const BuiltEvent& event, vector<uint64_t>& out)
+{
+    uint64_t flags = (event.complete ? RECORD_COMPLETE : 0) | (event.timedOut ? RECORD_TIMED_OUT : 0);
+    size_t payload = 0;
+    for(int lane = 0; lane < MAX_BOARDS; ++lane)
+    {
+        if(event.boardMask & (1 << lane)) payload += 1 + event.fragments[lane].size();
+    }
+
+    out.push_back(RECORD_MAGIC | ((uint64_t)event.boardMask << 8) | flags);
+    out.push_back(event.eventCount);
+    out.push_back(event.timestamp);
+    out.push_back(payload);
+    for(int lane = 0; lane < MAX_BOARDS; ++lane)
+    {
+        if(!(event.boardMask & (1 << lane))) continue;
+        out.push_back(((uint64_t)lane << 32) | event.fragments[lane].size());
+        out.insert(out.end(), event.fragments[lane].begin(), event.fragments[lane].end());
+    }
+}
+
+bool EventBuilder::matches(const OpenEvent& open, uint32_t eventCount, uint64_t timestamp) const
+{
+    if(options_.matchEventCount && open.eventCount != eventCount) return false;
+    uint64_t diff = open.timestamp > timestamp ? open.timestamp - timestamp : timestamp - open.timestamp;
+    return diff <= options_.timestampTolerance;
+}
+
+bool EventBuilder::add(int lane, span<const uint64_t> event)
+{
+    uint32_t eventCount;
+    uint64_t timestamp;
+    if(lane < 0 || lane >= nLanes_ || !extractKey(event, eventCount, timestamp))
+    {
+        ++stats_.nBadFragments;
+        return false;
+    }
+    ++stats_.nFragments;
+
+    poll();
+
+    //oldest open event still missing this lane with a matching key
+    size_t index = open_.size();
+    for(size_t i = 0; i < open_.size(); ++i)
+    {
+        if(open_[i].fragment[lane] < 0 && matches(open_[i], eventCount, timestamp))
+        {
+            index = i;
+            break;
+        }
+    }
+
+    if(index == open_.size())
+    {
+        //make room: the reorder buffer is full, or (with a broken stream) no buffer is left
+        while(!open_.empty() && (open_.size() >= options_.reorderDepth || freeBuffers_.empty())) emit(0, false);
+
+        OpenEvent newEvent;
+        newEvent.eventCount = eventCount;
+        newEvent.timestamp = timestamp;
+        newEvent.created = chrono::steady_clock::now();
+        for(int i = 0; i < MAX_BOARDS; ++i) newEvent.fragment[i] = -1;
+        newEvent.nPresent = 0;
+        open_.push_back(newEvent);
+        index = open_.size() - 1;
+    }
+
+    int buffer = freeBuffers_.back();
+    freeBuffers_.pop_back();
+    pool_[buffer].assign(event.begin(), event.end());
+
+    OpenEvent& open = open_[index];
+    open.fragment[lane] = buffer;
+    ++open.nPresent;
+    if(open.nPresent == nLanes_) emit(index, false);
+    return true;
+}
+
+void EventBuilder::poll()
+{
+    if(open_.empty()) return;
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now() - options_.timeout;
+    while(!open_.empty() && open_.front().created < deadline) emit(0, true);
+}
+
+void EventBuilder::flush()
+{
+    while(!open_.empty()) emit(0, true);
+}
+
+//hands the event to the callback and recycles its fragments
+void EventBuilder::emit(size_t index, bool timedOut)
+{
+    OpenEvent& open = open_[index];
+
+    BuiltEvent event;
+    event.eventCount = open.eventCount;
+    event.timestamp = open.timestamp;
+    event.boardMask = 0;
+    event.complete = open.nPresent == nLanes_;
+    event.timedOut = !event.complete && timedOut;
+    for(int lane = 0; lane < nLanes_; ++lane)
+    {
+        if(open.fragment[lane] < 0) continue;
+        event.boardMask |= 1 << lane;
+        event.fragments[lane] = span<const uint64_t>(pool_[open.fragment[lane]]);
+    }
+
+    if(event.complete) ++stats_.nComplete;
+    else if(event.timedOut) ++stats_.nTimedOut;
+    else ++stats_.nOverflow;
+
+    if(callback_) callback_(event);
+
+    for(int lane = 0; lane < nLanes_; ++lane)
+    {
+        if(open.fragment[lane] >= 0) freeBuffers_.push_back(open.fragment[lane]);
+    }
+    open_.erase(open_.begin() + index);
+}
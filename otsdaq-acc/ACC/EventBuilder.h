@@ -0,0 +1,122 @@
+#ifndef _EVENTBUILDER_H_INCLUDED
+#define _EVENTBUILDER_H_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+#include "AccPacket.h"
+
+using namespace std;
+
+//Builds multi-board events online from the per-board ACDC events. Board
+//events (fragments) are matched by the ACDC event counter and the
+//hardware timestamp, which have to agree within a tolerance window. Both
+//come from the event header (see AccEventFormat), fragments without the
+//ACDC header marker are rejected.
+//Fragments wait in a bounded reorder buffer until every board delivered
+//its part; events still missing boards are emitted as incomplete once
+//they exceed the timeout or the reorder buffer is full. Fragment storage
+//is preallocated and recycled. Not thread safe, meant to be fed from the
+//receiving thread.
+class EventBuilder
+{
+public:
+    static constexpr int MAX_BOARDS = 8;
+
+    //ACDC event header words used as event key
+    static constexpr int EVENT_COUNT_WORD = AccEventFormat::EVENT_COUNT_WORD; //bits 31-0: event counter
+    static constexpr int TIMESTAMP_WORD = AccEventFormat::TIMESTAMP_WORD;     //64 bit system clock timestamp
+    static constexpr int HEADER_WORDS = AccEventFormat::HEADER_WORDS;
+
+    //Serialized built event, see serialize()
+    static constexpr uint64_t RECORD_MAGIC = 0xEB1D000000000000;
+    static constexpr uint64_t RECORD_COMPLETE = 0x1;
+    static constexpr uint64_t RECORD_TIMED_OUT = 0x2;
+
+    class Options
+    {
+    public:
+        Options();
+
+        uint64_t timestampTolerance; //clock ticks two fragments of one event may differ by
+        bool matchEventCount;        //fragments also need equal event counters
+        size_t reorderDepth;         //open events held before the oldest is emitted incomplete
+        chrono::microseconds timeout; //age after which an open event is emitted incomplete
+    };
+
+    class Stats
+    {
+    public:
+        Stats() : nFragments(0), nBadFragments(0), nComplete(0), nTimedOut(0), nOverflow(0) {}
+
+        uint64_t nFragments;    //fragments accepted by add()
+        uint64_t nBadFragments; //fragments without an ACDC header
+        uint64_t nComplete;     //events with all boards
+        uint64_t nTimedOut;     //incomplete events emitted after the timeout
+        uint64_t nOverflow;     //incomplete events emitted because the reorder buffer was full
+    };
+
+    //One built event, only valid during the callback
+    class BuiltEvent
+    {
+    public:
+        uint32_t eventCount;
+        uint64_t timestamp;         //timestamp of the first fragment
+        unsigned int boardMask;     //lanes present, bit i = lane i
+        bool complete;
+        bool timedOut;              //incomplete and emitted because of the timeout (else because of overflow)
+        span<const uint64_t> fragments[MAX_BOARDS]; //per lane, empty if missing
+    };
+
+    typedef function<void(const BuiltEvent& event)> Callback;
+
+    EventBuilder();
+
+    //----------local set functions
+    void setCallback(const Callback& callback) {callback_ = callback;}
+
+    //----------control
+    void start(int nLanes, const Options& options = Options()); //drops everything still open
+    void flush(); //emits all open events, incomplete ones as timed out
+
+    //----------data input
+    bool add(int lane, span<const uint64_t> event); //copies the fragment, false if it is unusable
+    void poll(); //emits open events older than the timeout, also done by add()
+
+    //----------local return functions
+    static bool extractKey(span<const uint64_t> event, uint32_t& eventCount, uint64_t& timestamp); //false if event has no ACDC header
+
+    //appends one record to out:
+    //  word 0: RECORD_MAGIC | boardMask << 8 | flags (RECORD_COMPLETE, RECORD_TIMED_OUT)
+    //  word 1: event count, word 2: timestamp, word 3: number of words that follow
+    //  per present lane, ascending: lane << 32 | fragment words, then the fragment
+    static void serialize(const BuiltEvent& event, vector<uint64_t>& out);
+    int getNumLanes() const {return nLanes_;}
+    size_t getNumOpen() const {return open_.size();}
+    Stats getStats() const {return stats_;}
+
+private:
+    struct OpenEvent
+    {
+        uint32_t eventCount;
+        uint64_t timestamp;
+        chrono::steady_clock::time_point created;
+        int fragment[MAX_BOARDS]; //pool index per lane, -1 if missing
+        int nPresent;
+    };
+
+    bool matches(const OpenEvent& open, uint32_t eventCount, uint64_t timestamp) const;
+    void emit(size_t index, bool timedOut);
+
+    Options options_;
+    Callback callback_;
+    int nLanes_;
+    vector<OpenEvent> open_;           //oldest first
+    vector<vector<uint64_t>> pool_;    //fragment buffers
+    vector<int> freeBuffers_;
+    Stats stats_;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include "FeatureExtractor.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define ACC_FEATURE_SSE2 1
+#endif
+
+using namespace std;
+
+FeatureExtractor::Options::Options() :
+    polarity(-1),
+    baselineSamples(16),
+    chargePre(5),
+    chargePost(15),
+    timing(CONSTANT_FRACTION),
+    cfdFraction(0.5),
+    leadingEdgeThreshold(20),
+    hitThreshold(20)
+{
+}
+
+FeatureExtractor::FeatureExtractor()
+{
+    fill(nPresent_, nPresent_ + NUM_CH, 0);
+    for(int s = 0; s < NUM_SAMP; ++s) fill(x_[s], x_[s] + NUM_LANES, 0.f);
+}
+
+//absent samples become -infinity, which stays below any peak after the baseline subtraction
+template<class T>
+void FeatureExtractor::transpose(const T (&samples)[NUM_CH][NUM_SAMP], size_t nSamples)
+{
+    const float sign = options_.polarity < 0 ? -1.f : 1.f;
+    for(int ch = 0; ch < NUM_CH; ++ch)
+    {
+        int n = Waveforms::channelSamples(ch, nSamples);
+        nPresent_[ch] = n;
+        for(int s = 0; s < n; ++s) x_[s][ch] = sign*samples[ch][s];
+        for(int s = n; s < NUM_SAMP; ++s) x_[s][ch] = -numeric_limits<float>::infinity();
+    }
+}
+
+int FeatureExtractor::extract(const Waveforms& waveforms, int board, uint32_t eventCount, vector<ChannelHit>& hits, size_t nSamples)
+{
+    transpose(waveforms.samples, nSamples);
+    return process(board, eventCount, hits);
+}
+
+int FeatureExtractor::extract(const CalibratedWaveforms& waveforms, int board, uint32_t eventCount, vector<ChannelHit>& hits, size_t nSamples)
+{
+    transpose(waveforms.mV, nSamples);
+    return process(board, eventCount, hits);
+}
+
+int FeatureExtractor::process(int board, uint32_t eventCount, vector<ChannelHit>& hits)
+{
+    alignas(64) float baseline[NUM_LANES], peak[NUM_LANES], peakSample[NUM_LANES], charge[NUM_LANES], time[NUM_LANES];
+
+    //baseline, from the samples present only
+    int nBaseline = min(max(options_.baselineSamples, 1), NUM_SAMP);
+    fill(baseline, baseline + NUM_LANES, 0.f);
+    for(int s = 0; s < nBaseline; ++s)
+    {
+        for(int ch = 0; ch < NUM_CH; ++ch) baseline[ch] += s < nPresent_[ch] ? x_[s][ch] : 0.f;
+    }
+    for(int ch = 0; ch < NUM_CH; ++ch) baseline[ch] *= nPresent_[ch] > 0 ? 1.f/min(nBaseline, nPresent_[ch]) : 0.f;
+
+    //subtract the baseline in place and find the peak
+    fill(peak, peak + NUM_LANES, -1e30f);
+    fill(peakSample, peakSample + NUM_LANES, 0.f);
+#ifdef ACC_FEATURE_SSE2
+    //explicit SSE2, the compiler does not if-convert the loop at -O2
+    for(int s = 0; s < NUM_SAMP; ++s)
+    {
+        __m128 fs = _mm_set1_ps(s);
+        for(int ch = 0; ch < NUM_LANES; ch += 4)
+        {
+            __m128 x = _mm_sub_ps(_mm_load_ps(x_[s] + ch), _mm_load_ps(baseline + ch));
+            _mm_store_ps(x_[s] + ch, x);
+            __m128 p = _mm_load_ps(peak + ch);
+            __m128 higher = _mm_cmpgt_ps(x, p);
+            _mm_store_ps(peak + ch, _mm_max_ps(x, p));
+            _mm_store_ps(peakSample + ch, _mm_or_ps(_mm_and_ps(higher, fs), _mm_andnot_ps(higher, _mm_load_ps(peakSample + ch))));
+        }
+    }
+#else
+    for(int s = 0; s < NUM_SAMP; ++s)
+    {
+        float* x = x_[s];
+        for(int ch = 0; ch < NUM_LANES; ++ch)
+        {
+            x[ch] -= baseline[ch];
+            bool higher = x[ch] > peak[ch];
+            peak[ch] = higher ? x[ch] : peak[ch];
+            peakSample[ch] = higher ? (float)s : peakSample[ch];
+        }
+    }
+#endif
+
+    //charge in the window around the peak and timing from the last threshold crossing before the peak,
+    //both only touch a few samples per channel
+    for(int ch = 0; ch < NUM_CH; ++ch)
+    {
+        if(nPresent_[ch] == 0) continue;
+        int ps = peakSample[ch];
+        int first = max(ps - options_.chargePre, 0);
+        int last = min(ps + options_.chargePost, nPresent_[ch] - 1);
+        charge[ch] = 0;
+        for(int s = first; s <= last; ++s) charge[ch] += x_[s][ch];
+
+        float threshold = options_.timing == CONSTANT_FRACTION ? options_.cfdFraction*peak[ch] : options_.leadingEdgeThreshold;
+        time[ch] = -1;
+        int s = ps;
+        while(s > 0 && x_[s - 1][ch] >= threshold) --s;
+        if(s > 0 && x_[s][ch] >= threshold)
+        {
+            float previous = x_[s - 1][ch];
+            time[ch] = s - 1 + (threshold - previous)/(x_[s][ch] - previous);
+        }
+    }
+
+    int nHits = 0;
+    for(int ch = 0; ch < NUM_CH; ++ch)
+    {
+        if(nPresent_[ch] == 0 || peak[ch] < options_.hitThreshold) continue;
+        ChannelHit hit;
+        hit.eventCount = eventCount;
+        hit.board = board;
+        hit.channel = ch;
+        hit.peakSample = peakSample[ch];
+        hit.flags = time[ch] >= 0 ? ChannelHit::TIME_VALID : 0;
+        hit.baseline = options_.polarity < 0 ? -baseline[ch] : baseline[ch];
+        hit.amplitude = peak[ch];
+        hit.charge = charge[ch];
+        hit.time = time[ch];
+        hits.push_back(hit);
+        ++nHits;
+    }
+    return nHits;
+}
@@ -0,0 +1,88 @@
+#ifndef _FEATUREEXTRACTOR_H_INCLUDED
+#define _FEATUREEXTRACTOR_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+#include "WaveformCalibration.h"
+#include "Waveforms.h"
+
+using namespace std;
+
+//One channel with a pulse, the compact output of FeatureExtractor.
+//Amplitude, baseline and charge are in the units of the input (ADC
+//counts or mV), charge is the sum over the integration window and time
+//is in samples.
+struct ChannelHit
+{
+    static constexpr uint8_t TIME_VALID = 0x1; //the timing threshold was crossed before the peak
+
+    uint32_t eventCount;
+    uint8_t board;
+    uint8_t channel;
+    uint8_t peakSample;
+    uint8_t flags;
+    float baseline;
+    float amplitude; //baseline subtracted, in pulse polarity (positive)
+    float charge;
+    float time;
+};
+static_assert(sizeof(ChannelHit) == 24);
+
+//Extracts baseline, peak, charge and timing of all channels of one event.
+//The samples are transposed to sample-major order first (channels padded
+//to 32), so the passes over all samples (baseline, peak search) work on
+//the channels of one sample in parallel; charge and timing then only
+//look at the samples around each peak. Only channels whose amplitude
+//passes hitThreshold produce a ChannelHit. The ACC sends fewer samples
+//than NUM_CH*NUM_SAMP: only the nSamples present in the event are used,
+//absent channels never produce a hit. Not thread safe, use one per
+//board.
+class FeatureExtractor
+{
+public:
+    static constexpr int NUM_LANES = 32; //NUM_CH padded to full vectors
+
+    enum TimingMode
+    {
+        CONSTANT_FRACTION, //crossing of cfdFraction*amplitude
+        LEADING_EDGE       //crossing of leadingEdgeThreshold
+    };
+
+    class Options
+    {
+    public:
+        Options();
+
+        int polarity;               //-1 for negative pulses
+        int baselineSamples;        //first samples averaged for the baseline
+        int chargePre;              //integration window around the peak sample
+        int chargePost;
+        TimingMode timing;
+        float cfdFraction;
+        float leadingEdgeThreshold; //baseline subtracted, in pulse polarity
+        float hitThreshold;         //minimum amplitude of a hit
+    };
+
+    FeatureExtractor();
+
+    //----------local set functions
+    void setOptions(const Options& options) {options_ = options;}
+
+    //----------extraction of the first nSamples samples (see ACDC::getNumSamples()), hits are appended, returns the number of hits
+    int extract(const Waveforms& waveforms, int board, uint32_t eventCount, vector<ChannelHit>& hits, size_t nSamples = NUM_CH*NUM_SAMP); //ADC counts
+    int extract(const CalibratedWaveforms& waveforms, int board, uint32_t eventCount, vector<ChannelHit>& hits, size_t nSamples = NUM_CH*NUM_SAMP); //mV
+
+    //----------local return functions
+    const Options& getOptions() const {return options_;}
+
+private:
+    template<class T>
+    void transpose(const T (&samples)[NUM_CH][NUM_SAMP], size_t nSamples);
+    int process(int board, uint32_t eventCount, vector<ChannelHit>& hits);
+
+    Options options_;
+    int nPresent_[NUM_CH]; //samples of each channel in the event
+    alignas(64) float x_[NUM_SAMP][NUM_LANES]; //samples in pulse polarity, -infinity where absent | index: sample, channel
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef _LOGRATELIMITER_H_INCLUDED
+#define _LOGRATELIMITER_H_INCLUDED
+
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+//Decides which messages of a repeating kind get logged: the first few,
+//then at most one per interval. Messages held back in between are
+//counted, so the next logged one can say how many were skipped.
+//Not thread safe, meant for the thread that produces the messages.
+class LogRateLimiter
+{
+public:
+    explicit LogRateLimiter(unsigned int burst = 10, chrono::steady_clock::duration interval = chrono::seconds(10)) :
+        burst_(burst), interval_(interval)
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        nLogged_ = 0;
+        nSuppressed_ = 0;
+        nSkipped_ = 0;
+        last_ = chrono::steady_clock::time_point();
+    }
+
+    //true if this message should be logged
+    bool allow()
+    {
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if(nLogged_ < burst_ || now - last_ >= interval_)
+        {
+            ++nLogged_;
+            last_ = now;
+            return true;
+        }
+        ++nSuppressed_;
+        ++nSkipped_;
+        return false;
+    }
+
+    //messages held back since the last logged one, call after allow() returned true
+    uint64_t takeSkipped()
+    {
+        uint64_t n = nSkipped_;
+        nSkipped_ = 0;
+        return n;
+    }
+
+    uint64_t getNLogged() const {return nLogged_;}
+    uint64_t getNSuppressed() const {return nSuppressed_;}
+
+private:
+    uint64_t burst_;
+    chrono::steady_clock::duration interval_;
+    uint64_t nLogged_;
+    uint64_t nSuppressed_; //since reset()
+    uint64_t nSkipped_;    //since the last logged message
+    chrono::steady_clock::time_point last_;
+};
+
+#endif
@@ -8,15 +8,21 @@
 #include <iomanip>
 #include <numeric>
 #include <ctime>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ACC_META_X86 1
+#endif
 
 using namespace std;
 
-Metadata::Metadata()
+Metadata::Metadata() : metaValid(false), metaBuilt(false), decodedBuilt(false), firstStartHint(-1)
 {
 	//initializeMetadataKeys();
 }
 
-Metadata::Metadata(vector<unsigned short> acdcBuffer)
+Metadata::Metadata(vector<unsigned short> acdcBuffer) : metaValid(false), metaBuilt(false), decodedBuilt(false), firstStartHint(-1)
 {
     (void)acdcBuffer;
 	//initializeMetadataKeys();
@@ -43,16 +49,31 @@ void Metadata::setBoardAndEvent(unsigned short board, int event)
 
 int Metadata::getEventNumber()
 {
-    return -1;
+    if(!metaValid) return -1;
+    return (int)getDecodedMeta().eventCount;
+}
+
+const AcdcDecodedMeta& Metadata::getDecodedMeta()
+{
+    if(!decodedBuilt)
+    {
+        if(metaValid) decode(eventMeta, decodedMeta);
+        else decodedMeta = AcdcDecodedMeta();
+        decodedBuilt = true;
+    }
+    return decodedMeta;
 }
 
-//takes the full acdcBuffer as input. 
-//splits it into a map[key][vector<unsigned short>]
-//which is then parsed and organized in this class. 
+//parses the metadata of one psec buffer into eventMeta in a single pass.
+//Every chip block is start word, 13 info words and end word; blocks are at
+//least 6*256+15 words apart, so after the first start word the next one is
+//searched from there on (normally found on the first compare). Start words
+//that show up inside the info words are skipped that way as well.
 //Returns:
-//false if a corrupt buffer happened
-//true if all good. 
-int Metadata::parseBuffer(vector<unsigned short> buffer, unsigned short bi)
+//0 if all good
+//-1 for an empty buffer
+//-2 if a corrupt buffer happened
+int Metadata::parseBuffer(span<const unsigned short> buffer, unsigned short bi)
 {
 	//Catch empty buffers
 	if(buffer.size() == 0)
@@ -61,120 +82,244 @@ int Metadata::parseBuffer(vector<unsigned short> buffer, unsigned short bi)
 		return -1;
 	}
 
- 	//Prepare the Metadata vector | global vector vector<unsigned short> meta 
-	meta.clear();
+	metaValid = false;
+	metaBuilt = false;
+	decodedBuilt = false;
 
-	//Helpers
-	int DistanceFromZero;
-	int chip_count = 0;
-	
 	//Indicator words for the start/end of the metadata
 	const unsigned short startword = 0xBA11; 
-	unsigned short endword = 0xFACE; 
-    	unsigned short endoffile = 0x4321;
-
-	//Empty metadata map for each Psec chip <PSEC #, vector with information>
-	map<int, vector<unsigned short>> PsecInfo;
+	const unsigned short endword = 0xFACE; 
+	const unsigned short endoffile = 0x4321;
+	const int minStride = NUM_CH_PER_PSEC*256 + NUM_INFO_WORDS + 2; //closest distance of two start words
+	const int combinedTrigIndex = 7792;
+
+	const unsigned short* buf = buffer.data();
+	const int size = (int)buffer.size();
+
+	//Find the start words, the first one where it was in the previous buffer if possible
+	for(int chip = 0; chip < NUM_PSEC; chip++) eventMeta.startIndex[chip] = -1;
+	int from = 0;
+	for(int chip = 0; chip < NUM_PSEC; chip++)
+	{
+		int pos = from;
+		if(chip == 0 && firstStartHint >= 0 && firstStartHint < size && buf[firstStartHint] == startword) pos = firstStartHint;
+		while(pos < size && buf[pos] != startword) ++pos;
+		if(pos + NUM_INFO_WORDS >= size) 
+		{
+			pos = -1;
+		}
+		eventMeta.startIndex[chip] = pos;
+		if(pos < 0) break;
+		from = pos + minStride;
+	}
 
-	//Empty trigger metadata map for each Psec chip <PSEC #, vector with trigger>
-	map<int, vector<unsigned short>> PsecTriggerInfo;
-	unsigned short CombinedTriggerRateCount;
+	//Last case emergency stop if metadata is still not quite right
+	int triggerStart = eventMeta.startIndex[NUM_PSEC - 1] + NUM_INFO_WORDS + 2;
+	if(eventMeta.startIndex[NUM_PSEC - 1] < 0 || triggerStart + NUM_CH > size || combinedTrigIndex >= size)
+	{
+		firstStartHint = -1;
+		string fnnn = "meta-corrupt-psec-buffer.txt";
+		cout << "Printing to file : " << fnnn << endl;
+		ofstream cb(fnnn);
+		for(unsigned short k: buffer)
+		{
+			cb << hex << k << endl;
+		}
+		return -2;
+	}
+	firstStartHint = eventMeta.startIndex[0];
 
-	//Empty vector with positions of aboves startword
-	vector<int> start_indices; 
+	eventMeta.board = bi;
 
-	//Find the startwords and write them to the vector
-	vector<unsigned short>::iterator bit;
-	for(bit = buffer.begin(); bit != buffer.end(); ++bit)
+	//Copy the info words, a block ending early is padded with zeros
+	for(int chip = 0; chip < NUM_PSEC; chip++)
 	{
-        	if(*bit == startword)
-        	{
-        		DistanceFromZero= std::distance(buffer.begin(), bit);
-        		start_indices.push_back(DistanceFromZero);
-        	}
+		const unsigned short* info = buf + eventMeta.startIndex[chip] + 1;
+		int n = 0;
+		while(n < NUM_INFO_WORDS && info[n] != endword && info[n] != endoffile)
+		{
+			eventMeta.info[chip][n] = info[n];
+			++n;
+		}
+		for(; n < NUM_INFO_WORDS; ++n) eventMeta.info[chip][n] = 0;
 	}
 
-	//Filter in cases where one of the start words is found in the metadata 
-	if(start_indices.size()>NUM_PSEC)
+	//Trigger data at last_metadata_start + 13_info_words + 1_end_word + 1
+	for(int chip = 0; chip < NUM_PSEC; chip++)
 	{
-		for(int k=0; k<(int)start_indices.size()-1; k++)
+		for(int ch = 0; ch < NUM_CH_PER_PSEC; ch++)
 		{
-		    	if(start_indices[k+1]-start_indices[k]>6*256+14)
-		    	{
-				//nothing
-		    	}else
-		    	{
-				start_indices.erase(start_indices.begin()+(k+1));
-				k--;
-		    	}
+			eventMeta.selfTrigRate[chip][ch] = buf[triggerStart + ch + chip*NUM_CH_PER_PSEC];
 		}
 	}
 
-	//Last case emergency stop if metadata is still not quite right
-	if(start_indices.size() != NUM_PSEC)
+	//Fill the combined trigger
+	eventMeta.combinedTrigRate = buf[combinedTrigIndex];
+
+	metaValid = true;
+	return 0;
+}
+
+//builds the legacy metadata vector from eventMeta:
+//board, then per chip 0xDCB0|chip, 13 info words and 6 trigger words, 
+//then the combined trigger rate and 0xeeee
+vector<unsigned short> Metadata::getMetadata()
+{
+	if(!metaValid) 
 	{
-        	string fnnn = "meta-corrupt-psec-buffer.txt";
-        	cout << "Printing to file : " << fnnn << endl;
-        	ofstream cb(fnnn);
-        	for(unsigned short k: buffer)
-        	{
-            		cb << hex << k << endl;
-        	}
-        	return -2;
+		meta.clear();
+		return meta;
 	}
-
-	//Fill the psec info map
-	for(int i: start_indices)
+	if(!metaBuilt)
 	{
-		//Write the first word after the startword
-		bit = buffer.begin() + (i+1);
-
-		//As long as the endword isn't reached copy metadata words into a vector and add to map
-		vector<unsigned short> InfoWord;
-		while(*bit != endword && *bit != endoffile && InfoWord.size() < 14)
+		meta.clear();
+		meta.reserve(1 + NUM_PSEC*(1 + NUM_INFO_WORDS + NUM_CH_PER_PSEC) + 2);
+		meta.push_back(eventMeta.board);
+		for(int CHIP=0; CHIP<NUM_PSEC; CHIP++)
 		{
-			InfoWord.push_back(*bit);
-			++bit;
+			meta.push_back((0xDCB0 | CHIP));
+			meta.insert(meta.end(), eventMeta.info[CHIP], eventMeta.info[CHIP] + NUM_INFO_WORDS);
+			meta.insert(meta.end(), eventMeta.selfTrigRate[CHIP], eventMeta.selfTrigRate[CHIP] + NUM_CH_PER_PSEC);
 		}
-		PsecInfo.insert(pair<int, vector<unsigned short>>(chip_count, InfoWord));
-		chip_count++;
+		meta.push_back(eventMeta.combinedTrigRate);
+		meta.push_back(0xeeee);
+		metaBuilt = true;
 	}
+	return meta;
+}
+
 
-	//Fill the psec trigger info map
-	for(int chip=0; chip<NUM_PSEC; chip++)
+//----------decoding of the metadata words, field layout see initializeMetadataKeys
+namespace
+{
+//everything except the multi-word counters
+void decodeSettings(const AcdcEventMeta& in, AcdcDecodedMeta& out)
+{
+	out.board = in.board;
+	for(int chip = 0; chip < NUM_PSEC; chip++)
 	{
-	    for(int ch=0; ch<NUM_CH/NUM_PSEC; ch++)
-	    {
-	    	//Find the trigger data at begin + last_metadata_start + 13_info_words + 1_end_word + 1 
-	        bit = buffer.begin() + start_indices[4] + 13 + 1 + 1 + ch + (chip*(NUM_CH/NUM_PSEC));
-	        PsecTriggerInfo[chip].push_back(*bit);
-	    }
+		const unsigned short* info = in.info[chip];
+		out.feedbackCount[chip] = info[0];
+		out.feedbackTargetCount[chip] = info[1];
+		out.vbias[chip] = info[2];
+		out.selfTrigThresholdSetting[chip] = info[3];
+		out.proVdd[chip] = info[4];
+		out.selfTrigMask[chip] = info[6];
+		out.selfTrigThreshold[chip] = info[7] & 0xfff;
+		out.dllVdd[chip] = info[12];
+		for(int ch = 0; ch < NUM_CH_PER_PSEC; ch++) out.selfTrigRate[NUM_CH_PER_PSEC*chip + ch] = in.selfTrigRate[chip][ch];
 	}
 
-	//Fill the combined trigger
-	CombinedTriggerRateCount = buffer[7792];
+	unsigned short trig1 = in.info[1][5];
+	unsigned short trig3 = in.info[3][5];
+	out.triggerMode = trig1 & 0xf;
+	out.validationWindowStart = (trig1 >> 4) & 0xfff;
+	out.validationWindowLength = in.info[2][5] & 0xfff;
+	out.smaDetectionMode = trig3 & 0x1;
+	out.smaInvert = (trig3 >> 1) & 0x1;
+	out.accDetectionMode = (trig3 >> 2) & 0x1;
+	out.accInvert = (trig3 >> 3) & 0x1;
+	out.selfDetectionMode = (trig3 >> 4) & 0x1;
+	out.selfSign = (trig3 >> 5) & 0x1;
+	out.selfCoin = (trig3 >> 6) & 0x1f;
+	out.clockCycleBits = in.info[0][8] & 0x7;
+	out.combinedTrigRate = in.combinedTrigRate;
+}
+
+#ifdef ACC_META_X86
+//16 bit word at byteOffset of 8 consecutive AcdcEventMeta, zero extended to 32 bit lanes
+__attribute__((target("avx2")))
+inline __m256i gatherWord(const AcdcEventMeta* events, size_t byteOffset)
+{
+	const __m256i offsets = _mm256_setr_epi32(0, 1*sizeof(AcdcEventMeta), 2*sizeof(AcdcEventMeta), 3*sizeof(AcdcEventMeta),
+	                                          4*sizeof(AcdcEventMeta), 5*sizeof(AcdcEventMeta), 6*sizeof(AcdcEventMeta), 7*sizeof(AcdcEventMeta));
+	//reads 4 bytes, the word and the one after it, which is always inside the struct for info words
+	__m256i words = _mm256_i32gather_epi32((const int*)((const char*)events + byteOffset), offsets, 1);
+	return _mm256_and_si256(words, _mm256_set1_epi32(0xffff));
+}
 
-	//----------------------------------------------------------
+//lo | hi << 16 of the info words lo/hi of 8 events
+__attribute__((target("avx2")))
+inline __m256i gatherCounter32(const AcdcEventMeta* events, int chipLo, int wordLo, int chipHi, int wordHi)
+{
+	__m256i lo = gatherWord(events, offsetof(AcdcEventMeta, info) + sizeof(unsigned short)*(NUM_INFO_WORDS*chipLo + wordLo));
+	__m256i hi = gatherWord(events, offsetof(AcdcEventMeta, info) + sizeof(unsigned short)*(NUM_INFO_WORDS*chipHi + wordHi));
+	return _mm256_or_si256(lo, _mm256_slli_epi32(hi, 16));
+}
+#endif
+}
+
+void Metadata::decode(const AcdcEventMeta& in, AcdcDecodedMeta& out)
+{
+	decodeSettings(in, out);
+	out.timestamp = (uint64_t)in.info[0][8] | ((uint64_t)in.info[1][8] << 16) | ((uint64_t)in.info[2][8] << 32) | ((uint64_t)in.info[3][8] << 48);
+	out.eventCount = (uint32_t)in.info[0][9] | ((uint32_t)in.info[1][9] << 16);
+	for(int chip = 0; chip < NUM_PSEC; chip++) out.vcdlCount[chip] = (uint32_t)in.info[chip][10] | ((uint32_t)in.info[chip][11] << 16);
+}
+
+void Metadata::decodeBatchScalar(span<const AcdcEventMeta> in, span<AcdcDecodedMeta> out)
+{
+	size_t n = min(in.size(), out.size());
+	for(size_t i = 0; i < n; ++i) decode(in[i], out[i]);
+}
 
-  	//Start the metadata parsing 
-	meta.push_back(bi);
-	for(int CHIP=0; CHIP<NUM_PSEC; CHIP++)
+#ifdef ACC_META_X86
+__attribute__((target("avx2")))
+void Metadata::decodeBatchAVX2(span<const AcdcEventMeta> in, span<AcdcDecodedMeta> out)
+{
+	size_t n = min(in.size(), out.size());
+	size_t i = 0;
+	alignas(32) uint64_t timestamp[8];
+	alignas(32) uint32_t eventCount[8];
+	alignas(32) uint32_t vcdlCount[NUM_PSEC][8];
+	for(; i + 8 <= n; i += 8)
 	{
-		meta.push_back((0xDCB0 | CHIP));
-		for(int INFOWORD=0; INFOWORD<13; INFOWORD++)
-		{
-			meta.push_back(PsecInfo[CHIP][INFOWORD]);		
-		}
-		for(int TRIGGERWORD=0; TRIGGERWORD<6; TRIGGERWORD++)
+		const AcdcEventMeta* events = &in[i];
+
+		//timestamp: PSEC0/1 give the low, PSEC2/3 the high 32 bits
+		__m256i tsLo = gatherCounter32(events, 0, 8, 1, 8);
+		__m256i tsHi = gatherCounter32(events, 2, 8, 3, 8);
+		__m256i ts0145 = _mm256_unpacklo_epi32(tsLo, tsHi); //events 0,1 | 4,5
+		__m256i ts2367 = _mm256_unpackhi_epi32(tsLo, tsHi); //events 2,3 | 6,7
+		_mm256_store_si256((__m256i*)timestamp, _mm256_permute2x128_si256(ts0145, ts2367, 0x20));
+		_mm256_store_si256((__m256i*)(timestamp + 4), _mm256_permute2x128_si256(ts0145, ts2367, 0x31));
+
+		_mm256_store_si256((__m256i*)eventCount, gatherCounter32(events, 0, 9, 1, 9));
+		for(int chip = 0; chip < NUM_PSEC; chip++) _mm256_store_si256((__m256i*)vcdlCount[chip], gatherCounter32(events, chip, 10, chip, 11));
+
+		for(int k = 0; k < 8; ++k)
 		{
-			meta.push_back(PsecTriggerInfo[CHIP][TRIGGERWORD]);
+			AcdcDecodedMeta& o = out[i + k];
+			decodeSettings(events[k], o);
+			o.timestamp = timestamp[k];
+			o.eventCount = eventCount[k];
+			for(int chip = 0; chip < NUM_PSEC; chip++) o.vcdlCount[chip] = vcdlCount[chip][k];
 		}
 	}
+	for(; i < n; ++i) decode(in[i], out[i]);
+}
 
-	meta.push_back(CombinedTriggerRateCount);
-	meta.push_back(0xeeee);
-	return 0;
+void Metadata::decodeBatch(span<const AcdcEventMeta> in, span<AcdcDecodedMeta> out)
+{
+	static const bool avx2 = []
+	{
+		__builtin_cpu_init(); //may be called during static initialization
+		return __builtin_cpu_supports("avx2");
+	}();
+	if(avx2) decodeBatchAVX2(in, out);
+	else decodeBatchScalar(in, out);
+}
+#else
+void Metadata::decodeBatchAVX2(span<const AcdcEventMeta> in, span<AcdcDecodedMeta> out)
+{
+	decodeBatchScalar(in, out);
+}
+
+void Metadata::decodeBatch(span<const AcdcEventMeta> in, span<AcdcDecodedMeta> out)
+{
+	decodeBatchScalar(in, out);
 }
+#endif
 
 
 //just makes sure not to insert elements
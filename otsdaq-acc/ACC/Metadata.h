@@ -5,13 +5,68 @@
 #include <map>
 #include <vector>
 #include <fstream>
+#include <span>
+#include <cstdint>
 
 #define NUM_PSEC 5 //maximum number of psec chips on an ACDC board
 #define NUM_CH 30 //maximum number of channels for one ACDC board
 #define NUM_CH_PER_PSEC 6 //maximum number of channels per psec chips
+#define NUM_INFO_WORDS 13 //info words between the start and end word of every psec metadata block
+#ifndef PSECFRAME
+#define PSECFRAME 7696
+#endif
 
 using namespace std;
 
+//Metadata of one ACDC event in a fixed layout, filled by Metadata::parseBuffer
+//without allocating. info[chip][n-1] is "Info n" of the key comments in
+//Metadata.cc, e.g. the event count is info[0][9] (lo) and info[1][9] (hi).
+struct AcdcEventMeta
+{
+	unsigned short board; //board index given to parseBuffer
+	unsigned short info[NUM_PSEC][NUM_INFO_WORDS]; //info words 1-13 of every psec chip
+	unsigned short selfTrigRate[NUM_PSEC][NUM_CH_PER_PSEC]; //self trigger rate count per chip and channel
+	unsigned short combinedTrigRate; //combined trigger rate count
+	int startIndex[NUM_PSEC]; //buffer position of the metadata start word of every chip
+};
+
+//Decoded, typed view of AcdcEventMeta: multi-word counters assembled and
+//packed settings split into fields (see the key comments in Metadata.cc)
+struct AcdcDecodedMeta
+{
+	uint64_t timestamp; //Info 9 of PSEC0-3, PSEC0 holds bit(15-0)
+	uint32_t eventCount; //Info 10, PSEC0 bit(15-0), PSEC1 bit(31-16)
+	uint32_t vcdlCount[NUM_PSEC]; //Info 11 bit(15-0), Info 12 bit(31-16)
+	unsigned short board;
+
+	//----------per chip settings
+	unsigned short feedbackCount[NUM_PSEC]; //Info 1
+	unsigned short feedbackTargetCount[NUM_PSEC]; //Info 2
+	unsigned short vbias[NUM_PSEC]; //Info 3
+	unsigned short selfTrigThresholdSetting[NUM_PSEC]; //Info 4
+	unsigned short proVdd[NUM_PSEC]; //Info 5
+	unsigned short dllVdd[NUM_PSEC]; //Info 13
+	unsigned short selfTrigMask[NUM_PSEC]; //Info 7
+	unsigned short selfTrigThreshold[NUM_PSEC]; //Info 8 bit(11-0)
+
+	//----------trigger settings, Info 6
+	unsigned char triggerMode; //PSEC1 bit(3-0)
+	unsigned short validationWindowStart; //PSEC1 bit(15-4)
+	unsigned short validationWindowLength; //PSEC2 bit(11-0)
+	bool smaDetectionMode; //PSEC3 bit(0)
+	bool smaInvert; //PSEC3 bit(1)
+	bool accDetectionMode; //PSEC3 bit(2)
+	bool accInvert; //PSEC3 bit(3)
+	bool selfDetectionMode; //PSEC3 bit(4)
+	bool selfSign; //PSEC3 bit(5)
+	unsigned char selfCoin; //PSEC3 bit(10-6)
+	unsigned char clockCycleBits; //Info 9 PSEC0 bit(2-0)
+
+	//----------rates
+	unsigned short selfTrigRate[NUM_CH]; //self trigger rate count, channel = NUM_CH_PER_PSEC*chip + chip channel
+	unsigned short combinedTrigRate;
+};
+
 class Metadata
 {
 public:
@@ -20,8 +75,10 @@ public:
 	~Metadata(); //deconstructor
 
 	//----------local return functions
-	int getEventNumber(); //returns the event number
-	vector<unsigned short> getMetadata(){return meta;} //returns the metadata map | metakey < value
+	int getEventNumber(); //returns the event count of the last parsed buffer, -1 if there is none
+	vector<unsigned short> getMetadata(); //returns the metadata vector in the legacy layout, built on first request
+	const AcdcEventMeta& getEventMeta() const {return eventMeta;} //returns the metadata of the last parsed buffer
+	const AcdcDecodedMeta& getDecodedMeta(); //returns the decoded metadata of the last parsed buffer
 	vector<string> getMetaKeys(){return metadata_keys;} //returns the metakeys seperatly
 
 	//----------local set functions
@@ -29,8 +86,14 @@ public:
 
 	//----------parse function for metadata stream
 	void checkAndInsert(string key, unsigned short val); //inserts vals into metadata map.
-	int parseBuffer(vector<unsigned short> buffer, unsigned short bi = 57005); //returns success or fail 1/0 and parses the buffer
+	int parseBuffer(span<const unsigned short> buffer, unsigned short bi = 57005); //returns 0 on success, <0 on a corrupt buffer
 	
+	//----------decode functions, usable without a Metadata object
+	static void decode(const AcdcEventMeta& in, AcdcDecodedMeta& out);
+	static void decodeBatch(span<const AcdcEventMeta> in, span<AcdcDecodedMeta> out); //decodes min(in.size(), out.size()) events, AVX2 if available
+	static void decodeBatchScalar(span<const AcdcEventMeta> in, span<AcdcDecodedMeta> out);
+	static void decodeBatchAVX2(span<const AcdcEventMeta> in, span<AcdcDecodedMeta> out); //gathers the counter words of 8 events at once
+
 	//----------write functions
 	void writeErrorLog(string errorMsg); //writes the errorlog with timestamps
 
@@ -38,6 +101,12 @@ private:
 	//----------all neccessary global variables
 	vector<unsigned short> meta; //var: metadata map | metakeys < value
 	vector<string> metadata_keys; //var: metadata keys
+	AcdcEventMeta eventMeta; //var: metadata of the last parsed buffer
+	bool metaValid; //var: eventMeta holds a parsed buffer
+	bool metaBuilt; //var: meta is up to date with eventMeta
+	AcdcDecodedMeta decodedMeta; //var: decoded eventMeta
+	bool decodedBuilt; //var: decodedMeta is up to date with eventMeta
+	int firstStartHint; //var: position of the first start word in the previous buffer
 
 	//----------general functions
 	void initializeMetadataKeys(); //initilizes the metadata keys
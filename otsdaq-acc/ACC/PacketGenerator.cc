@@ -0,0 +1,158 @@
+#include "PacketGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+PacketGenerator::Options::Options() :
+    boards({0}),
+    pedestal(0x800),
+    noise(3.0),
+    pulseProbability(0.05),
+    pulseAmplitude(400),
+    pulseRise(1.5),
+    pulseDecay(8.0),
+    polarity(-1),
+    poolSize(16),
+    lossProbability(0),
+    lossEvery(0),
+    timestampStep(4000),
+    seed(1)
+{
+}
+
+PacketGenerator::PacketGenerator() : packetID_(0)
+{
+    setOptions(Options());
+}
+
+void PacketGenerator::setOptions(const Options& options)
+{
+    options_ = options;
+    options_.poolSize = max(options_.poolSize, 1);
+    options_.pulseRise = max(options_.pulseRise, 0.01);
+    options_.pulseDecay = max(options_.pulseDecay, 0.01);
+    random_.seed(options_.seed);
+
+    boards_.clear();
+    for(int index : options_.boards)
+    {
+        Board board;
+        board.index = index;
+        fillPool(board);
+        boards_.push_back(std::move(board));
+    }
+    reset();
+}
+
+void PacketGenerator::reset()
+{
+    for(Board& board : boards_)
+    {
+        board.eventCount = 0;
+        board.next = 0;
+    }
+    packetID_ = 0;
+    stats_ = Stats();
+}
+
+//pedestal, gaussian noise and pulses with a fast rise and an exponential tail
+void PacketGenerator::fillPool(Board& board)
+{
+    normal_distribution<double> noise(0, options_.noise);
+    uniform_real_distribution<double> uniform(0, 1);
+    uniform_int_distribution<int> pulseStart(10, NUM_SAMP - 60);
+    vector<uint16_t> samples(NUM_CH*NUM_SAMP);
+
+    board.pool.resize(options_.poolSize);
+    for(vector<uint64_t>& event : board.pool)
+    {
+        for(int ch = 0; ch < NUM_CH; ++ch)
+        {
+            uint16_t* s = samples.data() + ch*NUM_SAMP;
+            int start = uniform(random_) < options_.pulseProbability ? pulseStart(random_) : -1;
+            for(int i = 0; i < NUM_SAMP; ++i)
+            {
+                double value = options_.pedestal + noise(random_);
+                if(start >= 0 && i >= start)
+                {
+                    double t = i - start;
+                    value += options_.polarity*(double)options_.pulseAmplitude*(1 - exp(-t/options_.pulseRise))*exp(-t/options_.pulseDecay);
+                }
+                s[i] = (uint16_t)min(max(lround(value), 0l), 0xfffl);
+            }
+        }
+
+        event.assign(EVENT_WORDS, 0);
+        for(size_t w = 0; w < SAMPLE_WORDS; ++w)
+        {
+            uint64_t word = 0;
+            for(int k = 0; k < 5; ++k) word |= (uint64_t)samples[5*w + k] << (48 - 12*k);
+            event[HEADER_WORDS + w] = word;
+        }
+        event[0] = AccPacketView::EVENT_MAGIC | (board.index & 0xff);
+        event[AccEventFormat::HEADER_END_WORD] = AccEventFormat::HEADER_END_MARKER;
+    }
+}
+
+span<const uint64_t> PacketGenerator::makeEvent(int board)
+{
+    Board* b = nullptr;
+    for(Board& candidate : boards_)
+    {
+        if(candidate.index == board) b = &candidate;
+    }
+    if(!b) return span<const uint64_t>();
+
+    vector<uint64_t>& event = b->pool[b->next];
+    b->next = (b->next + 1) % b->pool.size();
+
+    ++b->eventCount;
+    event[AccEventFormat::EVENT_COUNT_WORD] = AccPacketView::ACDC_HEADER | b->eventCount;
+    event[AccEventFormat::TIMESTAMP_WORD] = b->eventCount*options_.timestampStep;
+    ++stats_.nEvents;
+    return span<const uint64_t>(event);
+}
+
+bool PacketGenerator::losePacket()
+{
+    ++stats_.nPackets;
+    bool lost = options_.lossEvery > 0 && stats_.nPackets % options_.lossEvery == 0;
+    if(!lost && options_.lossProbability > 0) lost = uniform_real_distribution<double>(0, 1)(random_) < options_.lossProbability;
+    if(lost) ++stats_.nLost;
+    return lost;
+}
+
+void PacketGenerator::packetize(span<const uint64_t> event, vector<string>& packets)
+{
+    //the strings of earlier calls are reused, so the steady state does not allocate
+    size_t nPackets = 0;
+    size_t wordsPerPacket = (event.size() + PACKETS_PER_EVENT - 1)/PACKETS_PER_EVENT;
+    for(int i = 0; i < PACKETS_PER_EVENT; ++i)
+    {
+        size_t first = min(i*wordsPerPacket, event.size());
+        size_t n = min(wordsPerPacket, event.size() - first);
+        uint8_t id = packetID_++;
+        if(losePacket()) continue; //the ID is used up, as on a lossy link
+
+        if(nPackets == packets.size()) packets.emplace_back();
+        string& packet = packets[nPackets++];
+        packet.resize(PACKET_HEADER_BYTES + n*sizeof(uint64_t));
+        packet[0] = 0;
+        packet[1] = (char)id;
+        memcpy(&packet[PACKET_HEADER_BYTES], event.data() + first, n*sizeof(uint64_t));
+        stats_.nBytes += packet.size();
+    }
+    packets.resize(nPackets);
+}
+
+uint64_t PacketGenerator::getEventCount(int board) const
+{
+    for(const Board& b : boards_)
+    {
+        if(b.index == board) return b.eventCount;
+    }
+    return 0;
+}
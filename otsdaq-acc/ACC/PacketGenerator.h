@@ -0,0 +1,100 @@
+#ifndef _PACKETGENERATOR_H_INCLUDED
+#define _PACKETGENERATOR_H_INCLUDED
+
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+#include "AccPacket.h"
+#include "Waveforms.h"
+
+using namespace std;
+
+//Synthetic ACDC burst data in the format the ACC streams it, for running
+//the readout chain without hardware. An event of one board has the
+//layout of AccEventFormat: 5 header words followed by the samples packed
+//5 per word (as ACDC::parseDataFromBuffer decodes them), as many as the
+//ACC sends, in 8 UDP packets that each start with a 2 byte header holding
+//the rolling packet ID.
+//
+//Waveforms are a pedestal with gaussian noise and, with a given
+//probability per channel, a pulse. A small pool of events is generated
+//per board up front and cycled, only the header words change between
+//events, so the generator keeps up with the network.
+class PacketGenerator
+{
+public:
+    static constexpr int PACKETS_PER_EVENT = AccEventFormat::PACKETS_PER_EVENT;
+    static constexpr int HEADER_WORDS = AccEventFormat::HEADER_WORDS;
+    static constexpr size_t SAMPLE_WORDS = AccEventFormat::SAMPLE_WORDS;
+    static constexpr size_t EVENT_WORDS = AccEventFormat::EVENT_WORDS;
+    static constexpr size_t PACKET_HEADER_BYTES = 2;
+
+    class Options
+    {
+    public:
+        Options();
+
+        vector<int> boards;      //board indices to generate events for
+        unsigned int pedestal;   //ADC counts
+        double noise;            //rms in ADC counts
+        double pulseProbability; //per channel and event
+        unsigned int pulseAmplitude; //ADC counts
+        double pulseRise;        //rise and decay time constants of the pulses, in samples
+        double pulseDecay;
+        int polarity;            //-1 for negative pulses
+        int poolSize;            //distinct events per board, cycled
+        double lossProbability;  //chance of losing a packet
+        unsigned int lossEvery;  //additionally lose every n-th packet, 0 for none
+        uint64_t timestampStep;  //clock ticks between consecutive events, equal on all boards so events can be built
+        uint64_t seed;
+    };
+
+    class Stats
+    {
+    public:
+        Stats() : nEvents(0), nPackets(0), nLost(0), nBytes(0) {}
+
+        uint64_t nEvents;
+        uint64_t nPackets; //generated, including the lost ones
+        uint64_t nLost;
+        uint64_t nBytes;   //of the packets not lost
+    };
+
+    PacketGenerator();
+
+    //----------local set functions
+    void setOptions(const Options& options); //regenerates the event pools
+    void reset(); //restarts event counters, packet IDs and statistics
+
+    //----------generation
+    span<const uint64_t> makeEvent(int board); //next event of the board, valid until the next call for the same board
+    void packetize(span<const uint64_t> event, vector<string>& packets); //replaces packets by the event's packets that are not lost
+    void makeEventPackets(int board, vector<string>& packets) {packetize(makeEvent(board), packets);}
+
+    //----------local return functions
+    const Options& getOptions() const {return options_;}
+    Stats getStats() const {return stats_;}
+    uint64_t getEventCount(int board) const;
+
+private:
+    struct Board
+    {
+        int index;
+        uint32_t eventCount;
+        size_t next;                    //pool entry used for the next event
+        vector<vector<uint64_t>> pool;
+    };
+
+    void fillPool(Board& board);
+    bool losePacket();
+
+    Options options_;
+    Stats stats_;
+    vector<Board> boards_;
+    uint8_t packetID_;
+    mt19937_64 random_;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "PedestalCalculator.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+namespace
+{
+constexpr char FILE_MAGIC[8] = {'A', 'C', 'C', 'P', 'E', 'D', '\0', '\0'};
+
+struct FileHeader
+{
+    char magic[8];
+    uint32_t version;
+    int32_t boardIndex;
+    uint32_t nChannels;
+    uint32_t nSamples;
+    uint64_t nEvents;
+};
+}
+
+PedestalCalibration::PedestalCalibration() : boardIndex(-1), nEvents(0)
+{
+    memset(mean, 0, sizeof(mean));
+    memset(rms, 0, sizeof(rms));
+}
+
+bool PedestalCalibration::save(const string& fileName) const
+{
+    FileHeader header;
+    memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.version = FILE_VERSION;
+    header.boardIndex = boardIndex;
+    header.nChannels = NUM_CH;
+    header.nSamples = NUM_SAMP;
+    header.nEvents = nEvents;
+
+    ofstream out(fileName, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(mean), sizeof(mean));
+    out.write(reinterpret_cast<const char*>(rms), sizeof(rms));
+    return out.good();
+}
+
+bool PedestalCalibration::load(const string& fileName)
+{
+    ifstream in(fileName, ios::binary);
+    FileHeader header;
+    if(!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if(memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != FILE_VERSION) return false;
+    if(header.nChannels != NUM_CH || header.nSamples != NUM_SAMP) return false;
+    if(!in.read(reinterpret_cast<char*>(mean), sizeof(mean)) || !in.read(reinterpret_cast<char*>(rms), sizeof(rms))) return false;
+    boardIndex = header.boardIndex;
+    nEvents = header.nEvents;
+    return true;
+}
+
+PedestalCalculator::PedestalCalculator()
+{
+    reset();
+}
+
+void PedestalCalculator::reset()
+{
+    nEvents_ = 0;
+    memset(mean_, 0, sizeof(mean_));
+    memset(m2_, 0, sizeof(m2_));
+}
+
+void PedestalCalculator::add(const Waveforms& waveforms)
+{
+    ++nEvents_;
+    const double invN = 1.0/nEvents_;
+    const unsigned short* __restrict x = waveforms.data();
+    double* __restrict mean = mean_;
+    double* __restrict m2 = m2_;
+    for(int i = 0; i < NUM_CELLS; ++i)
+    {
+        double delta = x[i] - mean[i];
+        mean[i] += delta*invN;
+        m2[i] += delta*(x[i] - mean[i]);
+    }
+}
+
+double PedestalCalculator::getRMS(int ch, int cap) const
+{
+    return nEvents_ > 1 ? sqrt(m2_[ch*NUM_SAMP + cap]/(nEvents_ - 1)) : 0;
+}
+
+void PedestalCalculator::getCalibration(PedestalCalibration& calibration) const
+{
+    calibration.nEvents = nEvents_;
+    for(int ch = 0; ch < NUM_CH; ++ch)
+    {
+        for(int cap = 0; cap < NUM_SAMP; ++cap)
+        {
+            calibration.mean[ch][cap] = getMean(ch, cap);
+            calibration.rms[ch][cap] = getRMS(ch, cap);
+        }
+    }
+}
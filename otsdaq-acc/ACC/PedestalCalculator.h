@@ -0,0 +1,61 @@
+#ifndef _PEDESTALCALCULATOR_H_INCLUDED
+#define _PEDESTALCALCULATOR_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include "Waveforms.h"
+
+using namespace std;
+
+//Per channel and capacitor pedestals of one ACDC board: mean and RMS in
+//ADC counts. The ACDC reads out the whole capacitor ring of every chip,
+//so the sample index of the waveforms is the capacitor.
+//
+//Calibration file (binary, little endian): "ACCPED\0\0", version (uint32),
+//board index (int32), channels (uint32), samples (uint32), events
+//(uint64), then NUM_CH*NUM_SAMP means and as many RMS values (float).
+class PedestalCalibration
+{
+public:
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    PedestalCalibration();
+
+    //----------file I/O, both return false if the file cannot be used
+    bool save(const string& fileName) const;
+    bool load(const string& fileName);
+
+    int boardIndex;
+    uint64_t nEvents; //events the pedestals were computed from
+    alignas(64) float mean[NUM_CH][NUM_SAMP];
+    alignas(64) float rms[NUM_CH][NUM_SAMP];
+};
+
+//Running pedestal mean and RMS of every capacitor (Welford's algorithm),
+//fed with the events of a software-trigger run. The sums are kept as flat
+//structure-of-arrays, so the update of all NUM_CH*NUM_SAMP cells is one
+//loop the compiler vectorizes. Not thread safe, use one per board.
+class PedestalCalculator
+{
+public:
+    static constexpr int NUM_CELLS = NUM_CH*NUM_SAMP;
+
+    PedestalCalculator();
+
+    //----------control
+    void reset();
+    void add(const Waveforms& waveforms);
+
+    //----------local return functions
+    uint64_t getNumEvents() const {return nEvents_;}
+    double getMean(int ch, int cap) const {return mean_[ch*NUM_SAMP + cap];}
+    double getRMS(int ch, int cap) const;
+    void getCalibration(PedestalCalibration& calibration) const; //boardIndex is left to the caller
+
+private:
+    uint64_t nEvents_;
+    alignas(64) double mean_[NUM_CELLS];
+    alignas(64) double m2_[NUM_CELLS]; //sum of squared deviations from the mean
+};
+
+#endif
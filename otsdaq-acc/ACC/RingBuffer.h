@@ -0,0 +1,336 @@
+#ifndef _RINGBUFFER_H_INCLUDED
+#define _RINGBUFFER_H_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+//Lock-free bounded ring buffers replacing BlockingQueue.
+//
+//SPSCRingBuffer: one producer thread, one consumer thread.
+//MPMCRingBuffer: any number of producers and consumers (per-slot sequence
+//                numbers, D. Vyukov's bounded queue).
+//
+//push()/pop() never block and return false if the ring is full/empty.
+//pushWait()/popWait() block according to the ring's RingWaitStrategy and
+//return false only once the ring was closed. Elements are moved in and
+//out, so move-only types (e.g. unique_ptr) work. Capacities are rounded
+//up to a power of two; producer and consumer indices sit on separate
+//cache lines.
+
+//How the blocking calls wait for the other side
+enum RingWaitStrategy
+{
+    SPIN_WAIT,  //busy-poll, lowest latency, burns a core
+    YIELD_WAIT, //spin briefly, then yield the core between polls
+    BLOCK_WAIT  //spin, yield, then sleep in the kernel (futex via atomic::wait) until notified
+};
+
+//Shared waiting logic. The progress counter is the index the waiting side
+//depends on (tail for consumers, head for producers). Sleepers wait on the
+//waiter's own epoch counter instead of the index: every wake-up bumps it,
+//so close() can wake them although no index moved. The other side only
+//wakes them if someone announced to be sleeping.
+class RingWaiter
+{
+public:
+    static constexpr int SPIN_LIMIT = 128;
+    static constexpr int YIELD_LIMIT = 256;
+
+    RingWaiter() : sleepers_(0), epoch_(0) {}
+
+    //waits until tryOp() succeeds or closed becomes true, returns the result of the last tryOp()
+    template<typename TryOp>
+    bool wait(TryOp tryOp, const atomic<size_t>& progress, const atomic<bool>& closed, RingWaitStrategy strategy)
+    {
+        for(int iter = 0;; ++iter)
+        {
+            uint32_t epoch = epoch_.load(memory_order_acquire);
+            size_t seen = progress.load(memory_order_acquire);
+            if(tryOp()) return true;
+            if(closed.load(memory_order_acquire)) return tryOp();
+
+            if(strategy == SPIN_WAIT || iter < SPIN_LIMIT) continue;
+            if(strategy == YIELD_WAIT || iter < YIELD_LIMIT)
+            {
+                this_thread::yield();
+                continue;
+            }
+
+            //announce the sleeper before re-checking. Both sides modify sleepers_, so either
+            //notify() sees the sleeper or the sleeper sees the progress made before notify()
+            sleepers_.fetch_add(1, memory_order_seq_cst);
+            if(progress.load(memory_order_acquire) == seen && !closed.load(memory_order_acquire)) epoch_.wait(epoch, memory_order_acquire);
+            sleepers_.fetch_sub(1, memory_order_relaxed);
+        }
+    }
+
+    //called after the progress counter moved
+    void notify()
+    {
+        //a read-modify-write instead of a fence and a load, ThreadSanitizer does not model fences
+        if(sleepers_.fetch_add(0, memory_order_seq_cst) > 0) wakeAll();
+    }
+
+    //wakes every sleeper, which then re-checks the ring and the closed flag
+    void wakeAll()
+    {
+        epoch_.fetch_add(1, memory_order_acq_rel);
+        epoch_.notify_all();
+    }
+
+private:
+    atomic<int> sleepers_;
+    atomic<uint32_t> epoch_; //bumped by every wake-up, a sleeper waiting on an old value returns at once
+};
+
+template<typename T>
+class SPSCRingBuffer
+{
+public:
+    static constexpr size_t CACHE_LINE = 64;
+
+    explicit SPSCRingBuffer(size_t capacity = 1024, RingWaitStrategy strategy = BLOCK_WAIT) :
+        strategy_(strategy), closed_(false), head_(0), tail_(0)
+    {
+        size_t size = 2;
+        while(size < capacity) size <<= 1;
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    SPSCRingBuffer(const SPSCRingBuffer&) = delete;
+    SPSCRingBuffer& operator=(const SPSCRingBuffer&) = delete;
+
+    //----------producer side
+    bool push(T&& value)
+    {
+        size_t tail = tail_.load(memory_order_relaxed);
+        if(tail - head_.load(memory_order_acquire) > mask_) return false;
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, memory_order_release);
+        consumerWaiter_.notify();
+        return true;
+    }
+
+    //moves up to n elements from values, returns the number pushed
+    size_t pushBatch(T* values, size_t n)
+    {
+        size_t tail = tail_.load(memory_order_relaxed);
+        size_t space = mask_ + 1 - (tail - head_.load(memory_order_acquire));
+        n = min(n, space);
+        if(n == 0) return 0;
+        for(size_t i = 0; i < n; ++i) slots_[(tail + i) & mask_] = std::move(values[i]);
+        tail_.store(tail + n, memory_order_release);
+        consumerWaiter_.notify();
+        return n;
+    }
+
+    bool pushWait(T&& value)
+    {
+        if(closed_.load(memory_order_acquire)) return false;
+        return producerWaiter_.wait([&] { return push(std::move(value)); }, head_, closed_, strategy_);
+    }
+
+    //----------consumer side
+    bool pop(T& value)
+    {
+        size_t head = head_.load(memory_order_relaxed);
+        if(head == tail_.load(memory_order_acquire)) return false;
+        value = std::move(slots_[head & mask_]);
+        head_.store(head + 1, memory_order_release);
+        producerWaiter_.notify();
+        return true;
+    }
+
+    //moves up to n elements into values, returns the number popped
+    size_t popBatch(T* values, size_t n)
+    {
+        size_t head = head_.load(memory_order_relaxed);
+        n = min(n, tail_.load(memory_order_acquire) - head);
+        if(n == 0) return 0;
+        for(size_t i = 0; i < n; ++i) values[i] = std::move(slots_[(head + i) & mask_]);
+        head_.store(head + n, memory_order_release);
+        producerWaiter_.notify();
+        return n;
+    }
+
+    bool popWait(T& value)
+    {
+        return consumerWaiter_.wait([&] { return pop(value); }, tail_, closed_, strategy_);
+    }
+
+    //----------shutdown: wakes all waiters, pushWait fails from now on, popWait drains and then fails
+    void close()
+    {
+        closed_.store(true, memory_order_seq_cst);
+        producerWaiter_.wakeAll();
+        consumerWaiter_.wakeAll();
+    }
+    bool isClosed() const {return closed_.load(memory_order_acquire);}
+
+    //----------local return functions
+    size_t capacity() const {return mask_ + 1;}
+    size_t size() const {return tail_.load(memory_order_acquire) - head_.load(memory_order_acquire);} //approximate while in use
+    bool empty() const {return size() == 0;}
+
+private:
+    vector<T> slots_;
+    size_t mask_;
+    RingWaitStrategy strategy_;
+    atomic<bool> closed_;
+    alignas(CACHE_LINE) atomic<size_t> head_; //next slot to pop, written by the consumer
+    RingWaiter producerWaiter_;               //producers waiting for head_ to move
+    alignas(CACHE_LINE) atomic<size_t> tail_; //next slot to push, written by the producer
+    RingWaiter consumerWaiter_;               //consumers waiting for tail_ to move
+};
+
+template<typename T>
+class MPMCRingBuffer
+{
+public:
+    static constexpr size_t CACHE_LINE = 64;
+
+    explicit MPMCRingBuffer(size_t capacity = 1024, RingWaitStrategy strategy = BLOCK_WAIT) :
+        strategy_(strategy), closed_(false), enqueuePos_(0), dequeuePos_(0)
+    {
+        size_t size = 2;
+        while(size < capacity) size <<= 1;
+        mask_ = size - 1;
+        cells_.reset(new Cell[size]);
+        for(size_t i = 0; i < size; ++i) cells_[i].sequence.store(i, memory_order_relaxed);
+    }
+
+    MPMCRingBuffer(const MPMCRingBuffer&) = delete;
+    MPMCRingBuffer& operator=(const MPMCRingBuffer&) = delete;
+
+    //----------producer side, any thread
+    bool push(T&& value)
+    {
+        Cell* cell;
+        size_t pos = enqueuePos_.load(memory_order_relaxed);
+        while(true)
+        {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if(diff == 0)
+            {
+                if(enqueuePos_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+            }
+            else if(diff < 0)
+            {
+                return false; //full
+            }
+            else
+            {
+                pos = enqueuePos_.load(memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, memory_order_release);
+        published_.fetch_add(1, memory_order_release);
+        consumerWaiter_.notify();
+        return true;
+    }
+
+    size_t pushBatch(T* values, size_t n)
+    {
+        size_t i = 0;
+        while(i < n && push(std::move(values[i]))) ++i;
+        return i;
+    }
+
+    bool pushWait(T&& value)
+    {
+        if(closed_.load(memory_order_acquire)) return false;
+        return producerWaiter_.wait([&] { return push(std::move(value)); }, released_, closed_, strategy_);
+    }
+
+    //----------consumer side, any thread
+    bool pop(T& value)
+    {
+        Cell* cell;
+        size_t pos = dequeuePos_.load(memory_order_relaxed);
+        while(true)
+        {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if(diff == 0)
+            {
+                if(dequeuePos_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) break;
+            }
+            else if(diff < 0)
+            {
+                return false; //empty
+            }
+            else
+            {
+                pos = dequeuePos_.load(memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask_ + 1, memory_order_release);
+        released_.fetch_add(1, memory_order_release);
+        producerWaiter_.notify();
+        return true;
+    }
+
+    size_t popBatch(T* values, size_t n)
+    {
+        size_t i = 0;
+        while(i < n && pop(values[i])) ++i;
+        return i;
+    }
+
+    bool popWait(T& value)
+    {
+        return consumerWaiter_.wait([&] { return pop(value); }, published_, closed_, strategy_);
+    }
+
+    //----------shutdown: wakes all waiters, pushWait fails from now on, popWait drains and then fails
+    void close()
+    {
+        closed_.store(true, memory_order_seq_cst);
+        producerWaiter_.wakeAll();
+        consumerWaiter_.wakeAll();
+    }
+    bool isClosed() const {return closed_.load(memory_order_acquire);}
+
+    //----------local return functions
+    size_t capacity() const {return mask_ + 1;}
+    size_t size() const //approximate while in use
+    {
+        size_t enq = enqueuePos_.load(memory_order_acquire);
+        size_t deq = dequeuePos_.load(memory_order_acquire);
+        return enq > deq ? enq - deq : 0;
+    }
+    bool empty() const {return size() == 0;}
+
+private:
+    struct alignas(CACHE_LINE) Cell
+    {
+        atomic<size_t> sequence;
+        T value;
+    };
+
+    unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    RingWaitStrategy strategy_;
+    atomic<bool> closed_;
+    alignas(CACHE_LINE) atomic<size_t> enqueuePos_;
+    alignas(CACHE_LINE) atomic<size_t> dequeuePos_;
+    alignas(CACHE_LINE) atomic<size_t> published_{0}; //completed pushes, consumers wait on it
+    RingWaiter consumerWaiter_;
+    alignas(CACHE_LINE) atomic<size_t> released_{0};  //completed pops, producers wait on it
+    RingWaiter producerWaiter_;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#include "RunFile.h"
+#include "Crc32c.h"
+
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+RunFileWriter::Info::Info() :
+    runNumber(0),
+    subRunNumber(0),
+    boardIndex(-1),
+    configHash(0),
+    compressed(false)
+{
+}
+
+RunFileWriter::RunFileWriter(AsyncFileWriter& out) : out_(out), offset_(0)
+{
+}
+
+void RunFileWriter::begin(const Info& info)
+{
+    RunFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, info.compressed ? RUNFILE_MAGIC_COMPRESSED : RUNFILE_MAGIC, sizeof(header.magic));
+    header.version = RUNFILE_VERSION;
+    header.headerSize = sizeof(header);
+    header.runNumber = info.runNumber;
+    header.subRunNumber = info.subRunNumber;
+    header.boardIndex = info.boardIndex;
+    memcpy(header.boardID, info.boardID.c_str(), min(info.boardID.size(), sizeof(header.boardID) - 1));
+    header.configHash = info.configHash;
+    header.createdTime = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+
+    index_.clear();
+    out_.write(&header, sizeof(header));
+    offset_ = sizeof(header);
+}
+
+void RunFileWriter::writeEvent(const void* data, size_t size)
+{
+    static const uint64_t padding = 0;
+
+    RunFileRecord record;
+    record.magic = RUNFILE_RECORD_MAGIC;
+    record.payloadBytes = size;
+    record.eventNumber = index_.size();
+    record.crc32c = crc32c(data, size);
+
+    index_.push_back({offset_, record.payloadBytes, record.crc32c});
+
+    size_t pad = (8 - (size & 7)) & 7;
+    out_.write(&record, sizeof(record));
+    out_.write(data, size);
+    if(pad) out_.write(&padding, pad);
+    offset_ += sizeof(record) + size + pad;
+}
+
+void RunFileWriter::finish()
+{
+    RunFileTrailer trailer;
+    trailer.indexOffset = offset_;
+    trailer.nEvents = index_.size();
+    trailer.indexCrc32c = crc32c(index_.data(), index_.size()*sizeof(RunFileIndexEntry));
+    trailer.version = RUNFILE_VERSION;
+    memcpy(trailer.magic, RUNFILE_INDEX_MAGIC, sizeof(trailer.magic));
+
+    out_.write(index_.data(), index_.size()*sizeof(RunFileIndexEntry));
+    out_.write(&trailer, sizeof(trailer));
+    offset_ += index_.size()*sizeof(RunFileIndexEntry) + sizeof(trailer);
+}
+
+uint64_t RunFileWriter::hashConfig(const string& snapshot)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for(unsigned char c : snapshot)
+    {
+        hash ^= c;
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
@@ -0,0 +1,109 @@
+#ifndef _RUNFILE_H_INCLUDED
+#define _RUNFILE_H_INCLUDED
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "AsyncFileWriter.h"
+
+using namespace std;
+
+//Indexed, seekable run file (".accrun"), version 1. Little endian, all
+//structures are 8 byte aligned:
+//
+//  RunFileHeader                                   64 bytes
+//  per event: RunFileRecord + payload, padded to 8 bytes
+//  RunFileIndexEntry[nEvents]                      16 bytes each
+//  RunFileTrailer                                  32 bytes, at the end of the file
+//
+//The trailer locates the index, which gives the byte offset, size and
+//CRC32C of every event, so a reader jumps to event i without scanning.
+//The record headers repeat size and CRC, so a file whose index never got
+//written (crash) can still be recovered by walking the records.
+//
+//Compressed run files (".accz") have the same layout and start with
+//RUNFILE_MAGIC_COMPRESSED; every payload is one WaveformCodec block.
+
+static constexpr char RUNFILE_MAGIC[8] = {'A', 'C', 'C', 'R', 'U', 'N', '\0', '\0'};
+static constexpr char RUNFILE_MAGIC_COMPRESSED[8] = {'A', 'C', 'C', 'R', 'U', 'N', 'Z', '\0'};
+static constexpr char RUNFILE_INDEX_MAGIC[8] = {'A', 'C', 'C', 'I', 'D', 'X', '\0', '\0'};
+static constexpr uint32_t RUNFILE_VERSION = 1;
+static constexpr uint32_t RUNFILE_RECORD_MAGIC = 0xacce7e47;
+
+struct RunFileHeader
+{
+    char magic[8];         //RUNFILE_MAGIC or RUNFILE_MAGIC_COMPRESSED
+    uint32_t version;      //RUNFILE_VERSION
+    uint32_t headerSize;   //sizeof(RunFileHeader), records start here
+    uint64_t runNumber;
+    uint32_t subRunNumber;
+    int32_t boardIndex;    //ACDC slot on the ACC, -1 if the file holds several boards
+    char boardID[16];      //zero padded
+    uint64_t configHash;   //hash of the configuration snapshot, see hashConfig()
+    uint64_t createdTime;  //ns since the epoch
+};
+
+struct RunFileRecord
+{
+    uint32_t magic;        //RUNFILE_RECORD_MAGIC
+    uint32_t payloadBytes; //without the padding
+    uint32_t eventNumber;  //position of the event in the file
+    uint32_t crc32c;       //of the payload
+};
+
+struct RunFileIndexEntry
+{
+    uint64_t offset;       //of the RunFileRecord from the start of the file
+    uint32_t payloadBytes;
+    uint32_t crc32c;
+};
+
+struct RunFileTrailer
+{
+    uint64_t indexOffset;
+    uint64_t nEvents;
+    uint32_t indexCrc32c;  //of the index entries
+    uint32_t version;
+    char magic[8];         //RUNFILE_INDEX_MAGIC
+};
+
+static_assert(sizeof(RunFileHeader) == 64 && sizeof(RunFileRecord) == 16 && sizeof(RunFileIndexEntry) == 16 && sizeof(RunFileTrailer) == 32);
+
+//Writes the run file format through an AsyncFileWriter, which must be
+//open and is not owned. The index is kept in memory and written by
+//finish().
+class RunFileWriter
+{
+public:
+    class Info
+    {
+    public:
+        Info();
+
+        uint64_t runNumber;
+        uint32_t subRunNumber;
+        int boardIndex;
+        string boardID;     //truncated to 15 characters
+        uint64_t configHash;
+        bool compressed;    //payloads are WaveformCodec blocks
+    };
+
+    explicit RunFileWriter(AsyncFileWriter& out);
+
+    //----------writing
+    void begin(const Info& info); //writes the file header
+    void writeEvent(const void* data, size_t size);
+    void finish(); //writes the index and the trailer, the writer can then be closed
+
+    //----------local return functions
+    static uint64_t hashConfig(const string& snapshot); //FNV-1a 64
+    uint64_t getNumEvents() const {return index_.size();}
+    uint64_t getOffset() const {return offset_;}
+
+private:
+    AsyncFileWriter& out_;
+    uint64_t offset_; //bytes written so far
+    vector<RunFileIndexEntry> index_;
+};
+
+#endif
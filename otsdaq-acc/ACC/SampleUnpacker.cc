@@ -0,0 +1,232 @@
+#include "SampleUnpacker.h"
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ACC_UNPACK_X86 1
+#endif
+
+using namespace std;
+
+namespace
+{
+//Shuffle tables for one block of 8 words (64 bytes, 40 samples), decoded
+//into 5 vectors of 8 samples. Each sample is gathered as the 16 bit value
+//of the two bytes holding it and then shifted right by 0 or 4 bits.
+//Samples of vector v live within 32 bytes starting at base[v], which are
+//read as two 16 byte loads and shuffled with lo[v] and hi[v].
+struct BlockTables
+{
+    int base[5];
+    uint8_t lo[5][16];
+    uint8_t hi[5][16];
+    uint16_t shift4[5][8]; //0xffff for lanes needing the 4 bit shift
+};
+
+constexpr BlockTables makeBlockTables()
+{
+    BlockTables t{};
+    for(int v = 0; v < 5; ++v)
+    {
+        int minByte = 64;
+        for(int l = 0; l < 8; ++l)
+        {
+            int n = 8*v + l;
+            int offset = 48 - 12*(n % 5);
+            int byte = 8*(n / 5) + offset/8;
+            if(byte < minByte) minByte = byte;
+        }
+        t.base[v] = minByte < 32 ? minByte : 32;
+
+        for(int l = 0; l < 8; ++l)
+        {
+            int n = 8*v + l;
+            int offset = 48 - 12*(n % 5);
+            int byte = 8*(n / 5) + offset/8 - t.base[v];
+            for(int b = 0; b < 2; ++b)
+            {
+                int pos = byte + b;
+                t.lo[v][2*l + b] = pos < 16 ? pos : 0x80;
+                t.hi[v][2*l + b] = pos >= 16 ? pos - 16 : 0x80;
+            }
+            t.shift4[v][l] = (offset % 8) ? 0xffff : 0;
+        }
+    }
+    return t;
+}
+
+constexpr BlockTables blockTables = makeBlockTables();
+
+constexpr size_t BLOCK_WORDS = 8;
+constexpr size_t BLOCK_SAMPLES = BLOCK_WORDS*SampleUnpacker::SAMPLES_PER_WORD;
+
+SampleUnpacker::Implementation bestImplementation()
+{
+    if(SampleUnpacker::isSupported(SampleUnpacker::AVX2)) return SampleUnpacker::AVX2;
+    if(SampleUnpacker::isSupported(SampleUnpacker::SSE4)) return SampleUnpacker::SSE4;
+    return SampleUnpacker::SCALAR;
+}
+
+atomic<SampleUnpacker::Implementation> selectedImplementation(bestImplementation());
+}
+
+void SampleUnpacker::unpack(const uint64_t* words, size_t nWords, uint16_t* out)
+{
+    switch(selectedImplementation.load(memory_order_relaxed))
+    {
+    case AVX2:
+        unpackAVX2(words, nWords, out);
+        break;
+    case SSE4:
+        unpackSSE4(words, nWords, out);
+        break;
+    default:
+        unpackScalar(words, nWords, out);
+        break;
+    }
+}
+
+void SampleUnpacker::unpackScalar(const uint64_t* words, size_t nWords, uint16_t* out)
+{
+    for(size_t i = 0; i < nWords; ++i)
+    {
+        uint64_t word = words[i];
+        out[0] = (word >> 48) & 0xfff;
+        out[1] = (word >> 36) & 0xfff;
+        out[2] = (word >> 24) & 0xfff;
+        out[3] = (word >> 12) & 0xfff;
+        out[4] = word & 0xfff;
+        out += SAMPLES_PER_WORD;
+    }
+}
+
+#ifdef ACC_UNPACK_X86
+
+__attribute__((target("sse4.1")))
+void SampleUnpacker::unpackSSE4(const uint64_t* words, size_t nWords, uint16_t* out)
+{
+    const __m128i mask12 = _mm_set1_epi16(0x0fff);
+    __m128i lo[5], hi[5], shift4[5];
+    for(int v = 0; v < 5; ++v)
+    {
+        lo[v] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blockTables.lo[v]));
+        hi[v] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blockTables.hi[v]));
+        shift4[v] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blockTables.shift4[v]));
+    }
+
+    size_t nBlocks = nWords/BLOCK_WORDS;
+    for(size_t iBlock = 0; iBlock < nBlocks; ++iBlock)
+    {
+        const char* block = reinterpret_cast<const char*>(words + iBlock*BLOCK_WORDS);
+        for(int v = 0; v < 5; ++v)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + blockTables.base[v]));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + blockTables.base[v] + 16));
+            __m128i x = _mm_or_si128(_mm_shuffle_epi8(a, lo[v]), _mm_shuffle_epi8(b, hi[v]));
+            x = _mm_blendv_epi8(x, _mm_srli_epi16(x, 4), shift4[v]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8*v), _mm_and_si128(x, mask12));
+        }
+        out += BLOCK_SAMPLES;
+    }
+
+    unpackScalar(words + nBlocks*BLOCK_WORDS, nWords - nBlocks*BLOCK_WORDS, out);
+}
+
+//processes two blocks per iteration, the first one in the low and the
+//second one in the high 128 bit lane of every register
+__attribute__((target("avx2")))
+void SampleUnpacker::unpackAVX2(const uint64_t* words, size_t nWords, uint16_t* out)
+{
+    const __m256i mask12 = _mm256_set1_epi16(0x0fff);
+    __m256i lo[5], hi[5], shift4[5];
+    for(int v = 0; v < 5; ++v)
+    {
+        lo[v] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blockTables.lo[v])));
+        hi[v] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blockTables.hi[v])));
+        shift4[v] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blockTables.shift4[v])));
+    }
+
+    size_t nPairs = nWords/(2*BLOCK_WORDS);
+    for(size_t iPair = 0; iPair < nPairs; ++iPair)
+    {
+        const char* block0 = reinterpret_cast<const char*>(words + iPair*2*BLOCK_WORDS);
+        const char* block1 = block0 + BLOCK_WORDS*sizeof(uint64_t);
+        for(int v = 0; v < 5; ++v)
+        {
+            int base = blockTables.base[v];
+            __m256i a = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block0 + base))),
+                                                _mm_loadu_si128(reinterpret_cast<const __m128i*>(block1 + base)), 1);
+            __m256i b = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block0 + base + 16))),
+                                                _mm_loadu_si128(reinterpret_cast<const __m128i*>(block1 + base + 16)), 1);
+            __m256i x = _mm256_or_si256(_mm256_shuffle_epi8(a, lo[v]), _mm256_shuffle_epi8(b, hi[v]));
+            x = _mm256_and_si256(_mm256_blendv_epi8(x, _mm256_srli_epi16(x, 4), shift4[v]), mask12);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8*v), _mm256_castsi256_si128(x));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + BLOCK_SAMPLES + 8*v), _mm256_extracti128_si256(x, 1));
+        }
+        out += 2*BLOCK_SAMPLES;
+    }
+
+    //leave the upper register halves clean before the non-VEX SSE code, mixing them stalls on every call
+    _mm256_zeroupper();
+    size_t done = nPairs*2*BLOCK_WORDS;
+    if(done < nWords) unpackSSE4(words + done, nWords - done, out);
+}
+
+bool SampleUnpacker::isSupported(Implementation impl)
+{
+    __builtin_cpu_init(); //may be called during static initialization
+    switch(impl)
+    {
+    case AVX2:
+        return __builtin_cpu_supports("avx2");
+    case SSE4:
+        return __builtin_cpu_supports("sse4.1");
+    default:
+        return true;
+    }
+}
+
+#else
+
+void SampleUnpacker::unpackSSE4(const uint64_t* words, size_t nWords, uint16_t* out)
+{
+    unpackScalar(words, nWords, out);
+}
+
+void SampleUnpacker::unpackAVX2(const uint64_t* words, size_t nWords, uint16_t* out)
+{
+    unpackScalar(words, nWords, out);
+}
+
+bool SampleUnpacker::isSupported(Implementation impl)
+{
+    return impl == AUTO || impl == SCALAR;
+}
+
+#endif
+
+SampleUnpacker::Implementation SampleUnpacker::getImplementation()
+{
+    return selectedImplementation.load();
+}
+
+bool SampleUnpacker::setImplementation(Implementation impl)
+{
+    if(impl == AUTO) impl = bestImplementation();
+    if(!isSupported(impl)) return false;
+    selectedImplementation = impl;
+    return true;
+}
+
+const char* SampleUnpacker::getName(Implementation impl)
+{
+    switch(impl)
+    {
+    case AUTO:   return "auto";
+    case SCALAR: return "scalar";
+    case SSE4:   return "sse4.1";
+    case AVX2:   return "avx2";
+    }
+    return "unknown";
+}
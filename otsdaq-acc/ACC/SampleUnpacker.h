@@ -0,0 +1,38 @@
+#ifndef _SAMPLEUNPACKER_H_INCLUDED
+#define _SAMPLEUNPACKER_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+
+//Decodes the packed PSEC sample words of the ACDC data stream. Every
+//64 bit word carries five 12 bit samples, the first sample in bits
+//59-48 and the last one in bits 11-0; bits 63-60 are unused.
+//The SIMD paths decode whole blocks of 8 (SSE4.1) or 16 (AVX2) words
+//and fall back to the scalar loop for the remainder.
+class SampleUnpacker
+{
+public:
+    static constexpr int SAMPLES_PER_WORD = 5;
+
+    enum Implementation
+    {
+        AUTO,   //best implementation supported by the CPU
+        SCALAR,
+        SSE4,
+        AVX2
+    };
+
+    //----------unpack functions, out must hold SAMPLES_PER_WORD*nWords samples
+    static void unpack(const uint64_t* words, size_t nWords, uint16_t* out); //uses the selected implementation
+    static void unpackScalar(const uint64_t* words, size_t nWords, uint16_t* out);
+    static void unpackSSE4(const uint64_t* words, size_t nWords, uint16_t* out);
+    static void unpackAVX2(const uint64_t* words, size_t nWords, uint16_t* out);
+
+    //----------implementation selection
+    static bool isSupported(Implementation impl); //true if the CPU can run impl
+    static Implementation getImplementation(); //implementation used by unpack()
+    static bool setImplementation(Implementation impl); //returns false (and keeps the current one) if impl is not supported
+    static const char* getName(Implementation impl);
+};
+
+#endif
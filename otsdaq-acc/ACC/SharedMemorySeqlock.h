@@ -0,0 +1,140 @@
+#ifndef _SHAREDMEMORYSEQLOCK_H_INCLUDED
+#define _SHAREDMEMORYSEQLOCK_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+//One value of type T published through a POSIX shared memory segment and
+//guarded by a seqlock. A single writer process publishes; any number of
+//reader processes take consistent copies without ever blocking the
+//writer: the sequence counter is odd while a copy is being written, so a
+//reader retries if it saw an odd counter or the counter moved during its
+//copy. T has to be trivially copyable and should not contain pointers.
+//
+//Segment layout: sequence (8 bytes), MAGIC (4), sizeof(T) (4), padding to
+//64 bytes, then the value.
+template<typename T>
+class SharedMemorySeqlock
+{
+    static_assert(is_trivially_copyable_v<T>, "SharedMemorySeqlock needs a trivially copyable type");
+
+public:
+    static constexpr uint32_t MAGIC = 0x5e9105c4;
+
+    SharedMemorySeqlock() : segment_(nullptr) {}
+    ~SharedMemorySeqlock() {close();}
+
+    SharedMemorySeqlock(const SharedMemorySeqlock&) = delete;
+    SharedMemorySeqlock& operator=(const SharedMemorySeqlock&) = delete;
+
+    //----------writer side, name as for shm_open ("/name")
+    bool create(const string& name)
+    {
+        close();
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+        if(fd < 0) return false;
+        bool ok = ftruncate(fd, sizeof(Segment)) == 0 && map(fd, PROT_READ | PROT_WRITE);
+        ::close(fd);
+        if(!ok) return false;
+
+        name_ = name;
+        //an odd counter keeps readers out until the first publish
+        segment_->sequence.store(1, memory_order_relaxed);
+        segment_->magic = MAGIC;
+        segment_->size = sizeof(T);
+        atomic_thread_fence(memory_order_release);
+        return true;
+    }
+
+    void publish(const T& value)
+    {
+        uint64_t sequence = segment_->sequence.load(memory_order_relaxed) | 1;
+        segment_->sequence.store(sequence, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        memcpy(&segment_->value, &value, sizeof(T));
+        segment_->sequence.store(sequence + 1, memory_order_release);
+    }
+
+    static bool remove(const string& name) {return shm_unlink(name.c_str()) == 0;}
+
+    //----------reader side
+    bool open(const string& name)
+    {
+        close();
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if(fd < 0) return false;
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(Segment) && map(fd, PROT_READ);
+        ::close(fd);
+        if(!ok) return false;
+        if(segment_->magic != MAGIC || segment_->size != sizeof(T))
+        {
+            close();
+            return false;
+        }
+        name_ = name;
+        return true;
+    }
+
+    //consistent copy of the last published value, false if none was published or the writer kept it busy for maxRetries attempts
+    bool read(T& value, int maxRetries = 1000) const
+    {
+        for(int i = 0; i < maxRetries; ++i)
+        {
+            uint64_t before = segment_->sequence.load(memory_order_acquire);
+            if(before & 1)
+            {
+                this_thread::yield();
+                continue;
+            }
+            memcpy(&value, &segment_->value, sizeof(T));
+            atomic_thread_fence(memory_order_acquire);
+            if(segment_->sequence.load(memory_order_relaxed) == before) return true;
+        }
+        return false;
+    }
+
+    //----------both sides
+    void close()
+    {
+        if(segment_) munmap(segment_, sizeof(Segment));
+        segment_ = nullptr;
+        name_.clear();
+    }
+    bool isOpen() const {return segment_ != nullptr;}
+    uint64_t getSequence() const {return segment_ ? segment_->sequence.load(memory_order_acquire) : 0;} //twice the number of publishes, odd while one is in progress
+    const string& getName() const {return name_;}
+
+private:
+    struct Segment
+    {
+        atomic<uint64_t> sequence;
+        uint32_t magic;
+        uint32_t size;
+        alignas(64) T value;
+    };
+    static_assert(atomic<uint64_t>::is_always_lock_free, "the seqlock counter has to be lock free to live in shared memory");
+
+    bool map(int fd, int protection)
+    {
+        void* address = mmap(nullptr, sizeof(Segment), protection, MAP_SHARED, fd, 0);
+        if(address == MAP_FAILED) return false;
+        segment_ = static_cast<Segment*>(address);
+        return true;
+    }
+
+    Segment* segment_;
+    string name_;
+};
+
+#endif
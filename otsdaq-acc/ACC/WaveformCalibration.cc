@@ -0,0 +1,144 @@
+#include "WaveformCalibration.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define ACC_CALIB_SSE2 1
+#endif
+
+using namespace std;
+
+namespace
+{
+constexpr char LINEARITY_MAGIC[8] = {'A', 'C', 'C', 'L', 'I', 'N', '\0', '\0'};
+
+struct LinearityHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t nChannels;
+    uint32_t nCounts;
+    uint32_t reserved;
+};
+}
+
+WaveformCalibration::WaveformCalibration() : hasLinearity_(false)
+{
+    memset(pedestal_, 0, sizeof(pedestal_));
+    memset(pedestalCounts_, 0, sizeof(pedestalCounts_));
+    for(int ch = 0; ch < NUM_CH; ++ch)
+    {
+        for(int count = 0; count < NUM_COUNTS; ++count) linearity_[ch][count] = count*DEFAULT_MV_PER_COUNT;
+    }
+    updatePedestalMV();
+}
+
+void WaveformCalibration::setPedestals(const PedestalCalibration& pedestals)
+{
+    for(int cell = 0; cell < NUM_CELLS; ++cell)
+    {
+        float pedestal = pedestals.mean[cell/NUM_SAMP][cell%NUM_SAMP];
+        pedestal_[cell] = pedestal;
+        pedestalCounts_[cell] = lround(pedestal);
+    }
+    updatePedestalMV();
+}
+
+bool WaveformCalibration::setLinearity(int ch, span<const float> mV)
+{
+    if(ch < 0 || ch >= NUM_CH || mV.size() != NUM_COUNTS) return false;
+    memcpy(linearity_[ch], mV.data(), sizeof(linearity_[ch]));
+    hasLinearity_ = true;
+    updatePedestalMV();
+    return true;
+}
+
+bool WaveformCalibration::loadPedestals(const string& fileName)
+{
+    PedestalCalibration pedestals;
+    if(!pedestals.load(fileName)) return false;
+    setPedestals(pedestals);
+    return true;
+}
+
+bool WaveformCalibration::loadLinearity(const string& fileName)
+{
+    ifstream in(fileName, ios::binary);
+    LinearityHeader header;
+    if(!in.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+    if(memcmp(header.magic, LINEARITY_MAGIC, sizeof(header.magic)) != 0 || header.version != FILE_VERSION) return false;
+    if(header.nChannels != NUM_CH || header.nCounts != NUM_COUNTS) return false;
+
+    //a short file must not leave a half replaced table behind
+    vector<float> table(NUM_CH*NUM_COUNTS);
+    if(!in.read(reinterpret_cast<char*>(table.data()), sizeof(linearity_))) return false;
+    memcpy(linearity_, table.data(), sizeof(linearity_));
+    hasLinearity_ = true;
+    updatePedestalMV();
+    return true;
+}
+
+//pedestals are fractional counts, interpolate the linearity table
+void WaveformCalibration::updatePedestalMV()
+{
+    for(int cell = 0; cell < NUM_CELLS; ++cell)
+    {
+        const float* table = linearity_[cell/NUM_SAMP];
+        float pedestal = min(max(pedestal_[cell], 0.f), (float)(NUM_COUNTS - 1));
+        int count = min((int)pedestal, NUM_COUNTS - 2);
+        float frac = pedestal - count;
+        pedestalMV_[cell] = table[count] + frac*(table[count + 1] - table[count]);
+    }
+}
+
+void WaveformCalibration::toMV(const unsigned short* __restrict raw, int firstCell, int n, float* __restrict out) const
+{
+    const float* __restrict pedestalMV = pedestalMV_ + firstCell;
+    if(!hasLinearity_)
+    {
+        //plain scaling
+        int i = 0;
+#ifdef ACC_CALIB_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 scale = _mm_set1_ps(DEFAULT_MV_PER_COUNT);
+        for(; i + 8 <= n; i += 8)
+        {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + i));
+            __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(x, zero));
+            __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(x, zero));
+            _mm_storeu_ps(out + i, _mm_sub_ps(_mm_mul_ps(lo, scale), _mm_loadu_ps(pedestalMV + i)));
+            _mm_storeu_ps(out + i + 4, _mm_sub_ps(_mm_mul_ps(hi, scale), _mm_loadu_ps(pedestalMV + i + 4)));
+        }
+#endif
+        for(; i < n; ++i) out[i] = raw[i]*DEFAULT_MV_PER_COUNT - pedestalMV[i];
+        return;
+    }
+
+    //table lookups, split at the channel boundaries
+    for(int i = 0; i < n;)
+    {
+        int cell = firstCell + i;
+        const float* table = linearity_[cell/NUM_SAMP];
+        int end = min(n, i + NUM_SAMP - cell%NUM_SAMP);
+        for(; i < end; ++i) out[i] = table[raw[i] & (NUM_COUNTS - 1)] - pedestalMV[i];
+    }
+}
+
+void WaveformCalibration::toCounts(const unsigned short* __restrict raw, int firstCell, int n, int16_t* __restrict out) const
+{
+    const int16_t* __restrict pedestal = pedestalCounts_ + firstCell;
+    int i = 0;
+#ifdef ACC_CALIB_SSE2
+    for(; i + 8 <= n; i += 8)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(raw + i));
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pedestal + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_sub_epi16(x, p));
+    }
+#endif
+    for(; i < n; ++i) out[i] = (int16_t)raw[i] - pedestal[i];
+}
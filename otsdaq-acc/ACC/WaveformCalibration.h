@@ -0,0 +1,64 @@
+#ifndef _WAVEFORMCALIBRATION_H_INCLUDED
+#define _WAVEFORMCALIBRATION_H_INCLUDED
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include "PedestalCalculator.h"
+#include "Waveforms.h"
+
+using namespace std;
+
+//Calibrated waveforms of one event, filled by ACDC::parseDataFromBuffer
+//next to the raw counts. Only the array of the selected output mode is
+//written.
+struct alignas(64) CalibratedWaveforms
+{
+    float mV[NUM_CH][NUM_SAMP];        //CALIBRATED_MV
+    int16_t counts[NUM_CH][NUM_SAMP];  //PEDESTAL_SUBTRACTED
+};
+
+//Lookup tables turning raw ADC counts into calibrated samples:
+//  mV:     linearity[ch][count] - pedestal of the capacitor, converted through the same table
+//  counts: count - pedestal of the capacitor, rounded
+//Without a linearity table the conversion is linear with
+//DEFAULT_MV_PER_COUNT, without pedestals they are 0. The tables are
+//read-only once set up and can be shared by several ACDC objects.
+//
+//Linearity file (binary, little endian): "ACCLIN\0\0", version (uint32),
+//channels (uint32), counts (uint32), then NUM_CH*NUM_COUNTS mV values (float).
+class WaveformCalibration
+{
+public:
+    static constexpr int NUM_COUNTS = 4096; //12 bit ADC
+    static constexpr int NUM_CELLS = NUM_CH*NUM_SAMP;
+    static constexpr float DEFAULT_MV_PER_COUNT = 1200.f/NUM_COUNTS; //1.2 V full scale
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    WaveformCalibration();
+
+    //----------local set functions
+    void setPedestals(const PedestalCalibration& pedestals);
+    bool setLinearity(int ch, span<const float> mV); //mV for every ADC count, false if the size is not NUM_COUNTS
+    bool loadPedestals(const string& fileName);
+    bool loadLinearity(const string& fileName);
+
+    //----------conversion of n samples starting at cell firstCell (= NUM_SAMP*channel + capacitor)
+    void toMV(const unsigned short* raw, int firstCell, int n, float* out) const;
+    void toCounts(const unsigned short* raw, int firstCell, int n, int16_t* out) const;
+
+    //----------local return functions
+    bool hasLinearity() const {return hasLinearity_;}
+    float getPedestalMV(int cell) const {return pedestalMV_[cell];}
+
+private:
+    void updatePedestalMV();
+
+    bool hasLinearity_;
+    alignas(64) float pedestal_[NUM_CELLS];      //ADC counts
+    alignas(64) float pedestalMV_[NUM_CELLS];    //pedestal through the linearity table
+    alignas(64) int16_t pedestalCounts_[NUM_CELLS];
+    alignas(64) float linearity_[NUM_CH][NUM_COUNTS];
+};
+
+#endif
@@ -0,0 +1,271 @@
+#include "WaveformCodec.h"
+#include "SampleUnpacker.h"
+#include "Waveforms.h"
+
+#include <cstdlib>
+#include <cstring>
+#ifdef ACC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+namespace
+{
+constexpr uint64_t UNUSED_BITS = 0xf000000000000000; //bits 63-60 of a sample word
+constexpr int MODE_PEDESTAL = 0;
+constexpr int MODE_DELTA = 1;
+
+inline uint32_t zigzag(int32_t v) {return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);}
+inline int32_t unzigzag(uint32_t v) {return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);}
+
+template<class T>
+void put(vector<char>& out, T value)
+{
+    size_t size = out.size();
+    out.resize(size + sizeof(T));
+    memcpy(out.data() + size, &value, sizeof(T));
+}
+
+//bounds-checked sequential reads from the compressed event
+class Input
+{
+public:
+    Input(span<const char> in) : in_(in), pos_(0) {}
+
+    template<class T>
+    bool get(T& value)
+    {
+        if(pos_ + sizeof(T) > in_.size()) return false;
+        memcpy(&value, in_.data() + pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+    const char* take(size_t n)
+    {
+        if(pos_ + n > in_.size()) return nullptr;
+        pos_ += n;
+        return in_.data() + pos_ - n;
+    }
+    span<const char> rest() const {return in_.subspan(pos_);}
+
+private:
+    span<const char> in_;
+    size_t pos_;
+};
+
+//codes the samples of one channel
+void encodeChannel(const uint16_t* samples, int n, vector<char>& out)
+{
+    //pick the predictor with the smaller residuals
+    int32_t sum = 0;
+    for(int i = 0; i < n; ++i) sum += samples[i];
+    int32_t pedestal = (sum + n/2)/n;
+    int32_t costPedestal = 0, costDelta = 0;
+    for(int i = 0; i < n; ++i)
+    {
+        costPedestal += abs((int32_t)samples[i] - pedestal);
+        if(i > 0) costDelta += abs((int32_t)samples[i] - (int32_t)samples[i - 1]);
+    }
+    int mode = costDelta < costPedestal ? MODE_DELTA : MODE_PEDESTAL;
+    uint16_t base = mode == MODE_DELTA ? samples[0] : pedestal;
+    out.push_back(mode);
+    put<uint16_t>(out, base);
+
+    uint32_t residual[WaveformCodec::BLOCK_SAMPLES];
+    for(int start = 0; start < n; start += WaveformCodec::BLOCK_SAMPLES)
+    {
+        int count = min(WaveformCodec::BLOCK_SAMPLES, n - start);
+        uint32_t bits = 0;
+        for(int i = 0; i < count; ++i)
+        {
+            int s = start + i;
+            int32_t prediction = mode == MODE_PEDESTAL ? pedestal : s == 0 ? base : samples[s - 1];
+            residual[i] = zigzag((int32_t)samples[s] - prediction);
+            bits |= residual[i];
+        }
+        int width = bits ? 32 - __builtin_clz(bits) : 0;
+        out.push_back(width);
+        if(width == 0) continue;
+
+        //count*width bits, rounded up to bytes
+        uint64_t acc = 0;
+        int nAcc = 0;
+        for(int i = 0; i < count; ++i)
+        {
+            acc |= (uint64_t)residual[i] << nAcc;
+            nAcc += width;
+            while(nAcc >= 8)
+            {
+                out.push_back((char)(acc & 0xff));
+                acc >>= 8;
+                nAcc -= 8;
+            }
+        }
+        if(nAcc > 0) out.push_back((char)(acc & 0xff));
+    }
+}
+
+bool decodeChannel(Input& in, uint16_t* samples, int n)
+{
+    uint8_t mode;
+    uint16_t base;
+    if(!in.get(mode) || !in.get(base) || mode > MODE_DELTA) return false;
+
+    for(int start = 0; start < n; start += WaveformCodec::BLOCK_SAMPLES)
+    {
+        int count = min(WaveformCodec::BLOCK_SAMPLES, n - start);
+        uint8_t width;
+        if(!in.get(width) || width > 32) return false;
+        const unsigned char* packed = nullptr;
+        if(width > 0 && !(packed = reinterpret_cast<const unsigned char*>(in.take((count*width + 7)/8)))) return false;
+
+        uint64_t acc = 0;
+        int nAcc = 0;
+        uint64_t mask = (uint64_t(1) << width) - 1;
+        for(int i = 0; i < count; ++i)
+        {
+            uint32_t r = 0;
+            if(width > 0)
+            {
+                while(nAcc < width)
+                {
+                    acc |= (uint64_t)*packed++ << nAcc;
+                    nAcc += 8;
+                }
+                r = acc & mask;
+                acc >>= width;
+                nAcc -= width;
+            }
+            int s = start + i;
+            int32_t prediction = mode == MODE_PEDESTAL ? base : s == 0 ? base : samples[s - 1];
+            samples[s] = (prediction + unzigzag(r)) & 0xffff;
+        }
+    }
+    return true;
+}
+}
+
+void WaveformCodec::encode(span<const uint64_t> words, size_t bytes, vector<char>& out, int zstdLevel)
+{
+    out.clear();
+    size_t nWords = (bytes + 7)/8;
+
+    bool waveform = bytes % 8 == 0 && nWords > HEADER_WORDS && nWords <= words.size();
+    for(size_t i = HEADER_WORDS; waveform && i < nWords; ++i) waveform = (words[i] & UNUSED_BITS) == 0;
+    if(!waveform)
+    {
+        out.push_back(STORED);
+        put<uint32_t>(out, bytes);
+        out.insert(out.end(), reinterpret_cast<const char*>(words.data()), reinterpret_cast<const char*>(words.data()) + bytes);
+        return;
+    }
+
+    out.push_back(WAVEFORM);
+    put<uint32_t>(out, bytes);
+    [[maybe_unused]] size_t bodyStart = out.size();
+    out.insert(out.end(), reinterpret_cast<const char*>(words.data()), reinterpret_cast<const char*>(words.data() + HEADER_WORDS));
+
+    //channels of NUM_SAMP samples, the last one is shorter if the event is
+    size_t nSamples = (nWords - HEADER_WORDS)*SampleUnpacker::SAMPLES_PER_WORD;
+    thread_local vector<uint16_t> samples;
+    samples.resize(nSamples);
+    SampleUnpacker::unpack(words.data() + HEADER_WORDS, nWords - HEADER_WORDS, samples.data());
+    for(size_t start = 0; start < nSamples; start += NUM_SAMP) encodeChannel(samples.data() + start, min<size_t>(NUM_SAMP, nSamples - start), out);
+
+#ifdef ACC_HAVE_ZSTD
+    if(zstdLevel > 0)
+    {
+        thread_local vector<char> frame;
+        size_t bodySize = out.size() - bodyStart;
+        frame.resize(ZSTD_compressBound(bodySize));
+        size_t frameSize = ZSTD_compress(frame.data(), frame.size(), out.data() + bodyStart, bodySize, zstdLevel);
+        if(!ZSTD_isError(frameSize) && frameSize + sizeof(uint32_t) < bodySize)
+        {
+            out[0] = WAVEFORM_ZSTD;
+            out.resize(bodyStart);
+            put<uint32_t>(out, bodySize);
+            out.insert(out.end(), frame.data(), frame.data() + frameSize);
+        }
+    }
+#else
+    (void)zstdLevel;
+#endif
+}
+
+long WaveformCodec::decode(span<const char> in, vector<uint64_t>& words)
+{
+    Input input(in);
+    uint8_t format;
+    uint32_t bytes;
+    if(!input.get(format) || !input.get(bytes) || bytes > MAX_EVENT_BYTES) return -1;
+    size_t nWords = (bytes + 7)/8;
+
+    if(format == STORED)
+    {
+        const char* data = input.take(bytes);
+        if(!data) return -1;
+        words.assign(nWords, 0);
+        if(bytes > 0) memcpy(words.data(), data, bytes);
+        return bytes;
+    }
+
+    if(format != WAVEFORM && !(format == WAVEFORM_ZSTD && hasZstd())) return -1;
+    if(nWords <= HEADER_WORDS || bytes % 8 != 0) return -1;
+
+    //smallest body for this event: every block costs at least its width byte
+    size_t nSamples = (nWords - HEADER_WORDS)*SampleUnpacker::SAMPLES_PER_WORD;
+    size_t nChannels = (nSamples + NUM_SAMP - 1)/NUM_SAMP;
+    size_t nBlocks = (nSamples/NUM_SAMP)*((NUM_SAMP + BLOCK_SAMPLES - 1)/BLOCK_SAMPLES) + (nSamples%NUM_SAMP + BLOCK_SAMPLES - 1)/BLOCK_SAMPLES;
+    size_t minBody = HEADER_WORDS*sizeof(uint64_t) + nChannels*(1 + sizeof(uint16_t)) + nBlocks;
+
+    span<const char> body = input.rest();
+#ifdef ACC_HAVE_ZSTD
+    thread_local vector<char> inflated;
+    if(format == WAVEFORM_ZSTD)
+    {
+        //and the largest, with 32 bits per residual
+        size_t maxBody = minBody + nBlocks*BLOCK_SAMPLES*sizeof(uint32_t);
+        uint32_t bodySize;
+        if(!input.get(bodySize) || bodySize < minBody || bodySize > maxBody) return -1;
+        span<const char> frame = input.rest();
+        if(ZSTD_getFrameContentSize(frame.data(), frame.size()) != bodySize) return -1;
+        inflated.resize(bodySize);
+        size_t size = ZSTD_decompress(inflated.data(), inflated.size(), frame.data(), frame.size());
+        if(ZSTD_isError(size) || size != bodySize) return -1;
+        body = span<const char>(inflated);
+    }
+#endif
+    if(body.size() < minBody) return -1;
+    words.assign(nWords, 0);
+
+    Input waveform(body);
+    const char* header = waveform.take(HEADER_WORDS*sizeof(uint64_t));
+    if(!header) return -1;
+    memcpy(words.data(), header, HEADER_WORDS*sizeof(uint64_t));
+
+    thread_local vector<uint16_t> samples;
+    samples.resize(nSamples);
+    for(size_t start = 0; start < nSamples; start += NUM_SAMP)
+    {
+        if(!decodeChannel(waveform, samples.data() + start, min<size_t>(NUM_SAMP, nSamples - start))) return -1;
+    }
+
+    //repack, first sample in bits 59-48
+    const uint16_t* s = samples.data();
+    for(size_t i = HEADER_WORDS; i < nWords; ++i, s += SampleUnpacker::SAMPLES_PER_WORD)
+    {
+        if((s[0] | s[1] | s[2] | s[3] | s[4]) & 0xf000) return -1;
+        words[i] = (uint64_t)s[0] << 48 | (uint64_t)s[1] << 36 | (uint64_t)s[2] << 24 | (uint64_t)s[3] << 12 | s[4];
+    }
+    return bytes;
+}
+
+bool WaveformCodec::hasZstd()
+{
+#ifdef ACC_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
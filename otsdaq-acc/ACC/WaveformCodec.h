@@ -0,0 +1,51 @@
+#ifndef _WAVEFORMCODEC_H_INCLUDED
+#define _WAVEFORMCODEC_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+using namespace std;
+
+//Lossless compression of one ACDC event. The 5 header words are kept as
+//they are; the 12 bit samples are unpacked and coded per channel of
+//NUM_SAMP samples, either relative to the channel mean (pedestal) or to
+//the previous sample (delta), whichever gives the smaller residuals. The
+//zigzag coded residuals are bit packed in blocks of BLOCK_SAMPLES with
+//one width byte per block, so the noise near the pedestal costs a few
+//bits per sample and a pulse only widens its own block. Events which do
+//not look like ACDC data (unused sample bits set, too short) are stored
+//as they are. Optionally the result is run through zstd (if the library
+//was built with ACC_HAVE_ZSTD).
+//
+//Compressed event: format byte, event size in bytes (uint32), then
+//  STORED:        the event bytes
+//  WAVEFORM:      header words, per channel: mode byte, base (uint16), blocks
+//  WAVEFORM_ZSTD: size of the WAVEFORM body (uint32), zstd frame of it
+class WaveformCodec
+{
+public:
+    static constexpr int HEADER_WORDS = 5;
+    static constexpr int BLOCK_SAMPLES = 32;
+    static constexpr size_t MAX_EVENT_BYTES = 1 << 20; //8 packets of at most 64 kB fit, decode() rejects larger sizes before allocating
+
+    enum Format
+    {
+        STORED = 0,
+        WAVEFORM = 1,
+        WAVEFORM_ZSTD = 2
+    };
+
+    //----------coding functions
+    //bytes is the event size, words holds it zero padded to full words. Replaces the content of out.
+    static void encode(span<const uint64_t> words, size_t bytes, vector<char>& out, int zstdLevel = 0);
+    //restores the event into words (zero padded), returns its size in bytes or -1 if the input is corrupt.
+    //Sizes read from the input are checked against in.size() and MAX_EVENT_BYTES before anything is allocated.
+    static long decode(span<const char> in, vector<uint64_t>& words);
+
+    //----------local return functions
+    static bool hasZstd(); //true if zstd levels > 0 are supported
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef _WAVEFORMS_H_INCLUDED
+#define _WAVEFORMS_H_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <span>
+#include <vector>
+
+#ifndef NUM_CH
+#define NUM_CH 30 //maximum number of channels for one ACDC board
+#endif
+#ifndef NUM_PSEC
+#define NUM_PSEC 5 //maximum number of psec chips on an ACDC board
+#endif
+#ifndef NUM_SAMP
+#define NUM_SAMP 256 //maximum number of samples of one waveform
+#endif
+#ifndef NUM_CH_PER_CHIP
+#define NUM_CH_PER_CHIP 6 //maximum number of channels per psec chips
+#endif
+
+using namespace std;
+
+//All waveforms of one ACDC event in one fixed-size, cache line aligned
+//block. Channels of one PSEC chip are stored next to each other
+//(channel = NUM_CH_PER_CHIP*chip + chip channel), so per-chip views are
+//contiguous as well. Meant to be reused from event to event.
+struct alignas(64) Waveforms
+{
+    typedef span<const unsigned short, NUM_SAMP> ChannelView;
+    typedef span<const unsigned short, NUM_CH_PER_CHIP*NUM_SAMP> ChipView;
+
+    unsigned short samples[NUM_CH][NUM_SAMP]; //index: channel, sample
+
+    //samples of channel ch present in an event with nSamples samples, the ACC sends fewer than NUM_CH*NUM_SAMP
+    static int channelSamples(int ch, size_t nSamples) {return (int)min(nSamples - min(nSamples, (size_t)ch*NUM_SAMP), (size_t)NUM_SAMP);}
+
+    //----------non-owning views, valid as long as the Waveforms object is
+    ChannelView channel(int ch) const {return ChannelView(samples[ch], NUM_SAMP);}
+    span<unsigned short, NUM_SAMP> channel(int ch) {return span<unsigned short, NUM_SAMP>(samples[ch], NUM_SAMP);}
+    ChipView chip(int psec) const {return ChipView(samples[NUM_CH_PER_CHIP*psec], NUM_CH_PER_CHIP*NUM_SAMP);}
+    span<const unsigned short, NUM_CH*NUM_SAMP> all() const {return span<const unsigned short, NUM_CH*NUM_SAMP>(&samples[0][0], NUM_CH*NUM_SAMP);}
+    unsigned short* data() {return &samples[0][0];}
+    const unsigned short* data() const {return &samples[0][0];}
+
+    //----------compatibility adapter for the previous map<channel, samplevector> layout
+    map<int, vector<unsigned short>> toMap() const
+    {
+        map<int, vector<unsigned short>> dataMap;
+        for(int ch = 0; ch < NUM_CH; ++ch) dataMap.emplace(ch, vector<unsigned short>(samples[ch], samples[ch] + NUM_SAMP));
+        return dataMap;
+    }
+};
+
+#endif
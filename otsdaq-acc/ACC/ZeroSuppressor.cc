@@ -0,0 +1,150 @@
+#include "ZeroSuppressor.h"
+#include "SampleUnpacker.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace
+{
+constexpr size_t SAMPLE_WORDS = AccEventFormat::FULL_SAMPLE_WORDS; //at most, events of the ACC have fewer
+
+//appends samples packed 5 per word, the last word zero padded
+void pack(const uint16_t* samples, size_t n, vector<uint64_t>& out)
+{
+    for(size_t i = 0; i < n; i += SampleUnpacker::SAMPLES_PER_WORD)
+    {
+        uint64_t word = 0;
+        for(size_t k = 0; k < SampleUnpacker::SAMPLES_PER_WORD; ++k)
+        {
+            uint64_t sample = i + k < n ? samples[i + k] : 0;
+            word |= sample << (48 - 12*k);
+        }
+        out.push_back(word);
+    }
+}
+}
+
+ZeroSuppressor::Options::Options() :
+    mode(OFF),
+    polarity(0),
+    windowPre(10),
+    windowPost(30)
+{
+    fill_n(thresholds, NUM_CH, 0x780);
+    fill_n(fill, NUM_CH, 0x800);
+}
+
+ZeroSuppressor::ZeroSuppressor()
+{
+    out_.reserve(HEADER_WORDS + DESCRIPTOR_WORDS + SAMPLE_WORDS + 16);
+    kept_.reserve(NUM_CH*NUM_SAMP);
+}
+
+span<const uint64_t> ZeroSuppressor::suppress(span<const uint64_t> event)
+{
+    if(options_.mode == OFF) return event;
+
+    ++stats_.nEvents;
+    stats_.bytesIn += event.size_bytes();
+
+    //only ACDC events can be suppressed and expanded again, same header check as ACDC::parseDataFromBuffer
+    size_t nSampleWords = min(event.size() - min(event.size(), (size_t)HEADER_WORDS), SAMPLE_WORDS);
+    size_t nTrailer = event.size() - min(event.size(), HEADER_WORDS + nSampleWords);
+    if(nSampleWords == 0 || nTrailer > 0xffff || ((event[1] >> 48) & 0xffff) != 0xac9c || (event[4] & 0xffff) != 0xcac9)
+    {
+        ++stats_.nPassedThrough;
+        stats_.bytesOut += event.size_bytes();
+        return event;
+    }
+
+    size_t nSamples = nSampleWords*SampleUnpacker::SAMPLES_PER_WORD;
+    SampleUnpacker::unpack(event.data() + HEADER_WORDS, nSampleWords, samples_);
+
+    out_.assign(event.begin(), event.begin() + HEADER_WORDS);
+    size_t markerWord = out_.size();
+    out_.push_back(MARKER | (uint64_t)nTrailer << 32 | (uint64_t)options_.mode << 30);
+    kept_.clear();
+
+    uint64_t keptMask = 0;
+    for(int ch = 0; ch < NUM_CH; ++ch)
+    {
+        const uint16_t* s = samples_ + ch*NUM_SAMP;
+        int n = Waveforms::channelSamples(ch, nSamples);
+
+        //the most extreme sample in the trigger polarity
+        uint16_t low = 0xffff, high = 0;
+        for(int i = 0; i < n; ++i)
+        {
+            low = min(low, s[i]);
+            high = max(high, s[i]);
+        }
+        bool signal = n > 0 && (options_.polarity == 0 ? low < options_.thresholds[ch] : high > options_.thresholds[ch]);
+
+        int first = 0, count = 0;
+        if(signal)
+        {
+            keptMask |= uint64_t(1) << ch;
+            count = n;
+            if(options_.mode == PEAK_WINDOW)
+            {
+                int peak = (options_.polarity == 0 ? min_element(s, s + n) : max_element(s, s + n)) - s;
+                first = max(peak - options_.windowPre, 0);
+                count = min(peak + options_.windowPost, n - 1) - first + 1;
+            }
+            kept_.insert(kept_.end(), s + first, s + first + count);
+        }
+        out_.push_back((uint64_t)(options_.fill[ch] & 0xfff) << 32 | (uint64_t)first << 16 | count);
+    }
+    out_[markerWord] |= keptMask;
+    out_[markerWord + 1] |= (uint64_t)nSampleWords << 48;
+    pack(kept_.data(), kept_.size(), out_);
+    out_.insert(out_.end(), event.end() - nTrailer, event.end());
+
+    stats_.nChannels += (nSamples + NUM_SAMP - 1)/NUM_SAMP;
+    stats_.nChannelsKept += __builtin_popcountll(keptMask);
+    stats_.bytesOut += out_.size()*sizeof(uint64_t);
+    return span<const uint64_t>(out_);
+}
+
+bool ZeroSuppressor::expand(span<const uint64_t> suppressed, vector<uint64_t>& event)
+{
+    if(!isSuppressed(suppressed)) return false;
+
+    const uint64_t* descriptors = suppressed.data() + HEADER_WORDS + 1;
+    size_t nTrailer = (suppressed[HEADER_WORDS] >> 32) & 0xffff;
+    size_t nSampleWords = descriptors[0] >> 48;
+    if(suppressed.size() < HEADER_WORDS + DESCRIPTOR_WORDS + nTrailer || nSampleWords == 0 || nSampleWords > SAMPLE_WORDS) return false;
+    size_t nSamples = nSampleWords*SampleUnpacker::SAMPLES_PER_WORD;
+    span<const uint64_t> packed = suppressed.subspan(HEADER_WORDS + DESCRIPTOR_WORDS, suppressed.size() - HEADER_WORDS - DESCRIPTOR_WORDS - nTrailer);
+
+    size_t nKept = 0;
+    for(int ch = 0; ch < NUM_CH; ++ch)
+    {
+        size_t first = (descriptors[ch] >> 16) & 0xffff, count = descriptors[ch] & 0xffff;
+        if(first + count > (size_t)Waveforms::channelSamples(ch, nSamples)) return false;
+        nKept += count;
+    }
+    if(packed.size() != (nKept + SampleUnpacker::SAMPLES_PER_WORD - 1)/SampleUnpacker::SAMPLES_PER_WORD) return false;
+
+    vector<uint16_t> kept(packed.size()*SampleUnpacker::SAMPLES_PER_WORD);
+    SampleUnpacker::unpack(packed.data(), packed.size(), kept.data());
+
+    vector<uint16_t> samples(nSamples);
+    const uint16_t* k = kept.data();
+    for(int ch = 0; ch < NUM_CH; ++ch)
+    {
+        int n = Waveforms::channelSamples(ch, nSamples);
+        if(n == 0) break; //count is 0 for these, checked above
+        size_t first = (descriptors[ch] >> 16) & 0xffff, count = descriptors[ch] & 0xffff;
+        uint16_t* s = samples.data() + ch*NUM_SAMP;
+        fill(s, s + n, (descriptors[ch] >> 32) & 0xfff);
+        copy(k, k + count, s + first);
+        k += count;
+    }
+
+    event.assign(suppressed.begin(), suppressed.begin() + HEADER_WORDS);
+    pack(samples.data(), samples.size(), event);
+    event.insert(event.end(), suppressed.end() - nTrailer, suppressed.end());
+    return true;
+}
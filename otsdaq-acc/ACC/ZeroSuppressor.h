@@ -0,0 +1,97 @@
+#ifndef _ZEROSUPPRESSOR_H_INCLUDED
+#define _ZEROSUPPRESSOR_H_INCLUDED
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "AccPacket.h"
+#include "Waveforms.h"
+
+using namespace std;
+
+//Zero suppression of ACDC events for the saved files. A channel is kept
+//if one of its samples passes the channel's threshold in the trigger
+//polarity; in PEAK_WINDOW mode only the samples around its peak are
+//kept. The 5 header words stay untouched, so the event keys and the
+//metadata survive, and expand() rebuilds the event word for word with the
+//dropped samples set to the channel's fill value (its pedestal).
+//
+//The sample words are those behind the header, up to a complete 30x256
+//readout. Events as the ACC sends them (AccEventFormat::EVENT_WORDS) end
+//inside channel 28; the channels, or the part of a channel, they do not
+//carry are left out.
+//
+//Suppressed event (64 bit words):
+//  0-4:  original header words
+//  5:    MARKER | trailing words << 32 | mode << 30 | kept channel mask (bits 29-0)
+//  6-35: per channel: fill value << 32 | first sample << 16 | number of samples,
+//        bits 63-48 of word 6 hold the number of sample words of the original event
+//  then the kept samples of all channels back to back, packed like the
+//  ACDC data (5 per word, first in bits 59-48), the last word zero padded
+//  then the words the original event had after its samples, unchanged
+//The marker has bits 63-60 set, which ACDC sample words never have.
+class ZeroSuppressor
+{
+public:
+    static constexpr int HEADER_WORDS = AccEventFormat::HEADER_WORDS;
+    static constexpr int DESCRIPTOR_WORDS = 1 + NUM_CH;
+    static constexpr uint64_t MARKER = 0xf25a000000000000;
+    static constexpr uint64_t MARKER_MASK = 0xffff000000000000;
+
+    enum Mode
+    {
+        OFF,
+        DROP_QUIET_CHANNELS, //keep whole channels with signal
+        PEAK_WINDOW          //keep windowPre + 1 + windowPost samples around the peak of channels with signal
+    };
+
+    class Options
+    {
+    public:
+        Options();
+
+        Mode mode;
+        int polarity;                //0: pulses go below the threshold, 1: above (as ACDC SelfTrigPolarity)
+        unsigned int thresholds[NUM_CH]; //ADC counts
+        unsigned int fill[NUM_CH];       //value of the dropped samples when expanding, usually the pedestal
+        int windowPre;
+        int windowPost;
+    };
+
+    class Stats
+    {
+    public:
+        Stats() : nEvents(0), nPassedThrough(0), nChannels(0), nChannelsKept(0), bytesIn(0), bytesOut(0) {}
+
+        uint64_t nEvents;
+        uint64_t nPassedThrough; //events saved unchanged because they do not have the ACDC header or no sample words
+        uint64_t nChannels;
+        uint64_t nChannelsKept;
+        uint64_t bytesIn;
+        uint64_t bytesOut;
+    };
+
+    ZeroSuppressor();
+
+    //----------local set functions
+    void setOptions(const Options& options) {options_ = options;}
+
+    //----------suppression, the result points to an internal buffer (or to event itself) and is valid until the next call
+    span<const uint64_t> suppress(span<const uint64_t> event);
+
+    //----------local return functions
+    static bool isSuppressed(span<const uint64_t> event) {return event.size() >= HEADER_WORDS + DESCRIPTOR_WORDS && (event[HEADER_WORDS] & MARKER_MASK) == MARKER;}
+    static bool expand(span<const uint64_t> suppressed, vector<uint64_t>& event); //false if the input is corrupt
+    const Options& getOptions() const {return options_;}
+    Stats getStats() const {return stats_;}
+    void resetStats() {stats_ = Stats();}
+
+private:
+    Options options_;
+    Stats stats_;
+    vector<uint64_t> out_;
+    alignas(64) uint16_t samples_[NUM_CH*NUM_SAMP];
+    vector<uint16_t> kept_;
+};
+
+#endif
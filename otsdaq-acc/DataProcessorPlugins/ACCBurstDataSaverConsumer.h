@@ -8,6 +8,19 @@
 // doing.
 
 #include "otsdaq/DataManager/RawDataSaverConsumerBase.h"
+#include "otsdaq-acc/ACC/AsyncFileWriter.h"
+#include "otsdaq-acc/ACC/CompressPipeline.h"
+#include "otsdaq-acc/ACC/DecodePipeline.h"
+#include "otsdaq-acc/ACC/EventAssembler.h"
+#include "otsdaq-acc/ACC/EventBuilder.h"
+#include "otsdaq-acc/ACC/FeatureExtractor.h"
+#include "otsdaq-acc/ACC/LogRateLimiter.h"
+#include "otsdaq-acc/ACC/PedestalCalculator.h"
+#include "otsdaq-acc/ACC/RunFile.h"
+#include "otsdaq-acc/ACC/ZeroSuppressor.h"
+
+#include <array>
+#include <memory>
 
 namespace ots
 {
@@ -25,14 +38,49 @@ class ACCBurstDataSaverConsumer : public RawDataSaverConsumerBase
 	virtual void closeFile(void) override;
 	virtual void save(const std::string& data) override;
   protected:
-	void saveToFile();
-	int current_pk_; //0-7, denotes packet number of each event. One event consists of 8 packets, 1445 words * 64 bit. The first word of the first packet determines the storage location. 
-	int current_file_; //The index in outFiles_ we are currently writing to. Set at each 0th packet and stays the same for the following 7 packets.
-	std::vector<std::ofstream> outFiles_; //one output file per ACDC board.
+	void commitEvent(int slot); //writes one fully assembled event to its board file
+	void quarantineEvent(); //writes the event of an unknown board to the quarantine file, opened on the first one
+	EventAssembler eventAssembler_; //collects the 8 packets of each event, one slot per entry of outFiles_. The first word of the first packet determines the slot.
+	std::vector<std::unique_ptr<AsyncFileWriter>> outFiles_; //one output file per ACDC board, each written from its own thread.
+	AsyncFileWriter::Options writerOptions_;
+	std::vector<std::unique_ptr<RunFileWriter>> runFiles_; //indexed run file format on top of outFiles_, only used if indexedFiles_
+	bool indexedFiles_;
+	uint64_t configHash_; //written into the run file headers
+	CompressPipeline compressPipeline_; //optional lossless compression into runFiles_, one lane per entry of outFiles_
+	CompressPipeline::Options compressOptions_;
+	bool compressFiles_;
+	std::vector<std::unique_ptr<ZeroSuppressor>> zeroSuppressors_; //optional zero suppression of the saved events, one per entry of outFiles_
+	std::vector<ZeroSuppressor::Options> zeroSuppressionOptions_; //per board, thresholds and pedestals from the ACDC parameters
+	bool suppressZeros_;
+	DecodePipeline decodePipeline_; //optional online decoding of the saved events, one lane per entry of outFiles_
+	DecodePipeline::Options decodeOptions_;
+	bool decodeEvents_;
+	std::vector<std::unique_ptr<PedestalCalculator>> pedestalCalculators_; //optional pedestal calibration, one per entry of outFiles_, fed by the decode workers
+	bool calibratePedestals_;
+	std::vector<std::unique_ptr<FeatureExtractor>> featureExtractors_; //optional hit extraction, one per entry of outFiles_, run by the decode workers
+	std::vector<std::unique_ptr<AsyncFileWriter>> hitFiles_; //ChannelHit records, one file per board
+	std::vector<std::vector<ChannelHit>> hitBuffers_;
+	FeatureExtractor::Options featureOptions_;
+	bool extractFeatures_;
+	EventBuilder eventBuilder_; //optional online matching of the boards' events into multi-board events, one lane per entry of outFiles_
+	EventBuilder::Options builderOptions_;
+	bool buildEvents_;
+	std::unique_ptr<AsyncFileWriter> builtFile_; //built events, see EventBuilder::serialize
+	std::vector<uint64_t> builtRecord_;
+	bool throwOnUnknownBoard_; //UnknownBoardPolicy "Throw": a packet of a board not in acdc_board_numbers stops the run
+	bool quarantineUnknownBoards_; //UnknownBoardPolicy "Quarantine": their events go to quarantineFile_, otherwise they are dropped
+	std::unique_ptr<AsyncFileWriter> quarantineFile_;
+	std::string quarantineFileName_;
+	bool quarantineFailed_; //the quarantine file of this file could not be opened, retried in the next openFile
+	uint64_t nQuarantineDropped_; //events of unknown boards dropped because of quarantineFailed_
+	std::array<uint64_t, 256> unknownBoardEvents_; //events per board byte of the boards not configured
+	uint64_t nHeaderErrors_;
+	LogRateLimiter unknownBoardLog_;
+	LogRateLimiter headerErrorLog_;
+	LogRateLimiter passThroughLog_; //events the zero suppression saved unchanged
 	std::vector<int> acdc_board_numbers;
 	std::vector<std::string> acdc_board_ids;
 
-	int lastPacketID_;
 	int packetCount_ ;
 };
 }  // namespace ots
@@ -1,12 +1,41 @@
 #include "otsdaq-acc/DataProcessorPlugins/ACCBurstDataSaverConsumer.h"
 #include "otsdaq/Macros/ProcessorPluginMacros.h"
 #include "otsdaq-acc/ACC/ACDC.h"
+#include "otsdaq-acc/ACC/WaveformCodec.h"
 
 #include <algorithm>
+#include <cstring>
 #include <vector>
 
 using namespace ots;
 
+namespace
+{
+//reads an optional column of the consumer table, falling back to the default if it is not there
+template<class T>
+T getOptionalValue(const ConfigurationTree& node, const std::string& name, const T& defaultValue)
+{
+    try
+    {
+	return node.getNode(name).getValue<T>();
+    }
+    catch(...)
+    {
+	return defaultValue;
+    }
+}
+
+//replaces "{board}" in a file name pattern by the board ID
+std::string boardFileName(std::string pattern, const std::string& boardID)
+{
+    for(size_t pos = pattern.find("{board}"); pos != std::string::npos; pos = pattern.find("{board}", pos + boardID.size()))
+    {
+	pattern.replace(pos, 7, boardID);
+    }
+    return pattern;
+}
+}
+
 //==============================================================================
 ACCBurstDataSaverConsumer::ACCBurstDataSaverConsumer(
     std::string              supervisorApplicationUID,
@@ -20,9 +49,21 @@ ACCBurstDataSaverConsumer::ACCBurstDataSaverConsumer(
                                processorUID,
                                theXDAQContextConfigTree,
                                configurationPath)
+    , indexedFiles_(false)
+    , configHash_(0)
+    , compressFiles_(false)
+    , suppressZeros_(false)
+    , decodeEvents_(false)
+    , calibratePedestals_(false)
+    , extractFeatures_(false)
+    , buildEvents_(false)
+    , throwOnUnknownBoard_(false)
+    , quarantineUnknownBoards_(true)
+    , quarantineFailed_(false)
+    , nQuarantineDropped_(0)
+    , nHeaderErrors_(0)
 {
-    current_pk_ = 0;
-    lastPacketID_ = -1;
+    unknownBoardEvents_.fill(0);
 }
 
 //==============================================================================
@@ -34,18 +75,37 @@ void ACCBurstDataSaverConsumer::configure(void)
 {
     acdc_board_numbers.clear();
     acdc_board_ids.clear();
+    zeroSuppressionOptions_.clear();
+    std::stringstream configSnapshot;
 
     //Is this a good practice?
     try
     {
 	ConfigurationTree accTable = theXDAQContextConfigTree_.getNode(theConfigurationPath_).getNode("LinkToACCInterfaceTable");
 	uint32_t acdcMask = accTable.getNode("ACDCMask").getValue<uint32_t>();
+	configSnapshot << "ACDCMask=" << acdcMask << ";";
 	for(unsigned int i = 0; i < 8; i++)
 	{
 	    if(acdcMask & (1 << i))
 	    {
 		acdc_board_numbers.push_back(i);
 		acdc_board_ids.push_back(accTable.getNode("LinkToACDC"+std::to_string(i)+"Parameters").getNode("InterfaceID").getValue<std::string>());
+		configSnapshot << "ACDC" << i << "=" << acdc_board_ids.back() << ";";
+
+		//zero suppression thresholds: the self trigger settings, pedestals per chip
+		ZeroSuppressor::Options options;
+		try
+		{
+		    ConfigurationTree acdcTable = accTable.getNode("LinkToACDC"+std::to_string(i)+"Parameters");
+		    options.polarity = acdcTable.getNode("SelfTrigPolarity").getValue<int>();
+		    std::fill_n(options.thresholds, NUM_CH, acdcTable.getNode("SelfTrigThresholds").getValue<unsigned int>());
+		    std::fill_n(options.fill, NUM_CH, acdcTable.getNode("Pedestals").getValue<unsigned int>());
+		}
+		catch(...)
+		{
+		    __CFG_COUT__ << "No self trigger settings for ACDC" << i << ", zero suppression uses the default thresholds" << __E__;
+		}
+		zeroSuppressionOptions_.push_back(options);
 	    }
 	}
     }
@@ -57,10 +117,165 @@ void ACCBurstDataSaverConsumer::configure(void)
 	acdc_board_ids.clear();
 	acdc_board_numbers = {0, 1, 2, 3};
 	acdc_board_ids = {"ACDC0", "ACDC1", "ACDC2","ACDC3"};
+	zeroSuppressionOptions_.assign(acdc_board_numbers.size(), ZeroSuppressor::Options());
+	configSnapshot.str("default;");
+    }
+
+    eventAssembler_.setBoards(acdc_board_numbers);
+
+    //File writer settings, the defaults buffer 64 MB per board
+    ConfigurationTree consumerTable = theXDAQContextConfigTree_.getNode(theConfigurationPath_);
+    writerOptions_ = AsyncFileWriter::Options();
+    writerOptions_.bufferSize = getOptionalValue<unsigned int>(consumerTable, "WriterBufferSizeMB", writerOptions_.bufferSize >> 20) << 20;
+    writerOptions_.nBuffers = getOptionalValue<int>(consumerTable, "WriterNumberOfBuffers", writerOptions_.nBuffers);
+    writerOptions_.directIO = getOptionalValue<bool>(consumerTable, "WriterDirectIO", writerOptions_.directIO);
+    std::string syncPolicy = getOptionalValue<std::string>(consumerTable, "WriterSyncPolicy", "None");
+    if(syncPolicy == "OnClose") writerOptions_.sync = AsyncFileWriter::SYNC_ON_CLOSE;
+    else if(syncPolicy == "EachBuffer") writerOptions_.sync = AsyncFileWriter::SYNC_EACH_BUFFER;
+    else writerOptions_.sync = AsyncFileWriter::SYNC_NONE;
+
+    //Events of boards that are not in the ACDC mask: "Quarantine" writes them to a separate file,
+    //"Drop" discards them, "Throw" stops the run as soon as one shows up
+    std::string unknownBoardPolicy = getOptionalValue<std::string>(consumerTable, "UnknownBoardPolicy", "Quarantine");
+    throwOnUnknownBoard_ = unknownBoardPolicy == "Throw";
+    quarantineUnknownBoards_ = !throwOnUnknownBoard_ && unknownBoardPolicy != "Drop";
+    eventAssembler_.setQuarantine(quarantineUnknownBoards_);
+
+    //File format: "Raw" writes the bare events, "Indexed" the seekable run file format (see RunFile.h),
+    //"Compressed" the run file format with losslessly compressed events (see WaveformCodec.h)
+    std::string fileFormat = getOptionalValue<std::string>(consumerTable, "FileFormat", "Raw");
+    compressFiles_ = fileFormat == "Compressed";
+    indexedFiles_ = fileFormat == "Indexed" || compressFiles_;
+    compressOptions_ = CompressPipeline::Options();
+    compressOptions_.nWorkers = getOptionalValue<int>(consumerTable, "CompressionWorkers", 0);
+    compressOptions_.queueDepth = getOptionalValue<unsigned int>(consumerTable, "CompressionQueueDepth", compressOptions_.queueDepth);
+    compressOptions_.zstdLevel = getOptionalValue<int>(consumerTable, "CompressionLevel", compressOptions_.zstdLevel);
+    std::stringstream compressCores(getOptionalValue<std::string>(consumerTable, "CompressionWorkerCores", ""));
+    for(std::string core; std::getline(compressCores, core, ',');)
+    {
+	try
+	{
+	    compressOptions_.cores.push_back(std::stoi(core));
+	}
+	catch(...)
+	{
+	    compressOptions_.cores.push_back(-1);
+	}
+    }
+    configSnapshot << "FileFormat=" << fileFormat << ";";
+
+    //Zero suppression of the saved events (see ZeroSuppressor.h): "Channels" drops channels without a sample past
+    //the board's self trigger threshold, "Window" keeps only a window around the peak of the others. Only the
+    //files are suppressed, decoding and event building still see the full events. The self trigger
+    //thresholds are DAC settings and taken as ADC counts (both 12 bit); ZeroSuppressionThreshold overrides them.
+    std::string zeroSuppression = getOptionalValue<std::string>(consumerTable, "ZeroSuppression", "Off");
+    suppressZeros_ = zeroSuppression == "Channels" || zeroSuppression == "Window";
+    unsigned int zeroSuppressionThreshold = getOptionalValue<unsigned int>(consumerTable, "ZeroSuppressionThreshold", 0);
+    for(ZeroSuppressor::Options& options : zeroSuppressionOptions_)
+    {
+	options.mode = zeroSuppression == "Window" ? ZeroSuppressor::PEAK_WINDOW : suppressZeros_ ? ZeroSuppressor::DROP_QUIET_CHANNELS : ZeroSuppressor::OFF;
+	options.windowPre = getOptionalValue<int>(consumerTable, "ZeroSuppressionWindowPre", options.windowPre);
+	options.windowPost = getOptionalValue<int>(consumerTable, "ZeroSuppressionWindowPost", options.windowPost);
+	if(zeroSuppressionThreshold > 0) std::fill_n(options.thresholds, NUM_CH, zeroSuppressionThreshold);
+    }
+    configSnapshot << "ZeroSuppression=" << zeroSuppression << ";";
+
+    //Online decoding, off unless decode workers are requested
+    decodeOptions_ = DecodePipeline::Options();
+    decodeOptions_.nWorkers = getOptionalValue<int>(consumerTable, "DecodeWorkers", 0);
+    decodeOptions_.queueDepth = getOptionalValue<unsigned int>(consumerTable, "DecodeQueueDepth", decodeOptions_.queueDepth);
+    std::stringstream cores(getOptionalValue<std::string>(consumerTable, "DecodeWorkerCores", ""));
+    for(std::string core; std::getline(cores, core, ',');)
+    {
+	try
+	{
+	    decodeOptions_.cores.push_back(std::stoi(core));
+	}
+	catch(...)
+	{
+	    decodeOptions_.cores.push_back(-1);
+	}
+    }
+    decodeEvents_ = decodeOptions_.nWorkers > 0;
+
+    //Calibrated waveforms for the decode callback: "mV" or "Counts" (pedestal subtracted), from the calibration
+    //files given, "{board}" in the file names is replaced by the board ID
+    std::string calibratedOutput = getOptionalValue<std::string>(consumerTable, "CalibratedOutput", "None");
+    decodeOptions_.outputMode = calibratedOutput == "mV" ? ACDC::CALIBRATED_MV : calibratedOutput == "Counts" ? ACDC::PEDESTAL_SUBTRACTED : ACDC::RAW_COUNTS;
+    decodeOptions_.calibrations.clear();
+    if(decodeOptions_.outputMode != ACDC::RAW_COUNTS)
+    {
+	std::string pedestalFile = getOptionalValue<std::string>(consumerTable, "CalibrationPedestalFile", "");
+	std::string linearityFile = getOptionalValue<std::string>(consumerTable, "CalibrationLinearityFile", "");
+	for(const std::string& boardID : acdc_board_ids)
+	{
+	    std::shared_ptr<WaveformCalibration> calibration(new WaveformCalibration());
+	    std::string fileName = boardFileName(pedestalFile, boardID);
+	    if(fileName != "" && !calibration->loadPedestals(fileName))
+	    {
+		__CFG_SS__ << "Can't load the pedestal file " << fileName << std::endl;
+		__CFG_SS_THROW__;
+	    }
+	    fileName = boardFileName(linearityFile, boardID);
+	    if(fileName != "" && !calibration->loadLinearity(fileName))
+	    {
+		__CFG_SS__ << "Can't load the linearity file " << fileName << std::endl;
+		__CFG_SS_THROW__;
+	    }
+	    decodeOptions_.calibrations.push_back(calibration);
+	}
+    }
+
+    //Pedestal calibration from the decoded events, meant for software-trigger runs; needs decoding (one worker per board by default)
+    calibratePedestals_ = getOptionalValue<bool>(consumerTable, "PedestalCalibration", false);
+
+    //Feature extraction from the decoded events into a hit stream per board (see FeatureExtractor.h); needs decoding as well
+    extractFeatures_ = getOptionalValue<bool>(consumerTable, "ExtractFeatures", false);
+    featureOptions_ = FeatureExtractor::Options();
+    featureOptions_.polarity = getOptionalValue<int>(consumerTable, "FeaturePolarity", featureOptions_.polarity);
+    featureOptions_.hitThreshold = getOptionalValue<float>(consumerTable, "FeatureHitThreshold", featureOptions_.hitThreshold);
+    featureOptions_.cfdFraction = getOptionalValue<float>(consumerTable, "FeatureCFDFraction", featureOptions_.cfdFraction);
+    featureOptions_.leadingEdgeThreshold = getOptionalValue<float>(consumerTable, "FeatureLeadingEdgeThreshold", featureOptions_.leadingEdgeThreshold);
+    if(getOptionalValue<std::string>(consumerTable, "FeatureTiming", "CFD") == "LeadingEdge") featureOptions_.timing = FeatureExtractor::LEADING_EDGE;
+
+    if(calibratePedestals_ || extractFeatures_)
+    {
+	decodeEvents_ = true;
+	decodePipeline_.setCallback([this](int lane, const ACDC& acdc, std::span<const uint64_t> event)
+	{
+	    //per lane state, only touched by the worker owning the lane
+	    if(calibratePedestals_) pedestalCalculators_[lane]->add(acdc.getWaveforms());
+	    if(extractFeatures_)
+	    {
+		std::vector<ChannelHit>& hits = hitBuffers_[lane];
+		hits.clear();
+		uint32_t eventCount = 0;
+		uint64_t timestamp;
+		EventBuilder::extractKey(event, eventCount, timestamp);
+		if(acdc.getOutputMode() == ACDC::CALIBRATED_MV) featureExtractors_[lane]->extract(acdc.getCalibratedWaveforms(), acdc.getBoardIndex(), eventCount, hits, acdc.getNumSamples());
+		else featureExtractors_[lane]->extract(acdc.getWaveforms(), acdc.getBoardIndex(), eventCount, hits, acdc.getNumSamples());
+		if(!hits.empty()) hitFiles_[lane]->write(hits.data(), hits.size()*sizeof(ChannelHit));
+	    }
+	});
     }
+    else decodePipeline_.setCallback(DecodePipeline::Callback());
 
-    current_pk_ = 0;
-    lastPacketID_ = -1;    
+    //Online event building across boards, off by default
+    buildEvents_ = getOptionalValue<bool>(consumerTable, "BuildEvents", false);
+    builderOptions_ = EventBuilder::Options();
+    builderOptions_.timestampTolerance = getOptionalValue<uint64_t>(consumerTable, "EventBuildTimestampTolerance", builderOptions_.timestampTolerance);
+    builderOptions_.matchEventCount = getOptionalValue<bool>(consumerTable, "EventBuildMatchEventCount", builderOptions_.matchEventCount);
+    builderOptions_.reorderDepth = getOptionalValue<unsigned int>(consumerTable, "EventBuildReorderDepth", builderOptions_.reorderDepth);
+    builderOptions_.timeout = std::chrono::milliseconds(getOptionalValue<unsigned int>(consumerTable, "EventBuildTimeoutMs", builderOptions_.timeout.count()/1000));
+    eventBuilder_.setCallback([this](const EventBuilder::BuiltEvent& event)
+    {
+	builtRecord_.clear();
+	EventBuilder::serialize(event, builtRecord_);
+	builtFile_->write(builtRecord_.data(), builtRecord_.size()*sizeof(uint64_t));
+    });
+    configSnapshot << "BuildEvents=" << buildEvents_ << ";DecodeWorkers=" << decodeOptions_.nWorkers << ";";
+
+    configHash_ = RunFileWriter::hashConfig(configSnapshot.str());
 }
 
 
@@ -68,6 +283,7 @@ void ACCBurstDataSaverConsumer::configure(void)
 void ACCBurstDataSaverConsumer::openFile(std::string runNumber)
 {
     outFiles_.clear();
+    runFiles_.clear();
     currentRunNumber_ = runNumber;
     for(unsigned int i = 0;i<acdc_board_numbers.size();i++)
     {
@@ -77,30 +293,253 @@ void ACCBurstDataSaverConsumer::openFile(std::string runNumber)
 	// if split file is there then subrunnumber must be set!
 	if(maxFileSize_ > 0) fileName << "_" << currentSubRunNumber_;
 
-	fileName << "_Raw.dat";
+	fileName << (compressFiles_ ? "_Raw.accz" : indexedFiles_ ? "_Raw.accrun" : "_Raw.dat");
 	__CFG_COUT__ << "Saving file: " << fileName.str() << std::endl;
 
-	outFiles_.emplace_back(fileName.str(), std::ios::out | std::ios::binary);
+	outFiles_.emplace_back(new AsyncFileWriter());
 
-	if(!outFiles_[i].is_open())
+	if(!outFiles_[i]->open(fileName.str(), writerOptions_))
         {
 	    __CFG_SS__ << "Can't open file " << fileName.str() << std::endl;
 	    __CFG_SS_THROW__;
         }
+	if(outFiles_[i]->isDirectIOFallback()) __CFG_COUT__ << "O_DIRECT not supported for " << fileName.str() << ", using buffered I/O" << __E__;
+	if(indexedFiles_)
+	{
+	    RunFileWriter::Info info;
+	    info.runNumber = strtoull(runNumber.c_str(), nullptr, 10);
+	    info.subRunNumber = maxFileSize_ > 0 ? currentSubRunNumber_ : 0;
+	    info.boardIndex = acdc_board_numbers[i];
+	    info.boardID = acdc_board_ids[i];
+	    info.configHash = configHash_;
+	    info.compressed = compressFiles_;
+	    runFiles_.emplace_back(new RunFileWriter(*outFiles_[i]));
+	    runFiles_[i]->begin(info);
+	}
     }
+    if(buildEvents_)
+    {
+	std::stringstream fileName;
+	fileName << filePath_ << "/" << fileRadix_ << "_Run" << runNumber;
+	if(maxFileSize_ > 0) fileName << "_" << currentSubRunNumber_;
+	fileName << "_Built.dat";
+	__CFG_COUT__ << "Saving built events to: " << fileName.str() << std::endl;
+
+	builtFile_.reset(new AsyncFileWriter());
+	if(!builtFile_->open(fileName.str(), writerOptions_))
+	{
+	    __CFG_SS__ << "Can't open file " << fileName.str() << std::endl;
+	    __CFG_SS_THROW__;
+	}
+	if(builtFile_->isDirectIOFallback()) __CFG_COUT__ << "O_DIRECT not supported for " << fileName.str() << ", using buffered I/O" << __E__;
+	eventBuilder_.start(acdc_board_numbers.size(), builderOptions_);
+    }
+
+    eventAssembler_.reset();
     packetCount_ = 0;
+
+    //only created if an event of an unknown board shows up
+    std::stringstream quarantineFileName;
+    quarantineFileName << filePath_ << "/" << fileRadix_ << "_Run" << runNumber;
+    if(maxFileSize_ > 0) quarantineFileName << "_" << currentSubRunNumber_;
+    quarantineFileName << "_Quarantine.dat";
+    quarantineFileName_ = quarantineFileName.str();
+    quarantineFile_.reset();
+    //a quarantine file that could not be opened for the last file is tried again
+    quarantineFailed_ = false;
+    nQuarantineDropped_ = 0;
+    eventAssembler_.setQuarantine(quarantineUnknownBoards_);
+    unknownBoardEvents_.fill(0);
+    nHeaderErrors_ = 0;
+    unknownBoardLog_.reset();
+    headerErrorLog_.reset();
+    passThroughLog_.reset();
+
+    zeroSuppressors_.clear();
+    if(suppressZeros_)
+    {
+	for(unsigned int i = 0; i < acdc_board_numbers.size(); i++)
+	{
+	    zeroSuppressors_.emplace_back(new ZeroSuppressor());
+	    zeroSuppressors_.back()->setOptions(zeroSuppressionOptions_[i]);
+	}
+    }
+
+    if(compressFiles_)
+    {
+	std::vector<RunFileWriter*> outputs;
+	for(auto& runFile : runFiles_) outputs.push_back(runFile.get());
+	compressPipeline_.start(outputs, compressOptions_);
+	__CFG_COUT__ << "Compressing events on " << compressPipeline_.getNumWorkers() << " worker threads" << (WaveformCodec::hasZstd() ? " with zstd" : "") << __E__;
+	for(int worker : compressPipeline_.getUnpinnedWorkers()) __CFG_COUT__ << "Could not pin compression worker " << worker << " to core " << compressOptions_.cores[worker] << __E__;
+    }
+
+    pedestalCalculators_.clear();
+    if(calibratePedestals_)
+    {
+	for(unsigned int i = 0; i < acdc_board_numbers.size(); i++) pedestalCalculators_.emplace_back(new PedestalCalculator());
+    }
+
+    featureExtractors_.clear();
+    hitFiles_.clear();
+    hitBuffers_.clear();
+    if(extractFeatures_)
+    {
+	hitBuffers_.resize(acdc_board_numbers.size());
+	for(unsigned int i = 0; i < acdc_board_numbers.size(); i++)
+	{
+	    featureExtractors_.emplace_back(new FeatureExtractor());
+	    featureExtractors_.back()->setOptions(featureOptions_);
+
+	    std::stringstream fileName;
+	    fileName << filePath_ << "/" << fileRadix_ << "_" << acdc_board_ids[i] << "_Run" << runNumber;
+	    if(maxFileSize_ > 0) fileName << "_" << currentSubRunNumber_;
+	    fileName << "_Hits.dat";
+	    __CFG_COUT__ << "Saving hits to: " << fileName.str() << std::endl;
+
+	    hitFiles_.emplace_back(new AsyncFileWriter());
+	    if(!hitFiles_.back()->open(fileName.str(), writerOptions_))
+	    {
+		__CFG_SS__ << "Can't open file " << fileName.str() << std::endl;
+		__CFG_SS_THROW__;
+	    }
+	    if(hitFiles_.back()->isDirectIOFallback()) __CFG_COUT__ << "O_DIRECT not supported for " << fileName.str() << ", using buffered I/O" << __E__;
+	}
+    }
+
+    if(decodeEvents_)
+    {
+	decodePipeline_.start(acdc_board_numbers, decodeOptions_);
+	__CFG_COUT__ << "Decoding events on " << decodePipeline_.getNumWorkers() << " worker threads" << __E__;
+	for(int worker : decodePipeline_.getUnpinnedWorkers()) __CFG_COUT__ << "Could not pin decode worker " << worker << " to core " << decodeOptions_.cores[worker] << __E__;
+    }
 }
 
 //==============================================================================
 void ACCBurstDataSaverConsumer::closeFile(void)
 {
-    __CFG_COUT__ << "Packet Count: " << packetCount_ << __E__;
+    __CFG_COUT__ << "Packet Count: " << packetCount_ << ", lost " << eventAssembler_.getNLostPackets() << ", "
+                 << eventAssembler_.getNResyncs() << " resynchronisations" << __E__;
+    if(nHeaderErrors_ > 0) __CFG_COUT__ << nHeaderErrors_ << " header errors, " << headerErrorLog_.getNSuppressed() << " of them not logged" << __E__;
+    for(int board = 0; board < 256; board++)
+    {
+	if(unknownBoardEvents_[board] == 0) continue;
+	__CFG_COUT__ << unknownBoardEvents_[board] << " events of unknown board " << board
+	             << (quarantineUnknownBoards_ && !quarantineFailed_ ? " quarantined in " + quarantineFileName_ : std::string(" dropped")) << __E__;
+    }
+    if(nQuarantineDropped_ > 0)
+    {
+	__CFG_COUT_ERR__ << nQuarantineDropped_ << " events of unknown boards dropped, the quarantine file " << quarantineFileName_ << " could not be opened" << __E__;
+    }
+    if(quarantineFile_)
+    {
+	quarantineFile_->close();
+	if(quarantineFile_->getError())
+	{
+	    __CFG_COUT_ERR__ << "Write error on " << quarantineFile_->getFileName() << ": " << strerror(quarantineFile_->getError()) << __E__;
+	}
+	quarantineFile_.reset();
+    }
+    for(int i = -1; i < (int)acdc_board_ids.size() && eventAssembler_.getNLostPackets() > 0; i++)
+    {
+	const EventAssembler::LossStats& loss = eventAssembler_.getLossStats(i);
+	std::stringstream bursts;
+	for(int bin = 0; bin < EventAssembler::LOSS_BURST_BINS; bin++) bursts << " " << loss.burstLength[bin];
+	__CFG_COUT__ << (i < 0 ? std::string("Events with lost header") : acdc_board_ids[i]) << ": " << loss.nPacketsLost << " packets lost in "
+	             << loss.nEventsLost << " events, bursts by length (1, 2, 3-4, ..., 129-255):" << bursts.str() << __E__;
+    }
+
+    if(decodePipeline_.isRunning())
+    {
+	decodePipeline_.stop();
+	for(int i = 0; i < decodePipeline_.getNumLanes(); i++)
+	{
+	    DecodePipeline::Stats stats = decodePipeline_.getStats(i);
+	    __CFG_COUT__ << acdc_board_ids[i] << ": decoded " << stats.nDecoded << " of " << stats.nQueued << " events, "
+	                 << stats.nErrors << " corrupt, " << stats.nBadLength << " of unexpected length, " << stats.nDropped << " not decoded (queue full)" << __E__;
+	}
+
+	//the workers are done with the calculators, next to the raw files as <radix>_<board>_Run<run>[_<subrun>]_Pedestals.dat
+	for(unsigned int i = 0; i < pedestalCalculators_.size(); i++)
+	{
+	    PedestalCalibration calibration;
+	    pedestalCalculators_[i]->getCalibration(calibration);
+	    calibration.boardIndex = acdc_board_numbers[i];
+
+	    std::stringstream fileName;
+	    fileName << filePath_ << "/" << fileRadix_ << "_" << acdc_board_ids[i] << "_Run" << currentRunNumber_;
+	    if(maxFileSize_ > 0) fileName << "_" << currentSubRunNumber_;
+	    fileName << "_Pedestals.dat";
+	    if(calibration.save(fileName.str()))
+	    {
+		__CFG_COUT__ << acdc_board_ids[i] << ": pedestals of " << calibration.nEvents << " events saved to " << fileName.str() << __E__;
+	    }
+	    else __CFG_COUT_ERR__ << "Can't write the pedestal file " << fileName.str() << __E__;
+	}
+    }
+    //the decode workers write the hits, so only once they have stopped
+    for(unsigned int i = 0; i < hitFiles_.size(); i++)
+    {
+	hitFiles_[i]->close();
+	AsyncFileWriter::Stats stats = hitFiles_[i]->getStats();
+	__CFG_COUT__ << acdc_board_ids[i] << ": wrote " << stats.bytesWritten << " bytes of hits" << __E__;
+	if(hitFiles_[i]->getError())
+	{
+	    __CFG_COUT_ERR__ << "Write error on " << hitFiles_[i]->getFileName() << ": " << strerror(hitFiles_[i]->getError()) << __E__;
+	}
+    }
+    hitFiles_.clear();
+    if(compressPipeline_.isRunning())
+    {
+	//writes what is still queued, has to happen before the files are closed
+	compressPipeline_.stop();
+	for(int i = 0; i < compressPipeline_.getNumLanes(); i++)
+	{
+	    CompressPipeline::Stats stats = compressPipeline_.getStats(i);
+	    __CFG_COUT__ << acdc_board_ids[i] << ": compressed " << stats.nEvents << " events, ratio "
+	                 << (stats.bytesOut ? (double)stats.bytesIn/stats.bytesOut : 0) << ", "
+	                 << (stats.busySeconds > 0 ? stats.bytesIn/stats.busySeconds/1e6 : 0) << " MB/s per worker" << __E__;
+	}
+    }
+    if(builtFile_ && builtFile_->is_open())
+    {
+	eventBuilder_.flush();
+	EventBuilder::Stats stats = eventBuilder_.getStats();
+	builtFile_->close();
+	__CFG_COUT__ << "Built " << stats.nComplete << " complete events, " << stats.nTimedOut << " timed out and "
+	             << stats.nOverflow << " pushed out incomplete, from " << stats.nFragments << " board events ("
+	             << stats.nBadFragments << " unusable)" << __E__;
+	if(builtFile_->getError())
+	{
+	    __CFG_COUT_ERR__ << "Write error on " << builtFile_->getFileName() << ": " << strerror(builtFile_->getError()) << __E__;
+	}
+    }
+    for(unsigned int i = 0; i < zeroSuppressors_.size(); i++)
+    {
+	ZeroSuppressor::Stats stats = zeroSuppressors_[i]->getStats();
+	__CFG_COUT__ << acdc_board_ids[i] << ": zero suppression kept " << stats.nChannelsKept << " of " << stats.nChannels << " channels, "
+	             << stats.bytesIn << " -> " << stats.bytesOut << " bytes, " << stats.nPassedThrough << " events not suppressed" << __E__;
+    }
     for(unsigned int i = 0;i<acdc_board_numbers.size();i++)
     {
-        if(outFiles_[i].is_open())
+        if(outFiles_[i]->is_open())
         {
-            //writeFooter();  // write end of file footer. However, it should be written at each file.
-            outFiles_[i].close();
+            if(i < runFiles_.size())
+            {
+                runFiles_[i]->finish();
+                __CFG_COUT__ << acdc_board_ids[i] << ": indexed " << runFiles_[i]->getNumEvents() << " events" << __E__;
+            }
+            //the stats only count the last buffers and the O_DIRECT tail once the file is closed
+            outFiles_[i]->close();
+            AsyncFileWriter::Stats stats = outFiles_[i]->getStats();
+
+            __CFG_COUT__ << acdc_board_ids[i] << ": wrote " << stats.bytesWritten << " bytes, peak buffer occupancy "
+                         << stats.peakBuffersInFlight << "/" << stats.nBuffers << ", " << stats.nStalls << " stalls ("
+                         << stats.stallSeconds << " s)" << __E__;
+            if(outFiles_[i]->getError())
+            {
+                __CFG_COUT_ERR__ << "Write error on " << outFiles_[i]->getFileName() << ": " << strerror(outFiles_[i]->getError()) << __E__;
+            }
         }
     }
 }
@@ -111,66 +550,122 @@ void ACCBurstDataSaverConsumer::save(const std::string& data)
   //__CFG_COUT__ << "Attempting to save data with length:" << data.length() <<std::endl;
   ++packetCount_;
 
-  //Check packet ID to ensure we have not dropped any packets
-  unsigned int currentPacketID = (unsigned int)*(reinterpret_cast<const unsigned char*>(data.c_str()+1));
-  unsigned int nextPacketID = ((lastPacketID_+1)%256);
-  if(lastPacketID_ > 0 && nextPacketID != currentPacketID)
+  //validated view of the packet, the payload is not copied until it lands in its event slot
+  AccPacketView packet(data);
+  EventAssembler::Status status = eventAssembler_.addPacket(packet);
+
+  if(eventAssembler_.packetGap())
   {
-      __CFG_COUT__ << "Dropped packet: Jumped from packet ID " << lastPacketID_ << " to " << currentPacketID << "\t" << packetCount_ << "\n";
-      //Packet loss, assume the current event is lost and start search for next header
-      current_pk_ = 0;
-      current_file_ = -1;
+      __CFG_COUT__ << "Dropped packet: Jumped from packet ID " << eventAssembler_.previousPacketID() << " to " << eventAssembler_.lastPacketID()
+		   << " (" << eventAssembler_.lostPackets() << " lost" << (eventAssembler_.lostSlot() >= 0 && eventAssembler_.lostSlot() < (int)acdc_board_ids.size() ? ", event of " + acdc_board_ids[eventAssembler_.lostSlot()] + " dropped" : "") << ")\t" << packetCount_ << "\n";
   }
-  lastPacketID_ = currentPacketID;
 
-  const uint64_t* packet_data = reinterpret_cast<const uint64_t*>(data.c_str()+2);
-  //__CFG_COUT__ << "current packet: " << current_pk_ << std::endl;  
-  if(current_pk_==0)
+  switch(status)
   {
-    //__CFG_COUT__ <<"Packet_data 0 is:"<< std::hex << packet_data[0] << "\t" << packet_data[1] << std::endl;
-    if((packet_data[0]&0xffffffffffffff00) == 0x123456789abcde00 && 
-       (packet_data[1]&0xffff000000000000) == 0xac9c000000000000)
-    {
-        int data_bi = packet_data[0] & 0xff;
-	current_file_ = -1;
-	for(unsigned int i = 0; i < acdc_board_numbers.size(); i++)
-        {
-	    //base command for set data readmode and which board bi to read
-	    int bi = acdc_board_numbers[i];//acdcs[i].getBoardIndex();
-
-	    if(data_bi == bi)
-            {
-	      current_file_ = i;
-	      break;
-            }
-        }
-	if(current_file_ == -1)
-	  {
-	    __CFG_SS__ << "Board number not found in the config but got a UDP packet with it: " << data_bi << std::endl;
-	    __CFG_SS_THROW__;
-	  }
-    }
-    else
-    {
-        __CFG_COUT__ << "Header error: "<< std::hex << packet_data[0] << " " << std::hex << packet_data[1] << std::endl;
-	return;
-	//Skip to next packet in search of valid header.  
-    }
+  case EventAssembler::EVENT_COMPLETE:
+      commitEvent(eventAssembler_.completedSlot());
+      break;
+  case EventAssembler::HEADER_ERROR:
+      ++nHeaderErrors_;
+      if(headerErrorLog_.allow())
+      {
+	  uint64_t skipped = headerErrorLog_.takeSkipped();
+	  __CFG_COUT__ << "Header error: "<< std::hex << eventAssembler_.headerWord(0) << " " << std::hex << eventAssembler_.headerWord(1) << std::dec
+		       << (skipped ? " (" + std::to_string(skipped) + " more since the last message)" : "") << std::endl;
+      }
+      break;
+  case EventAssembler::UNKNOWN_BOARD:
+      //a stray board or a flipped bit in the header, only stops the run if asked to
+      ++unknownBoardEvents_[eventAssembler_.headerBoard() & 0xff];
+      if(quarantineFailed_) ++nQuarantineDropped_;
+      if(throwOnUnknownBoard_)
+      {
+	  __CFG_SS__ << "Board number not found in the config but got a UDP packet with it: " << eventAssembler_.headerBoard() << std::endl;
+	  __CFG_SS_THROW__;
+      }
+      if(unknownBoardLog_.allow())
+      {
+	  uint64_t skipped = unknownBoardLog_.takeSkipped();
+	  __CFG_COUT__ << "Board number not found in the config but got a UDP packet with it: " << eventAssembler_.headerBoard()
+		       << (quarantineUnknownBoards_ && !quarantineFailed_ ? ", event quarantined" : ", event dropped")
+		       << (skipped ? " (" + std::to_string(skipped) + " more since the last message)" : "") << std::endl;
+      }
+      break;
+  case EventAssembler::EVENT_QUARANTINED:
+      quarantineEvent();
+      break;
+  case EventAssembler::NO_EVENT:
+      //rest of an event whose header was lost, reported with the gap
+      break;
+  case EventAssembler::PACKET_ACCEPTED:
+      break;
   }
-  if(current_file_ < 0 || current_file_ >= 8)
+}
+
+//==============================================================================
+//Whole events are written with a single call, so a corrupt or incomplete
+//event never ends up in the file. The call only copies the event into the
+//writer's buffer ring, the disk I/O happens on the writer thread.
+void ACCBurstDataSaverConsumer::commitEvent(int slot)
+{
+  if(slot < 0 || slot >= (int)outFiles_.size()) return;
+
+  const char* data = eventAssembler_.eventData(slot);
+  size_t size = eventAssembler_.eventSize(slot);
+  std::span<const uint64_t> words = eventAssembler_.eventWords(slot);
+  if(suppressZeros_)
   {
-      __CFG_COUT__ << "Current file not set" << "\n";
-      current_pk_=0;
-      //Something went wrong, ignore this event and searchx for next header
-      return;
+      //unchanged events come back as the input and keep their original size
+      std::span<const uint64_t> suppressed = zeroSuppressors_[slot]->suppress(words);
+      if(suppressed.data() != words.data())
+      {
+	  words = suppressed;
+	  data = (const char*)suppressed.data();
+	  size = suppressed.size_bytes();
+      }
+      else if(passThroughLog_.allow())
+      {
+	  uint64_t skipped = passThroughLog_.takeSkipped();
+	  __CFG_COUT__ << acdc_board_ids[slot] << ": event of " << words.size() << " words without ACDC header or samples saved without zero suppression"
+		       << (skipped ? " (" + std::to_string(skipped) + " more since the last message)" : "") << std::endl;
+      }
   }
 
-  current_pk_ = (current_pk_ + 1)%8;
-  //TODO: We should buffer a full event and then write or we may end up writing partial events.  
-  outFiles_[current_file_].write(data.c_str()+2, data.size()-2);  
-  //__CFG_COUT__ << "Wrote " << data.size() << " bytes successfully."<< "\n";
-	
+  if(compressFiles_) compressPipeline_.push(slot, words, size);
+  else if(indexedFiles_) runFiles_[slot]->writeEvent(data, size);
+  else outFiles_[slot]->write(data, size);
+  if(decodeEvents_) decodePipeline_.push(slot, eventAssembler_.eventWords(slot));
+  if(buildEvents_) eventBuilder_.add(slot, eventAssembler_.eventWords(slot));
+  //__CFG_COUT__ << "Wrote " << eventAssembler_.eventSize(slot) << " bytes successfully."<< "\n";
 }
 
+//==============================================================================
+//The quarantine file holds the bare events like a _Raw.dat file, the board
+//byte in their headers tells them apart.
+void ACCBurstDataSaverConsumer::quarantineEvent()
+{
+  int slot = eventAssembler_.completedSlot();
+  if(!quarantineFile_)
+  {
+      quarantineFile_.reset(new AsyncFileWriter());
+      //small buffers, quarantined events are rare
+      AsyncFileWriter::Options options = writerOptions_;
+      options.bufferSize = std::min<size_t>(options.bufferSize, 1 << 20);
+      options.nBuffers = 2;
+      if(!quarantineFile_->open(quarantineFileName_, options))
+      {
+	  //only for this file, openFile restores the quarantine
+	  __CFG_COUT_ERR__ << "Can't open the quarantine file " << quarantineFileName_ << ", events of unknown boards are dropped until the next file is opened" << __E__;
+	  quarantineFile_.reset();
+	  quarantineFailed_ = true;
+	  ++nQuarantineDropped_;
+	  eventAssembler_.setQuarantine(false);
+	  return;
+      }
+      __CFG_COUT__ << "Saving events of unknown boards to: " << quarantineFileName_ << __E__;
+      if(quarantineFile_->isDirectIOFallback()) __CFG_COUT__ << "O_DIRECT not supported for " << quarantineFileName_ << ", using buffered I/O" << __E__;
+  }
+  quarantineFile_->write(eventAssembler_.eventData(slot), eventAssembler_.eventSize(slot));
+}
 
 DEFINE_OTS_PROCESSOR(ACCBurstDataSaverConsumer)
@@ -0,0 +1,67 @@
+#ifndef _ots_ACCDQMConsumer_h_
+#define _ots_ACCDQMConsumer_h_
+
+// Online data quality monitoring of the ACC burst data. It reads the same
+// buffer as ACCBurstDataSaverConsumer but writes no data files: events are
+// assembled per board, analysed on the decode workers and the histograms
+// (see DQMHistograms.h) are published as snapshots in POSIX shared memory
+// on a timer. Viewers read the snapshots with SharedMemorySeqlock<DQMSnapshot>
+// without ever blocking the acquisition.
+
+#include "otsdaq/DataManager/RawDataSaverConsumerBase.h"
+#include "otsdaq-acc/ACC/DecodePipeline.h"
+#include "otsdaq-acc/ACC/DQMHistograms.h"
+#include "otsdaq-acc/ACC/EventAssembler.h"
+#include "otsdaq-acc/ACC/SharedMemorySeqlock.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace ots
+{
+class ACCDQMConsumer : public RawDataSaverConsumerBase
+{
+  public:
+	ACCDQMConsumer(std::string              supervisorApplicationUID,
+	               std::string              bufferUID,
+	               std::string              processorUID,
+	               const ConfigurationTree& theXDAQContextConfigTree,
+	               const std::string&       configurationPath);
+	virtual ~ACCDQMConsumer(void);
+	virtual void configure(void) override;
+	virtual void openFile(std::string runNumber) override; //starts the monitoring of a run, no file is opened
+	virtual void closeFile(void) override; //publishes the final snapshot of the run
+	virtual void save(const std::string& data) override;
+  protected:
+	void publisherThread();
+	void publish(); //merges the accumulators into snapshot_ and copies it to the shared memory
+	EventAssembler eventAssembler_; //one slot per entry of acdc_board_numbers
+	DecodePipeline decodePipeline_; //runs the waveform analysis, one lane per board
+	DecodePipeline::Options decodeOptions_;
+	std::vector<std::unique_ptr<DQMAccumulator>> accumulators_; //one per board, filled by the receiving thread and the lane's decode worker
+	DQMAccumulator::Options accumulatorOptions_;
+	unsigned int prescale_; //every prescale_-th event of a board is analysed
+	std::vector<uint64_t> eventCounts_;
+	SharedMemorySeqlock<DQMSnapshot> sharedMemory_;
+	std::string sharedMemoryName_;
+	std::unique_ptr<DQMSnapshot> snapshot_; //last published state, about 80 kB
+	std::chrono::milliseconds updateInterval_;
+	std::chrono::steady_clock::time_point runStart_;
+	std::chrono::steady_clock::time_point lastUpdate_;
+	std::thread publisher_;
+	std::mutex publisherMutex_;
+	std::condition_variable publisherWakeup_;
+	bool stopPublisher_;
+	std::atomic<uint64_t> nPackets_; //written by the receiving thread only
+	std::atomic<uint64_t> nPacketsLost_;
+	std::atomic<uint64_t> nEventsDropped_; //copy of the event assembler's counter for the publisher
+	std::vector<int> acdc_board_numbers;
+	std::vector<std::string> acdc_board_ids;
+};
+}  // namespace ots
+
+#endif
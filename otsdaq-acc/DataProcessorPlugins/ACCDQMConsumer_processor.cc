@@ -0,0 +1,269 @@
+#include "otsdaq-acc/DataProcessorPlugins/ACCDQMConsumer.h"
+#include "otsdaq/Macros/ProcessorPluginMacros.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+using namespace ots;
+
+namespace
+{
+//reads an optional column of the consumer table, falling back to the default if it is not there
+template<class T>
+T getOptionalValue(const ConfigurationTree& node, const std::string& name, const T& defaultValue)
+{
+    try
+    {
+	return node.getNode(name).getValue<T>();
+    }
+    catch(...)
+    {
+	return defaultValue;
+    }
+}
+
+//single writer counter update, see DQMAccumulator
+void increment(std::atomic<uint64_t>& counter, uint64_t n = 1)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+}
+
+//==============================================================================
+ACCDQMConsumer::ACCDQMConsumer(
+    std::string              supervisorApplicationUID,
+    std::string              bufferUID,
+    std::string              processorUID,
+    const ConfigurationTree& theXDAQContextConfigTree,
+    const std::string&       configurationPath)
+    : WorkLoop(processorUID)
+    , RawDataSaverConsumerBase(supervisorApplicationUID,
+                               bufferUID,
+                               processorUID,
+                               theXDAQContextConfigTree,
+                               configurationPath)
+    , prescale_(1)
+    , snapshot_(new DQMSnapshot())
+    , updateInterval_(1000)
+    , stopPublisher_(false)
+    , nPackets_(0)
+    , nPacketsLost_(0)
+    , nEventsDropped_(0)
+{
+    memset(snapshot_.get(), 0, sizeof(DQMSnapshot));
+}
+
+//==============================================================================
+ACCDQMConsumer::~ACCDQMConsumer(void)
+{
+    closeFile();
+}
+
+//==============================================================================
+void ACCDQMConsumer::configure(void)
+{
+    acdc_board_numbers.clear();
+    acdc_board_ids.clear();
+
+    try
+    {
+	ConfigurationTree accTable = theXDAQContextConfigTree_.getNode(theConfigurationPath_).getNode("LinkToACCInterfaceTable");
+	uint32_t acdcMask = accTable.getNode("ACDCMask").getValue<uint32_t>();
+	for(unsigned int i = 0; i < 8; i++)
+	{
+	    if(acdcMask & (1 << i))
+	    {
+		acdc_board_numbers.push_back(i);
+		acdc_board_ids.push_back(accTable.getNode("LinkToACDC"+std::to_string(i)+"Parameters").getNode("InterfaceID").getValue<std::string>());
+	    }
+	}
+    }
+    catch(...)
+    {
+	//Settings not found
+	__CFG_COUT__ << "ACC table parsive failed, falling back to default ACDC labels" << std::endl;
+	acdc_board_numbers = {0, 1, 2, 3};
+	acdc_board_ids = {"ACDC0", "ACDC1", "ACDC2","ACDC3"};
+    }
+    if(acdc_board_numbers.size() > (size_t)DQMSnapshot::MAX_BOARDS)
+    {
+	acdc_board_numbers.resize(DQMSnapshot::MAX_BOARDS);
+	acdc_board_ids.resize(DQMSnapshot::MAX_BOARDS);
+    }
+
+    eventAssembler_.setBoards(acdc_board_numbers);
+
+    ConfigurationTree consumerTable = theXDAQContextConfigTree_.getNode(theConfigurationPath_);
+
+    //Waveform analysis on the decode workers, one per board by default; events the workers can't keep up with are skipped
+    decodeOptions_ = DecodePipeline::Options();
+    decodeOptions_.nWorkers = getOptionalValue<int>(consumerTable, "DecodeWorkers", 0);
+    decodeOptions_.queueDepth = getOptionalValue<unsigned int>(consumerTable, "DecodeQueueDepth", decodeOptions_.queueDepth);
+    prescale_ = std::max(getOptionalValue<unsigned int>(consumerTable, "DQMPrescale", 1), 1u);
+
+    accumulatorOptions_ = DQMAccumulator::Options();
+    accumulatorOptions_.polarity = getOptionalValue<int>(consumerTable, "DQMPolarity", accumulatorOptions_.polarity);
+    accumulatorOptions_.baselineSamples = getOptionalValue<int>(consumerTable, "DQMBaselineSamples", accumulatorOptions_.baselineSamples);
+    accumulatorOptions_.hitThreshold = getOptionalValue<int>(consumerTable, "DQMHitThreshold", accumulatorOptions_.hitThreshold);
+
+    accumulators_.clear();
+    for(unsigned int i = 0; i < acdc_board_numbers.size(); i++)
+    {
+	accumulators_.emplace_back(new DQMAccumulator());
+	accumulators_.back()->setOptions(accumulatorOptions_);
+    }
+    decodePipeline_.setCallback([this](int lane, const ACDC& acdc, std::span<const uint64_t>)
+    {
+	accumulators_[lane]->addWaveforms(acdc.getWaveforms(), acdc.getNumSamples());
+    });
+
+    //Snapshot publishing
+    updateInterval_ = std::chrono::milliseconds(std::max(getOptionalValue<unsigned int>(consumerTable, "DQMUpdateIntervalMs", 1000), 10u));
+    std::string sharedMemoryName = getOptionalValue<std::string>(consumerTable, "DQMSharedMemoryName", "/otsdaq_acc_dqm");
+    if(sharedMemoryName.empty() || sharedMemoryName[0] != '/') sharedMemoryName = "/" + sharedMemoryName;
+    if(sharedMemoryName != sharedMemoryName_ || !sharedMemory_.isOpen())
+    {
+	if(!sharedMemory_.create(sharedMemoryName))
+	{
+	    __CFG_SS__ << "Can't create the shared memory segment " << sharedMemoryName << ": " << strerror(errno) << std::endl;
+	    __CFG_SS_THROW__;
+	}
+	sharedMemoryName_ = sharedMemoryName;
+    }
+    __CFG_COUT__ << "Publishing DQM snapshots every " << updateInterval_.count() << " ms to shared memory " << sharedMemoryName_ << __E__;
+}
+
+//==============================================================================
+void ACCDQMConsumer::openFile(std::string runNumber)
+{
+    closeFile();
+    currentRunNumber_ = runNumber;
+
+    eventAssembler_.reset();
+    eventCounts_.assign(acdc_board_numbers.size(), 0);
+    for(auto& accumulator : accumulators_) accumulator->reset();
+    nPackets_.store(0, std::memory_order_relaxed);
+    nPacketsLost_.store(0, std::memory_order_relaxed);
+    nEventsDropped_.store(0, std::memory_order_relaxed);
+
+    memset(snapshot_.get(), 0, sizeof(DQMSnapshot));
+    snapshot_->version = DQMSnapshot::VERSION;
+    snapshot_->nBoards = acdc_board_numbers.size();
+    snapshot_->runNumber = strtoull(runNumber.c_str(), nullptr, 10);
+    for(int i = 0; i < DQMSnapshot::MAX_BOARDS; i++) snapshot_->boards[i].boardIndex = i < (int)acdc_board_numbers.size() ? acdc_board_numbers[i] : -1;
+
+    decodePipeline_.start(acdc_board_numbers, decodeOptions_);
+    __CFG_COUT__ << "Analysing every " << prescale_ << ". event on " << decodePipeline_.getNumWorkers() << " worker threads" << __E__;
+
+    runStart_ = lastUpdate_ = std::chrono::steady_clock::now();
+    stopPublisher_ = false;
+    publisher_ = std::thread(&ACCDQMConsumer::publisherThread, this);
+}
+
+//==============================================================================
+void ACCDQMConsumer::closeFile(void)
+{
+    if(!publisher_.joinable()) return;
+
+    {
+	std::lock_guard<std::mutex> lock(publisherMutex_);
+	stopPublisher_ = true;
+    }
+    publisherWakeup_.notify_all();
+    publisher_.join();
+
+    //the final snapshot includes everything that was still queued
+    decodePipeline_.stop();
+    publish();
+
+    __CFG_COUT__ << "Packets: " << snapshot_->nPackets << ", lost " << snapshot_->nPacketsLost << ", incomplete events dropped " << snapshot_->nEventsDropped << __E__;
+    for(unsigned int i = 0; i < acdc_board_numbers.size(); i++)
+    {
+	const DQMSnapshot::Board& board = snapshot_->boards[i];
+	__CFG_COUT__ << acdc_board_ids[i] << ": " << board.nEvents << " events, " << board.nAnalysed << " analysed, "
+	             << board.nDecodeErrors << " corrupt, " << board.nNotAnalysed << " skipped" << __E__;
+    }
+}
+
+//==============================================================================
+void ACCDQMConsumer::save(const std::string& data)
+{
+    increment(nPackets_);
+
+    AccPacketView packet(data);
+    EventAssembler::Status status = eventAssembler_.addPacket(packet);
+    if(eventAssembler_.packetGap()) increment(nPacketsLost_, eventAssembler_.lostPackets());
+    nEventsDropped_.store(eventAssembler_.getNDroppedEvents(), std::memory_order_relaxed);
+
+    if(status != EventAssembler::EVENT_COMPLETE) return;
+    int slot = eventAssembler_.completedSlot();
+    if(slot < 0 || slot >= (int)eventCounts_.size()) return;
+
+    accumulators_[slot]->addEvent(eventAssembler_.eventSize(slot));
+    if(eventCounts_[slot]++ % prescale_ == 0) decodePipeline_.push(slot, eventAssembler_.eventWords(slot));
+}
+
+//==============================================================================
+void ACCDQMConsumer::publisherThread()
+{
+    std::unique_lock<std::mutex> lock(publisherMutex_);
+    while(!stopPublisher_)
+    {
+	publisherWakeup_.wait_for(lock, updateInterval_, [this] {return stopPublisher_;});
+	if(stopPublisher_) break;
+	lock.unlock();
+	publish();
+	lock.lock();
+    }
+}
+
+//==============================================================================
+//Rates are the differences to the previous snapshot over the time since it
+//was taken. Only the publisher thread (and closeFile after joining it)
+//touches snapshot_.
+void ACCDQMConsumer::publish()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double interval = std::chrono::duration<double>(now - lastUpdate_).count();
+    lastUpdate_ = now;
+
+    DQMSnapshot& snapshot = *snapshot_;
+    snapshot.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    snapshot.runSeconds = std::chrono::duration<double>(now - runStart_).count();
+    snapshot.nPackets = nPackets_.load(std::memory_order_relaxed);
+    snapshot.nPacketsLost = nPacketsLost_.load(std::memory_order_relaxed);
+    snapshot.nEventsDropped = nEventsDropped_.load(std::memory_order_relaxed);
+
+    for(unsigned int i = 0; i < accumulators_.size(); i++)
+    {
+	DQMSnapshot::Board& board = snapshot.boards[i];
+	uint64_t nEvents = board.nEvents, nBytes = board.nBytes;
+	uint64_t nHits[NUM_CH];
+	for(int ch = 0; ch < NUM_CH; ch++) nHits[ch] = board.channels[ch].nHits;
+
+	accumulators_[i]->fill(board);
+	if(i < (unsigned int)decodePipeline_.getNumLanes())
+	{
+	    DecodePipeline::Stats stats = decodePipeline_.getStats(i);
+	    board.nDecodeErrors = stats.nErrors;
+	    board.nNotAnalysed = stats.nDropped;
+	}
+
+	if(interval <= 0) continue;
+	board.eventRate = (board.nEvents - nEvents)/interval;
+	board.dataRate = (board.nBytes - nBytes)/interval/1e6;
+	//hits are only counted in the analysed events, scaled up to all events
+	double analysedFraction = board.nEvents ? (double)board.nAnalysed/board.nEvents : 0;
+	for(int ch = 0; ch < NUM_CH; ch++)
+	{
+	    board.channels[ch].hitRate = analysedFraction > 0 ? (board.channels[ch].nHits - nHits[ch])/interval/analysedFraction : 0;
+	}
+    }
+
+    ++snapshot.updateCount;
+    sharedMemory_.publish(snapshot);
+}
+
+DEFINE_OTS_PROCESSOR(ACCDQMConsumer)
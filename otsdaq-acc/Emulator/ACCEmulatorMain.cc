@@ -0,0 +1,124 @@
+#include "AccEmulator.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+
+using namespace std;
+
+namespace
+{
+atomic<bool> stopRequested(false);
+
+void handleSignal(int)
+{
+    stopRequested = true;
+}
+
+void usage(const char* name)
+{
+    printf("Usage: %s [options]\n"
+           "Emulates an ACC with ACDCs on the network, for running the readout without hardware.\n"
+           "  --port N            register protocol port (default 2001)\n"
+           "  --data HOST:PORT    destination of the burst data (default 127.0.0.1:2002)\n"
+           "  --boards MASK       connected ACDCs (default 0x0f)\n"
+           "  --rate HZ           events per second and board while triggers are enabled (default 1000)\n"
+           "  --burst N           events sent back to back before pacing (default 1)\n"
+           "  --free-run          stream from the start without waiting for the trigger registers\n"
+           "  --loss P            probability of losing a burst packet\n"
+           "  --loss-every N      additionally lose every N-th packet\n"
+           "  --pulse P           pulse probability per channel and event (default 0.05)\n"
+           "  --seed N            random seed of the waveforms and losses\n"
+           "  --duration S        stop after S seconds, 0 to run until interrupted\n", name);
+}
+
+void printStats(const AccEmulator::Stats& stats, double seconds)
+{
+    printf("%.1f s: %lu commands (%lu reads, %lu writes), %lu events, %lu packets, %.1f MB/s, %lu send errors\n",
+           seconds, stats.nCommands, stats.nReads, stats.nWrites, stats.nEvents, stats.nPackets,
+           seconds > 0 ? stats.nBytes/seconds/1e6 : 0.0, stats.nSendErrors);
+}
+}
+
+int main(int argc, char** argv)
+{
+    AccEmulator::Options options;
+    double duration = 0;
+
+    static const option longOptions[] = {
+        {"port", required_argument, nullptr, 'p'},
+        {"data", required_argument, nullptr, 'd'},
+        {"boards", required_argument, nullptr, 'b'},
+        {"rate", required_argument, nullptr, 'r'},
+        {"burst", required_argument, nullptr, 'n'},
+        {"free-run", no_argument, nullptr, 'f'},
+        {"loss", required_argument, nullptr, 'l'},
+        {"loss-every", required_argument, nullptr, 'e'},
+        {"pulse", required_argument, nullptr, 'u'},
+        {"seed", required_argument, nullptr, 's'},
+        {"duration", required_argument, nullptr, 't'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    int c;
+    while((c = getopt_long(argc, argv, "p:d:b:r:n:fl:e:u:s:t:h", longOptions, nullptr)) != -1)
+    {
+        switch(c)
+        {
+        case 'p': options.controlPort = strtoul(optarg, nullptr, 0); break;
+        case 'd':
+        {
+            string destination = optarg;
+            size_t colon = destination.rfind(':');
+            options.dataHost = destination.substr(0, colon);
+            if(colon != string::npos) options.dataPort = strtoul(destination.c_str() + colon + 1, nullptr, 0);
+            break;
+        }
+        case 'b': options.boardMask = strtoul(optarg, nullptr, 0); break;
+        case 'r': options.eventRate = strtod(optarg, nullptr); break;
+        case 'n': options.burstEvents = strtoul(optarg, nullptr, 0); break;
+        case 'f': options.freeRun = true; break;
+        case 'l': options.generator.lossProbability = strtod(optarg, nullptr); break;
+        case 'e': options.generator.lossEvery = strtoul(optarg, nullptr, 0); break;
+        case 'u': options.generator.pulseProbability = strtod(optarg, nullptr); break;
+        case 's': options.generator.seed = strtoull(optarg, nullptr, 0); break;
+        case 't': duration = strtod(optarg, nullptr); break;
+        default:
+            usage(argv[0]);
+            return c == 'h' ? 0 : 1;
+        }
+    }
+
+    signal(SIGINT, handleSignal);
+    signal(SIGTERM, handleSignal);
+
+    AccEmulator emulator;
+    if(!emulator.start(options))
+    {
+        fprintf(stderr, "%s\n", emulator.getError().c_str());
+        return 1;
+    }
+    printf("Emulating ACDCs 0x%02x, registers on port %u, burst data to %s:%u\n",
+           options.boardMask, options.controlPort, options.dataHost.c_str(), options.dataPort);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    chrono::steady_clock::time_point lastPrint = start;
+    while(!stopRequested)
+    {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        double seconds = chrono::duration<double>(now - start).count();
+        if(duration > 0 && seconds >= duration) break;
+        if(now - lastPrint >= chrono::seconds(5))
+        {
+            printStats(emulator.getStats(), seconds);
+            lastPrint = now;
+        }
+    }
+
+    emulator.stop();
+    printStats(emulator.getStats(), chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    return 0;
+}
@@ -0,0 +1,295 @@
+#include "otsdaq-acc/ACC/AsyncFileWriter.h"
+#include "otsdaq-acc/ACC/DecodePipeline.h"
+#include "otsdaq-acc/ACC/EventAssembler.h"
+#include "otsdaq-acc/ACC/PacketGenerator.h"
+#include "otsdaq-acc/Reader/RunReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+
+using namespace std;
+
+//Replays recorded or synthetic burst data through the receiving path of
+//ACCBurstDataSaverConsumer as fast as possible: packets are prepared in
+//memory first, then fed one by one through AccPacketView and the
+//EventAssembler, and completed events go to the same stages the consumer
+//commits them to (file writer, decode pipeline). The plugin itself needs
+//the otsdaq runtime, so the stages are driven directly, in the order
+//save() and commitEvent() use them.
+
+namespace
+{
+void usage(const char* name)
+{
+    printf("Usage: %s [options] [files]\n"
+           "Replays _Raw.dat (or .accrun/.accz) files, or synthetic events if no files are given.\n"
+           "  --events N          events per file, or per board for synthetic data (default 10000)\n"
+           "  --boards MASK       boards of the synthetic data (default 0x0f)\n"
+           "  --pulse P           pulse probability per channel and event of the synthetic data\n"
+           "  --noise RMS         noise of the synthetic data, in ADC counts\n"
+           "  --repeat N          passes over the prepared packets (default 10)\n"
+           "  --loss P            probability of losing a packet\n"
+           "  --loss-every N      additionally lose every N-th packet\n"
+           "  --decode N          decode the events on N workers, as the consumer's DecodeWorkers\n"
+           "  --parse             parse every event on the replay thread instead\n"
+           "  --output PREFIX     write the events to PREFIX_<board>_Raw.dat\n", name);
+}
+
+class Replay
+{
+public:
+    vector<string> packets;
+    vector<int> boards;
+    uint64_t nEvents = 0;
+    uint64_t nBytes = 0;
+
+    void addBoard(int board)
+    {
+        if(board >= 0 && find(boards.begin(), boards.end(), board) == boards.end()) boards.push_back(board);
+    }
+
+    void add(vector<string>& eventPackets)
+    {
+        for(string& packet : eventPackets)
+        {
+            nBytes += packet.size();
+            packets.push_back(std::move(packet));
+        }
+        eventPackets.clear();
+        ++nEvents;
+    }
+};
+
+//events of all files interleaved, as the ACC sends them
+bool loadFiles(const vector<string>& fileNames, size_t maxEvents, PacketGenerator& generator, Replay& replay)
+{
+    vector<unique_ptr<RunReader>> readers;
+    for(const string& fileName : fileNames)
+    {
+        readers.emplace_back(new RunReader());
+        if(!readers.back()->open({fileName}, ACCESS_SEQUENTIAL))
+        {
+            fprintf(stderr, "%s: %s\n", fileName.c_str(), readers.back()->getError().c_str());
+            return false;
+        }
+        if(!readers.back()->getSkippedFiles().empty()) printf("%s: empty, skipped\n", fileName.c_str());
+        else printf("%s: %zu events\n", fileName.c_str(), readers.back()->getNumEvents());
+    }
+
+    vector<string> eventPackets;
+    for(size_t i = 0; i < maxEvents; ++i)
+    {
+        bool more = false;
+        for(unique_ptr<RunReader>& reader : readers)
+        {
+            if(i >= reader->getNumEvents()) continue;
+            more = true;
+            RunReader::Event event = reader->getEvent(i);
+            if(event.words.empty()) continue;
+            replay.addBoard(event.board());
+            generator.packetize(event.words, eventPackets);
+            replay.add(eventPackets);
+        }
+        if(!more) break;
+    }
+    return true;
+}
+
+//sums the loss counters of one pass, index slot + 1 as in the assembler
+void addLoss(const EventAssembler& assembler, vector<EventAssembler::LossStats>& loss)
+{
+    for(size_t i = 0; i < loss.size(); ++i)
+    {
+        const EventAssembler::LossStats& pass = assembler.getLossStats((int)i - 1);
+        loss[i].nPacketsLost += pass.nPacketsLost;
+        loss[i].nEventsLost += pass.nEventsLost;
+        loss[i].nBursts += pass.nBursts;
+        for(int bin = 0; bin < EventAssembler::LOSS_BURST_BINS; ++bin) loss[i].burstLength[bin] += pass.burstLength[bin];
+    }
+}
+
+void loadSynthetic(size_t nEvents, PacketGenerator& generator, Replay& replay)
+{
+    vector<string> eventPackets;
+    for(int board : generator.getOptions().boards) replay.addBoard(board);
+    for(size_t i = 0; i < nEvents; ++i)
+    {
+        for(int board : replay.boards)
+        {
+            generator.makeEventPackets(board, eventPackets);
+            replay.add(eventPackets);
+        }
+    }
+}
+}
+
+int main(int argc, char** argv)
+{
+    size_t maxEvents = 10000;
+    unsigned int boardMask = 0x0f;
+    int repeat = 10;
+    int decodeWorkers = 0;
+    bool parse = false;
+    string outputPrefix;
+    PacketGenerator::Options generatorOptions;
+
+    static const option longOptions[] = {
+        {"events", required_argument, nullptr, 'n'},
+        {"boards", required_argument, nullptr, 'b'},
+        {"pulse", required_argument, nullptr, 'u'},
+        {"noise", required_argument, nullptr, 'z'},
+        {"repeat", required_argument, nullptr, 'r'},
+        {"loss", required_argument, nullptr, 'l'},
+        {"loss-every", required_argument, nullptr, 'e'},
+        {"decode", required_argument, nullptr, 'd'},
+        {"parse", no_argument, nullptr, 'p'},
+        {"output", required_argument, nullptr, 'o'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    int c;
+    while((c = getopt_long(argc, argv, "n:b:u:z:r:l:e:d:po:h", longOptions, nullptr)) != -1)
+    {
+        switch(c)
+        {
+        case 'n': maxEvents = strtoull(optarg, nullptr, 0); break;
+        case 'b': boardMask = strtoul(optarg, nullptr, 0); break;
+        case 'u': generatorOptions.pulseProbability = strtod(optarg, nullptr); break;
+        case 'z': generatorOptions.noise = strtod(optarg, nullptr); break;
+        case 'r': repeat = max(atoi(optarg), 1); break;
+        case 'l': generatorOptions.lossProbability = strtod(optarg, nullptr); break;
+        case 'e': generatorOptions.lossEvery = strtoul(optarg, nullptr, 0); break;
+        case 'd': decodeWorkers = max(atoi(optarg), 1); break;
+        case 'p': parse = true; break;
+        case 'o': outputPrefix = optarg; break;
+        default:
+            usage(argv[0]);
+            return c == 'h' ? 0 : 1;
+        }
+    }
+
+    //----------prepare the packets, not timed
+    Replay replay;
+    PacketGenerator generator;
+    generatorOptions.boards.clear();
+    if(optind == argc)
+    {
+        for(int i = 0; i < 8; ++i)
+        {
+            if(boardMask & (1 << i)) generatorOptions.boards.push_back(i);
+        }
+    }
+    generator.setOptions(generatorOptions);
+    if(optind < argc)
+    {
+        if(!loadFiles(vector<string>(argv + optind, argv + argc), maxEvents, generator, replay)) return 1;
+    }
+    else loadSynthetic(maxEvents, generator, replay);
+    if(replay.packets.empty())
+    {
+        fprintf(stderr, "No events to replay\n");
+        return 1;
+    }
+    printf("Prepared %lu events of %zu boards in %zu packets (%.1f MB), %lu packets lost\n",
+           replay.nEvents, replay.boards.size(), replay.packets.size(), replay.nBytes/1e6, generator.getStats().nLost);
+
+    //----------the consumer's stages
+    EventAssembler assembler;
+    assembler.setBoards(replay.boards);
+
+    vector<unique_ptr<AsyncFileWriter>> files;
+    for(int board : outputPrefix.empty() ? vector<int>() : replay.boards)
+    {
+        files.emplace_back(new AsyncFileWriter());
+        string fileName = outputPrefix + "_" + to_string(board) + "_Raw.dat";
+        if(!files.back()->open(fileName))
+        {
+            fprintf(stderr, "Can't open file %s\n", fileName.c_str());
+            return 1;
+        }
+    }
+
+    DecodePipeline decodePipeline;
+    if(decodeWorkers > 0)
+    {
+        DecodePipeline::Options decodeOptions;
+        decodeOptions.nWorkers = decodeWorkers;
+        decodePipeline.start(replay.boards, decodeOptions);
+    }
+    ACDC acdc;
+    uint64_t nParseErrors = 0;
+
+    //----------replay
+    uint64_t nComplete = 0, nDropped = 0, nHeaderErrors = 0, nUnknownBoard = 0, nNoEvent = 0, nGaps = 0;
+    vector<EventAssembler::LossStats> loss(replay.boards.size() + 1);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int pass = 0; pass < repeat; ++pass)
+    {
+        addLoss(assembler, loss);
+        nDropped += assembler.getNDroppedEvents();
+        assembler.reset(); //the packet IDs restart with every pass
+        for(const string& data : replay.packets)
+        {
+            AccPacketView packet(data);
+            EventAssembler::Status status = assembler.addPacket(packet);
+            if(assembler.packetGap()) ++nGaps;
+
+            switch(status)
+            {
+            case EventAssembler::EVENT_COMPLETE:
+            {
+                ++nComplete;
+                int slot = assembler.completedSlot();
+                if(slot < (int)files.size()) files[slot]->write(assembler.eventData(slot), assembler.eventSize(slot));
+                if(decodeWorkers > 0) decodePipeline.push(slot, assembler.eventWords(slot));
+                if(parse && acdc.parseDataFromBuffer(assembler.eventWords(slot)) < 0) ++nParseErrors;
+                break;
+            }
+            case EventAssembler::HEADER_ERROR: ++nHeaderErrors; break;
+            case EventAssembler::UNKNOWN_BOARD: ++nUnknownBoard; break;
+            case EventAssembler::EVENT_QUARANTINED: break;
+            case EventAssembler::NO_EVENT: ++nNoEvent; break;
+            case EventAssembler::PACKET_ACCEPTED: break;
+            }
+        }
+    }
+    addLoss(assembler, loss);
+    nDropped += assembler.getNDroppedEvents();
+    //queued events and buffered data count as part of the work
+    if(decodeWorkers > 0) decodePipeline.stop();
+    for(unique_ptr<AsyncFileWriter>& file : files) file->close();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    uint64_t nPackets = replay.packets.size()*(uint64_t)repeat;
+    uint64_t nEvents = replay.nEvents*(uint64_t)repeat;
+    uint64_t nBytes = replay.nBytes*(uint64_t)repeat;
+    printf("Replayed %lu events in %lu packets in %.3f s: %.0f events/s, %.1f MB/s, %.0f packets/s\n",
+           nEvents, nPackets, seconds, nEvents/seconds, nBytes/seconds/1e6, nPackets/seconds);
+    printf("%lu events complete, %lu dropped incomplete, %lu packet gaps, %lu header errors, %lu unknown board, %lu packets outside events\n",
+           nComplete, nDropped, nGaps, nHeaderErrors, nUnknownBoard, nNoEvent);
+    for(size_t i = 0; i < loss.size(); ++i)
+    {
+        if(loss[i].nPacketsLost == 0) continue;
+        printf("%s: %lu packets lost in %lu events, bursts by length (1, 2, 3-4, ..., 129-255):", i == 0 ? "header lost" : ("board " + to_string(replay.boards[i - 1])).c_str(),
+               loss[i].nPacketsLost, loss[i].nEventsLost);
+        for(int bin = 0; bin < EventAssembler::LOSS_BURST_BINS; ++bin) printf(" %lu", loss[i].burstLength[bin]);
+        printf("\n");
+    }
+    if(parse) printf("%lu events failed to parse\n", nParseErrors);
+    for(int i = 0; i < decodePipeline.getNumLanes(); ++i)
+    {
+        DecodePipeline::Stats stats = decodePipeline.getStats(i);
+        printf("board %d: decoded %lu of %lu events, %lu corrupt, %lu of unexpected length, %lu not decoded (queue full)\n",
+               replay.boards[i], stats.nDecoded, stats.nQueued, stats.nErrors, stats.nBadLength, stats.nDropped);
+    }
+    for(unique_ptr<AsyncFileWriter>& file : files)
+    {
+        AsyncFileWriter::Stats stats = file->getStats();
+        printf("%s: wrote %lu bytes, %lu stalls\n", file->getFileName().c_str(), stats.bytesWritten, stats.nStalls);
+    }
+    return 0;
+}
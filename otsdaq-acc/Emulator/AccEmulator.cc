@@ -0,0 +1,384 @@
+#include "AccEmulator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace
+{
+constexpr uint64_t FIRMWARE_VERSION = 0x0107;
+constexpr uint64_t FIRMWARE_YEAR = 0x2026;      //BCD, as printed by FEACCInterface::versionCheck
+constexpr uint64_t FIRMWARE_MONTH_DAY = 0x0101;
+constexpr int GOOD_PHASES = 10;                 //width of the error free phase window of each link
+}
+
+AccEmulator::Options::Options() :
+    controlPort(2001),
+    dataHost("127.0.0.1"),
+    dataPort(2002),
+    boardMask(0x0f),
+    eventRate(1000),
+    freeRun(false),
+    burstEvents(1)
+{
+}
+
+AccEmulator::AccEmulator() :
+    controlSocket_(-1),
+    dataSocket_(-1),
+    stop_(false),
+    selectedLink_(0),
+    autoTransmit_(false),
+    pendingTriggers_(0),
+    sequence_(0),
+    nCommands_(0), nReads_(0), nWrites_(0), nEvents_(0), nPackets_(0), nBytes_(0), nSendErrors_(0)
+{
+    for(int i = 0; i < MAX_BOARDS; ++i)
+    {
+        phase_[i] = 0;
+        triggerMode_[i] = 0;
+    }
+    memset(&dataAddress_, 0, sizeof(dataAddress_));
+}
+
+AccEmulator::~AccEmulator()
+{
+    stop();
+}
+
+bool AccEmulator::start(const Options& options)
+{
+    stop();
+    options_ = options;
+    options_.boardMask &= 0xff;
+    options_.burstEvents = max(options_.burstEvents, 1u);
+
+    //register protocol socket, the timeout lets the control thread notice stop()
+    controlSocket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(options_.controlPort);
+    timeval timeout = {0, 100000};
+    if(controlSocket_ < 0 || bind(controlSocket_, (sockaddr*)&address, sizeof(address)) != 0 ||
+       setsockopt(controlSocket_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) != 0)
+    {
+        error_ = "Can't bind the control port " + to_string(options_.controlPort) + ": " + strerror(errno);
+        stop();
+        return false;
+    }
+
+    //burst data socket
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* result = nullptr;
+    if(getaddrinfo(options_.dataHost.c_str(), nullptr, &hints, &result) != 0 || !result)
+    {
+        error_ = "Can't resolve the data destination " + options_.dataHost;
+        stop();
+        return false;
+    }
+    dataAddress_ = *(sockaddr_in*)result->ai_addr;
+    dataAddress_.sin_port = htons(options_.dataPort);
+    freeaddrinfo(result);
+    dataSocket_ = socket(AF_INET, SOCK_DGRAM, 0);
+    int bufferSize = 8 << 20;
+    if(dataSocket_ < 0 || setsockopt(dataSocket_, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize)) != 0)
+    {
+        error_ = string("Can't open the data socket: ") + strerror(errno);
+        stop();
+        return false;
+    }
+
+    PacketGenerator::Options generatorOptions = options_.generator;
+    generatorOptions.boards.clear();
+    for(int i = 0; i < MAX_BOARDS; ++i)
+    {
+        if(options_.boardMask & (1 << i)) generatorOptions.boards.push_back(i);
+    }
+    generator_.setOptions(generatorOptions);
+
+    for(int i = 0; i < MAX_BOARDS; ++i)
+    {
+        slowControl_[i].clear();
+        phase_[i] = 0;
+        triggerMode_[i] = 0;
+    }
+    autoTransmit_ = false;
+    pendingTriggers_ = 0;
+    errorReset_ = chrono::steady_clock::now();
+
+    stop_ = false;
+    threads_.emplace_back(&AccEmulator::controlThread, this);
+    threads_.emplace_back(&AccEmulator::dataThread, this);
+    return true;
+}
+
+void AccEmulator::stop()
+{
+    stop_ = true;
+    for(thread& t : threads_)
+    {
+        if(t.joinable()) t.join();
+    }
+    threads_.clear();
+    if(controlSocket_ >= 0) close(controlSocket_);
+    if(dataSocket_ >= 0) close(dataSocket_);
+    controlSocket_ = dataSocket_ = -1;
+}
+
+AccEmulator::Stats AccEmulator::getStats() const
+{
+    Stats stats;
+    stats.nCommands = nCommands_;
+    stats.nReads = nReads_;
+    stats.nWrites = nWrites_;
+    stats.nEvents = nEvents_;
+    stats.nPackets = nPackets_;
+    stats.nBytes = nBytes_;
+    stats.nSendErrors = nSendErrors_;
+    return stats;
+}
+
+void AccEmulator::controlThread()
+{
+    vector<char> buffer(65536);
+    while(!stop_)
+    {
+        sockaddr_in from;
+        socklen_t fromSize = sizeof(from);
+        ssize_t size = recvfrom(controlSocket_, buffer.data(), buffer.size(), 0, (sockaddr*)&from, &fromSize);
+        if(size > 0) handleDatagram(buffer.data(), size, from);
+    }
+}
+
+//commands are executed in order, each one is answered with its own datagram
+void AccEmulator::handleDatagram(const char* data, size_t size, const sockaddr_in& from)
+{
+    const size_t commandBytes = 2 + sizeof(uint64_t);
+    string reply;
+    size_t pos = 0;
+    while(pos + commandBytes <= size)
+    {
+        uint8_t type = data[pos];
+        size_t nWords = (uint8_t)data[pos + 1];
+        uint64_t address;
+        memcpy(&address, data + pos + 2, sizeof(address));
+        pos += commandBytes;
+        bool fifo = type & 0x08;
+        ++nCommands_;
+
+        if(type & 0x01)
+        {
+            nWords = min(nWords, (size - pos)/sizeof(uint64_t));
+            reply.assign(2, '\0');
+            {
+                lock_guard<mutex> lock(mutex_);
+                for(size_t i = 0; i < nWords; ++i)
+                {
+                    uint64_t word;
+                    memcpy(&word, data + pos + i*sizeof(uint64_t), sizeof(word));
+                    write(fifo ? address : address + i, word);
+                }
+                reply[0] = type;
+                reply[1] = sequence_++;
+            }
+            pos += nWords*sizeof(uint64_t);
+            ++nWrites_;
+            sendto(controlSocket_, reply.data(), reply.size(), 0, (const sockaddr*)&from, sizeof(from));
+        }
+        else
+        {
+            reply.assign(2 + nWords*sizeof(uint64_t), '\0');
+            {
+                lock_guard<mutex> lock(mutex_);
+                reply[0] = type;
+                reply[1] = sequence_++;
+                for(size_t i = 0; i < nWords; ++i)
+                {
+                    uint64_t word = read(fifo ? address : address + i, fifo);
+                    memcpy(&reply[2 + i*sizeof(uint64_t)], &word, sizeof(word));
+                }
+            }
+            ++nReads_;
+            sendto(controlSocket_, reply.data(), reply.size(), 0, (const sockaddr*)&from, sizeof(from));
+        }
+    }
+}
+
+void AccEmulator::write(uint64_t address, uint64_t data)
+{
+    if(address == 0x0002 || address == 0x0020)
+    {
+        for(int i = 0; i < MAX_BOARDS; ++i)
+        {
+            if(data & (1 << i)) slowControl_[i].clear();
+        }
+    }
+    else if(address == 0x0010) pendingTriggers_.fetch_add(1);
+    else if(address == 0x0023) autoTransmit_ = data & 1;
+    else if(address >= 0x0030 && address < 0x0030 + MAX_BOARDS) triggerMode_[address - 0x0030] = (int)data;
+    else if(address == 0x0053) errorReset_ = chrono::steady_clock::now();
+    else if(address == 0x0055) selectedLink_ = data % MAX_BOARDS;
+    else if(address == 0x0056) phase_[selectedLink_] = (phase_[selectedLink_] + 1) % NUM_PHASES;
+    else if(address == 0x0100) acdcCommand(data);
+}
+
+void AccEmulator::acdcCommand(uint32_t command)
+{
+    unsigned int mask = (command >> 24) & options_.boardMask;
+    unsigned int op = (command >> 16) & 0xff;
+    unsigned int argument = command & 0xffff;
+    for(int board = 0; board < MAX_BOARDS; ++board)
+    {
+        if(!(mask & (1 << board))) continue;
+        if(op == 0xd0 && argument <= 5) pushInfoFrame(board, (int)argument - 1);
+        else if(op == 0xff) slowControl_[board].clear();
+    }
+}
+
+void AccEmulator::pushInfoFrame(int board, int chip)
+{
+    uint64_t frame[INFO_FRAME_WORDS] = {};
+    frame[0] = 0x1234;
+    frame[1] = 0xbbbb;
+    if(chip < 0)
+    {
+        frame[2] = FIRMWARE_VERSION;
+        frame[3] = FIRMWARE_YEAR;
+        frame[4] = FIRMWARE_MONTH_DAY;
+        frame[6] = 0x1ff; //PLLs and FLLs locked
+    }
+    else
+    {
+        frame[3] = 0x3e80; //ring oscillator feedback count and target
+        frame[4] = 0x3e80;
+        frame[5] = 0x800;  //vbias
+        frame[6] = 0x780;  //self trigger threshold
+        frame[7] = 0x800;  //pro Vdd
+        frame[15] = 0xcff; //DLL Vdd
+        frame[16] = chip;
+    }
+    frame[30] = 0xbbbb;
+    frame[31] = 0x4321;
+    slowControl_[board].insert(slowControl_[board].end(), frame, frame + INFO_FRAME_WORDS);
+}
+
+uint64_t AccEmulator::read(uint64_t address, bool fifo)
+{
+    if(address == 0x1000) return FIRMWARE_VERSION;
+    if(address == 0x1001) return FIRMWARE_YEAR << 16 | FIRMWARE_MONTH_DAY;
+    if(address == 0x1011) return ~(options_.boardMask | options_.boardMask << 8) & 0xffff; //aligned and synced links read as cleared bits
+    if(address >= 0x1110 && address < 0x1110 + MAX_BOARDS) return linkErrors(address - 0x1110);
+    if(address >= 0x1120 && address < 0x1120 + MAX_BOARDS) return linkErrors(address - 0x1120);
+    if(address >= 0x1138 && address < 0x1138 + MAX_BOARDS) return slowControl_[address - 0x1138].size();
+    if(address >= 0x1200 && address < 0x1200 + MAX_BOARDS && fifo)
+    {
+        deque<uint64_t>& queue = slowControl_[address - 0x1200];
+        if(queue.empty()) return 0;
+        uint64_t word = queue.front();
+        queue.pop_front();
+        return word;
+    }
+    return 0;
+}
+
+//errors accumulate from the last counter reset while the link's phase is outside its window
+uint64_t AccEmulator::linkErrors(int link)
+{
+    int start = (3*link + 4) % NUM_PHASES;
+    bool connected = options_.boardMask & (1 << link);
+    if(connected && (phase_[link] - start + NUM_PHASES) % NUM_PHASES < GOOD_PHASES) return 0;
+    return 1 + chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - errorReset_).count()/10;
+}
+
+void AccEmulator::sendEvent(int board, vector<string>& packets)
+{
+    generator_.makeEventPackets(board, packets);
+#ifdef __linux__
+    //one system call for the whole event
+    mmsghdr messages[PacketGenerator::PACKETS_PER_EVENT];
+    iovec vectors[PacketGenerator::PACKETS_PER_EVENT];
+    unsigned int n = min(packets.size(), (size_t)PacketGenerator::PACKETS_PER_EVENT);
+    for(unsigned int i = 0; i < n; ++i)
+    {
+        vectors[i].iov_base = packets[i].data();
+        vectors[i].iov_len = packets[i].size();
+        memset(&messages[i], 0, sizeof(mmsghdr));
+        messages[i].msg_hdr.msg_name = &dataAddress_;
+        messages[i].msg_hdr.msg_namelen = sizeof(dataAddress_);
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    int sent = n ? sendmmsg(dataSocket_, messages, n, 0) : 0;
+    if(sent < 0) sent = 0;
+    for(int i = 0; i < sent; ++i) nBytes_ += packets[i].size();
+    nPackets_ += sent;
+    nSendErrors_ += n - sent;
+#else
+    for(const string& packet : packets)
+    {
+        if(sendto(dataSocket_, packet.data(), packet.size(), 0, (const sockaddr*)&dataAddress_, sizeof(dataAddress_)) < 0)
+        {
+            ++nSendErrors_;
+            continue;
+        }
+        ++nPackets_;
+        nBytes_ += packet.size();
+    }
+#endif
+    ++nEvents_;
+}
+
+//sends software triggered events right away and, while triggers are enabled, paced events at the configured rate
+void AccEmulator::dataThread()
+{
+    vector<string> packets;
+    chrono::steady_clock::time_point next = chrono::steady_clock::now();
+    chrono::duration<double> period(options_.eventRate > 0 ? options_.burstEvents/options_.eventRate : 0);
+
+    while(!stop_)
+    {
+        bool streaming = options_.freeRun || autoTransmit_;
+        unsigned int triggers = pendingTriggers_.exchange(0);
+        unsigned int pacedMask = 0;
+        for(int board = 0; board < MAX_BOARDS; ++board)
+        {
+            if(!(options_.boardMask & (1 << board))) continue;
+            for(unsigned int i = 0; streaming && i < triggers; ++i) sendEvent(board, packets);
+            if(options_.freeRun || triggerMode_[board] != 0) pacedMask |= 1 << board;
+        }
+
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if(!streaming || !pacedMask || options_.eventRate <= 0)
+        {
+            this_thread::sleep_for(chrono::microseconds(100));
+            next = now;
+            continue;
+        }
+        if(now < next)
+        {
+            this_thread::sleep_until(min(next, now + chrono::milliseconds(1)));
+            continue;
+        }
+
+        for(unsigned int i = 0; i < options_.burstEvents; ++i)
+        {
+            for(int board = 0; board < MAX_BOARDS; ++board)
+            {
+                if(pacedMask & (1 << board)) sendEvent(board, packets);
+            }
+        }
+        next += chrono::duration_cast<chrono::steady_clock::duration>(period);
+        if(next < now - chrono::seconds(1)) next = now; //slower than the requested rate, don't try to catch up
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef _ACCEMULATOR_H_INCLUDED
+#define _ACCEMULATOR_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <netinet/in.h>
+#include "otsdaq-acc/ACC/PacketGenerator.h"
+
+using namespace std;
+
+//Software ACC with up to 8 ACDCs behind it, for running FEACCInterface and
+//the burst data consumers on a machine without hardware.
+//
+//Register protocol (ots UDP firmware core): a datagram holds one or more
+//commands of [type][number of words][address (8 bytes)][data words, writes
+//only]. Type bit 0 is set for writes, 0x08 (NO_ADDR_INC) keeps the address
+//fixed. Reads are answered with [type][sequence number][data words],
+//writes with the acknowledgement [type][sequence number] once they are
+//executed, which OtsUDPHardware::writeAndAcknowledge waits for.
+//
+//Emulated registers, as FEACCInterface uses them:
+//  write 0x0002          clear the slow control FIFOs of the boards in the mask
+//  write 0x0010          software trigger
+//  write 0x0023          auto-transmit, burst data only flows while it is 1
+//  write 0x0030+i        ACC trigger mode of board i
+//  write 0x0053          reset the link error counters
+//  write 0x0054-0x0056   link phase stepping (select channel 0x55, step 0x56)
+//  write 0x0100          ACDC commands: board mask in bits 31-24, 0xD0 info
+//                        frames (0x00D00000, PSEC chips 0x00D00001+j), 0xFF reset
+//  read  0x1000          ACC info (firmware version and date)
+//  read  0x1011          link alignment, a cleared bit i means board i is connected
+//  read  0x1110, 0x1120  PRBS and decode error counters of the 8 links
+//  read  0x1138+i        words waiting in the slow control FIFO of board i
+//  read  0x1200+i        slow control FIFO of board i, info frames start with 0x1234
+//Other writes are accepted and ignored, other reads return zeros. Each
+//link decodes cleanly in a window of 10 of its 24 phases, so the phase
+//scans find a setting.
+class AccEmulator
+{
+public:
+    static constexpr int MAX_BOARDS = 8;
+    static constexpr int NUM_PHASES = 24;
+    static constexpr int INFO_FRAME_WORDS = 32;
+
+    class Options
+    {
+    public:
+        Options();
+
+        uint16_t controlPort;      //register protocol
+        string dataHost;           //destination of the burst data
+        uint16_t dataPort;
+        unsigned int boardMask;    //connected ACDCs
+        double eventRate;          //events per second and board while triggers are enabled, 0: software triggers only
+        bool freeRun;              //stream at eventRate from the start, regardless of the registers
+        unsigned int burstEvents;  //events sent back to back before pacing again
+        PacketGenerator::Options generator; //boards are taken from boardMask
+    };
+
+    class Stats
+    {
+    public:
+        Stats() : nCommands(0), nReads(0), nWrites(0), nEvents(0), nPackets(0), nBytes(0), nSendErrors(0) {}
+
+        uint64_t nCommands; //register commands received
+        uint64_t nReads;
+        uint64_t nWrites;
+        uint64_t nEvents;   //burst events sent
+        uint64_t nPackets;  //burst packets sent
+        uint64_t nBytes;
+        uint64_t nSendErrors;
+    };
+
+    AccEmulator();
+    ~AccEmulator(); //stops the threads
+
+    //----------control
+    bool start(const Options& options); //false if a socket can't be set up, see getError()
+    void stop();
+    bool isRunning() const {return !threads_.empty();}
+
+    //----------local return functions
+    Stats getStats() const;
+    const string& getError() const {return error_;}
+
+private:
+    void controlThread();
+    void dataThread();
+    void handleDatagram(const char* data, size_t size, const sockaddr_in& from);
+    void write(uint64_t address, uint64_t data);
+    uint64_t read(uint64_t address, bool fifo);
+    void acdcCommand(uint32_t command);
+    void pushInfoFrame(int board, int chip); //chip < 0 for the board info frame
+    uint64_t linkErrors(int link);
+    void sendEvent(int board, vector<string>& packets);
+
+    Options options_;
+    string error_;
+    int controlSocket_;
+    int dataSocket_;
+    sockaddr_in dataAddress_;
+    vector<thread> threads_;
+    atomic<bool> stop_;
+
+    //register state, guarded by mutex_ (the data thread only reads the atomics)
+    mutable mutex mutex_;
+    deque<uint64_t> slowControl_[MAX_BOARDS];
+    int phase_[MAX_BOARDS];
+    int selectedLink_;
+    chrono::steady_clock::time_point errorReset_;
+    atomic<bool> autoTransmit_;
+    atomic<int> triggerMode_[MAX_BOARDS];
+    atomic<unsigned int> pendingTriggers_;
+    uint8_t sequence_;
+
+    PacketGenerator generator_; //only used by the data thread
+    atomic<uint64_t> nCommands_, nReads_, nWrites_, nEvents_, nPackets_, nBytes_, nSendErrors_;
+};
+
+#endif
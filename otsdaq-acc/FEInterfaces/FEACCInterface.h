@@ -8,12 +8,13 @@
 #define ACDCFRAME 32
 #define PPSFRAME 16
 #define PSECFRAME 7696
+#define MAX_WRITE_WORDS 182 //maximum number of data words in one write command, limited by the UDP datagram size
 #include <bitset>
 #include <thread>
 #include <vector>
 #include <map>
 #include "otsdaq-acc/ACC/ACDC.h"
-#include "otsdaq-acc/ACC/BlockingQueue.h"
+#include "otsdaq-acc/ACC/RingBuffer.h"
 #include "otsdaq-components/FEInterfaces/FEOtsUDPTemplateInterface.h"
 
 namespace ots
@@ -28,6 +29,21 @@ class FEACCInterface : public FEOtsUDPTemplateInterface
 	                   const ConfigurationTree& theXDAQContextConfigree,
 	                   const std::string&       interfaceConfigurationPath);
 	virtual ~FEACCInterface(void);
+
+	/*Register writes collected for one transaction, see commitWrites()*/
+	class RegisterWrites
+	{
+	public:
+	    void add(uint64_t address, uint64_t data) {writes_.emplace_back(address, data);}
+	    void clear() {writes_.clear();}
+	    size_t size() const {return writes_.size();}
+	    bool empty() const {return writes_.empty();}
+	    const std::vector<std::pair<uint64_t, uint64_t>>& writes() const {return writes_;} //address, data in write order
+
+	private:
+	    std::vector<std::pair<uint64_t, uint64_t>> writes_;
+	};
+
 	//-------------------------------------------------------------------------
 	//Interface implementation-------------------------------------------------
 	void configure(void) override;
@@ -66,9 +82,9 @@ class FEACCInterface : public FEOtsUDPTemplateInterface
 	/*ID 15: Main listen fuction for data readout*/
 	int listenForAcdcData(); 
 	/*ID 16: Used to dis/enable transfer data from the PSEC chips to the buffers*/
-	void enableTransfer(int onoff = 0, int acdcMask = 0xff);
+	void enableTransfer(int onoff = 0, int acdcMask = 0xff, RegisterWrites* writes = nullptr);
 	/*ID 18: Tells ACDCs to clear their ram.*/ 	
-	void dumpData(unsigned int boardMask); 
+	void dumpData(unsigned int boardMask, RegisterWrites* writes = nullptr); 
 	/*ID 19: Pedestal setting procedure.*/
 	bool setPedestals(unsigned int boardmask, unsigned int chipmask, unsigned int adc); 
 	bool setPedestals(unsigned int boardmask, const std::vector<unsigned int>& pedestals);
@@ -82,6 +98,10 @@ class FEACCInterface : public FEOtsUDPTemplateInterface
 	void versionCheck(bool debug = false);
 	/*ID 25: Scan possible high speed link clock phases and select the optimal phase setting*/ 
 	void scanLinkPhase(unsigned int boardMask, bool print = false);
+	/*ID 30: Coarse-then-fine link phase scan with deadline polling, skipped if cached phases are still healthy*/
+	void scanLinkPhaseFast(unsigned int boardMask, bool print = false);
+	/*ID 31: Checks the high speed links with the PRBS pattern, true if no masked link shows decode errors*/
+	bool checkLinkHealth(unsigned int boardMask);
         /*ID 26: Configure the jcPLL settings */
 	void configJCPLL(unsigned int boardMask = 0xff);
         /*ID 27: Turn off triggers and data transfer off */
@@ -89,6 +109,8 @@ class FEACCInterface : public FEOtsUDPTemplateInterface
 	void resetLinks();
 	void resetACDC(unsigned int boardMask = 0xff); //resets the acdc boards
 	void resetACC(); //resets the acdc boards 
+	/*ID 29: Sends collected register writes in as few datagrams as possible and clears them*/
+	void commitWrites(RegisterWrites& writes, bool acknowledge = true);
 
     class ConfigParams
     {
@@ -108,6 +130,10 @@ class FEACCInterface : public FEOtsUDPTemplateInterface
         int coincidentTrigMask;
         int coincidentTrigDelay[8];
         int coincidentTrigStretch[8];
+
+        bool fastLinkScan;     //use scanLinkPhaseFast in configure
+        int linkScanAlignTime; //us of idle pattern per scan step for the links to realign
+        int linkScanWindow;    //us the error counters are polled per scan step
     } params_;
 
   private:
@@ -128,6 +154,10 @@ class FEACCInterface : public FEOtsUDPTemplateInterface
 	void sendJCPLLSPIWord(unsigned int word, unsigned int boardMask = 0xff, bool verbose = false);
 	std::string runNumber_;
 	std::vector<uint64_t> readSlowControl(const int iacdc, const int timeout = 10);
+	std::vector<uint64_t> measureLinkErrors(unsigned int chanMask, int alignTime, int window);
+	void advanceLinkPhase(RegisterWrites& writes, int chan, int steps);
+
+	int linkPhases_[8]; //phase steps set by the last link scan per link, -1 if not scanned since the last ACC reset
 };
 }  // namespace ots
 
@@ -1,5 +1,6 @@
 #include <stdint.h>
 #include <algorithm>
+#include <chrono>
 #include <iostream>  // std::cout, std::dec, std::hex, std::oct
 #include <set>
 #include "otsdaq-acc/FEInterfaces/FEACCInterface.h"
@@ -25,6 +26,7 @@ FEACCInterface::FEACCInterface(const std::string&       interfaceUID,
     , FEOtsUDPTemplateInterface(
           interfaceUID, theXDAQContextConfigTree, interfaceConfigurationPath)
 {
+	for(int i = 0; i < 8; ++i) linkPhases_[i] = -1;
 }
 
 
@@ -38,7 +40,10 @@ FEACCInterface::ConfigParams::ConfigParams() :
     accTrigPolarity(0),
     validationStart(0),
     validationWindow(0),
-    coincidentTrigMask(0x0f)
+    coincidentTrigMask(0x0f),
+    fastLinkScan(false),
+    linkScanAlignTime(200),
+    linkScanWindow(500)
 {
     for(int i = 0; i < 8; ++i)
     {
@@ -55,6 +60,7 @@ FEACCInterface::~FEACCInterface(void) {}
 void FEACCInterface::configure(void)
 {
 	__CFG_COUT__ << "configure" << std::endl;
+	auto t0 = std::chrono::steady_clock::now();
 
 	ConfigurationTree optionalLink =
 	    theXDAQContextConfigTree_.getNode(theConfigurationPath_)
@@ -93,6 +99,17 @@ void FEACCInterface::configure(void)
 	  }
 	}
 
+	try
+	{
+	  params_.fastLinkScan = optionalLink.getNode("FastLinkPhaseScan").getValue<bool>();
+	  params_.linkScanAlignTime = optionalLink.getNode("LinkPhaseScanAlignTime").getValue<int>();
+	  params_.linkScanWindow = optionalLink.getNode("LinkPhaseScanWindow").getValue<int>();
+	}
+	catch(...)
+	{
+	  //keep defaults
+	}
+
 	////////////////////////////////////////////////////////////////////////////////
 	// if clock reset is enabled reset clock
 	// TODO?: MUST BE FIXED ADDING SOFT RESET. Fix config table as necessary.
@@ -188,47 +205,45 @@ void FEACCInterface::configure(void)
                 setPedestals(1 << acdc.getBoardIndex(), acdc.params_.pedestals);
             }
 
+            RegisterWrites boardWrites;
             //set dll_vdd
             for(int iPSEC = 0; iPSEC < 5; ++iPSEC)
             {
-		OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x100, /*data*/ 0x00A00000 | (1 << (acdc.getBoardIndex() + 24))| (iPSEC << 12) | acdc.params_.dll_vdd);
-		OtsUDPHardware::write(writeBuffer);
+		boardWrites.add(/*address*/ 0x100, /*data*/ 0x00A00000 | (1 << (acdc.getBoardIndex() + 24))| (iPSEC << 12) | acdc.params_.dll_vdd);
             }
 
 	    //Set ACDC backpressure on
-	    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x100, /*data*/ 0x00B70000 | (1 << (acdc.getBoardIndex() + 24))| (acdc.params_.acc_backpressure?1:0));
-
-	    OtsUDPHardware::write(writeBuffer);
+	    boardWrites.add(/*address*/ 0x100, /*data*/ 0x00B70000 | (1 << (acdc.getBoardIndex() + 24))| (acdc.params_.acc_backpressure?1:0));
+	    commitWrites(boardWrites);
 
 	    __CFG_COUT__ << "Done configuring ACDC board " << acdc.getBoardIndex() << "." << std::endl;
         }
 
         //usleep(100000);
 
+	RegisterWrites writes;
 	//disable all triggers
 	//ACC trigger
         for(unsigned int i = 0; i < 8; ++i)
 	{
-	  OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x0030+i, /*data*/0);
-	  OtsUDPHardware::write(writeBuffer);
+	  writes.add(/*address*/ 0x0030+i, /*data*/0);
 	}
 	//ACDC trigger
 	u_int64_t command = 0xffB00000;
-	OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x100, /*data*/command);
-	OtsUDPHardware::write(writeBuffer);
+	writes.add(/*address*/ 0x100, /*data*/command);
         //disable data transmission
-        enableTransfer(0); 
-	OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x0023, /*data*/0);
-	OtsUDPHardware::write(writeBuffer);
+        enableTransfer(0, 0xff, &writes); 
+	writes.add(/*address*/ 0x0023, /*data*/0);
 	//flush data FIFOs
-	dumpData(params_.boardMask);
+	dumpData(params_.boardMask, &writes);
 	//train manchester links
-	OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x0060, /*data*/0);
-	OtsUDPHardware::write(writeBuffer);
+	writes.add(/*address*/ 0x0060, /*data*/0);
+	commitWrites(writes);
 	usleep(250);
 
         //scan hs link phases and pick optimal phase
-        scanLinkPhase(params_.boardMask, true);
+        if(params_.fastLinkScan) scanLinkPhaseFast(params_.boardMask, true);
+        else                     scanLinkPhase(params_.boardMask, true);
 
         // Toggles the calibration mode on if requested
 	for(ACDC& acdc : acdcs) 
@@ -253,35 +268,23 @@ void FEACCInterface::configure(void)
 	    //setHardwareTrigSrc(params_.triggerMode,params_.boardMask);
 	    goto selfsetup;
 	case 5: //Self trigger with SMA validation on ACC
-	    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x0038, /*data*/params_.accTrigPolarity);
-	    OtsUDPHardware::write(writeBuffer);
-
-	    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x0039, /*data*/params_.validationStart);
-	    OtsUDPHardware::write(writeBuffer);
-			
-	    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x003a, /*data*/params_.validationWindow);
-	    OtsUDPHardware::write(writeBuffer);
+	    writes.add(/*address*/ 0x0038, /*data*/params_.accTrigPolarity);
+	    writes.add(/*address*/ 0x0039, /*data*/params_.validationStart);
+	    writes.add(/*address*/ 0x003a, /*data*/params_.validationWindow);
 	    __attribute__ ((fallthrough));
 	case 4: // ACC coincident TODO 
-	    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x003f, /*data*/params_.coincidentTrigMask);
-	    OtsUDPHardware::write(writeBuffer);
-
-	    for(int i = 0; i < 8; ++i)
-	    {
-		OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x0040+i, /*data*/params_.coincidentTrigDelay[i]);
-		OtsUDPHardware::write(writeBuffer);
-
-		OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x0048+i, /*data*/params_.coincidentTrigStretch[i]);
-		OtsUDPHardware::write(writeBuffer);                            
-	    }
+	    //mask, delays and stretches are consecutive registers 0x3f-0x4f and go out as one command
+	    writes.add(/*address*/ 0x003f, /*data*/params_.coincidentTrigMask);
+	    for(int i = 0; i < 8; ++i) writes.add(/*address*/ 0x0040+i, /*data*/params_.coincidentTrigDelay[i]);
+	    for(int i = 0; i < 8; ++i) writes.add(/*address*/ 0x0048+i, /*data*/params_.coincidentTrigStretch[i]);
 	    __attribute__ ((fallthrough));
 	case 3: //Self trigger with validation 
+	    commitWrites(writes); //trigger settings have to be in place before the trigger source is set
 	    setHardwareTrigSrc(params_.triggerMode,params_.boardMask);
 	    //timeout after 1 us 
 	    command = 0x00B20000;
 	    command = (command | (params_.boardMask << 24)) | 40;
-	    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x100, /*data*/command);
-	    OtsUDPHardware::write(writeBuffer);			
+	    writes.add(/*address*/ 0x100, /*data*/command);
 	    goto selfsetup;
 	default: // ERROR case
 	{
@@ -303,14 +306,12 @@ void FEACCInterface::configure(void)
 	        {		
 		    command = 0x00B10000;
 		    command = (command | (acdcMask << 24)) | CHIPMASK[i] | ((acdc.params_.selfTrigMask>>i*6) & 0x3f);
-		    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x100, /*data*/command);
-		    OtsUDPHardware::write(writeBuffer);
+		    writes.add(/*address*/ 0x100, /*data*/command);
 	        }
 	    		
 	        command = 0x00B16000;
 	        command = (command | (acdcMask << 24)) | acdc.params_.selfTrigPolarity;
-	        OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x100, /*data*/command);
-	        OtsUDPHardware::write(writeBuffer);			
+	        writes.add(/*address*/ 0x100, /*data*/command);
 	    
 	        if(acdc.params_.triggerThresholds.size() == 30)
 	        {
@@ -320,8 +321,7 @@ void FEACCInterface::configure(void)
 			{
 			    command = 0x00A60000;
 			    command = ((command + (iChan << 16)) | (acdcMask << 24)) | (iChip << 12) | acdc.params_.triggerThresholds[6*iChip + iChan];
-			    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x100, /*data*/command);
-			    OtsUDPHardware::write(writeBuffer);
+			    writes.add(/*address*/ 0x100, /*data*/command);
 			}
 		    }
 	        }
@@ -334,9 +334,9 @@ void FEACCInterface::configure(void)
 	}
 
 	//set fifo backpressure depth to maximum
-	OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/ 0x0057, /*data*/0xe1);
-	OtsUDPHardware::write(writeBuffer);		
-	__CFG_COUT__ << "Done with configuring." << std::endl;
+	writes.add(/*address*/ 0x0057, /*data*/0xe1);
+	commitWrites(writes);
+	__CFG_COUT__ << "Done with configuring in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() << " ms." << std::endl;
 }  // end configure()
 
 //==============================================================================
@@ -546,33 +546,31 @@ void FEACCInterface::setHardwareTrigSrc(int src, unsigned int boardMask)
         
         }
 
-	std::string writeBuffer;
+	RegisterWrites writes;
 	//ACC hardware trigger
 	for(unsigned int i = 0; i < 8; ++i)
     {
 	  if((boardMask >> i) & 1)
 	  {
-	      OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x0030+i, ACCtrigMode);
-	      OtsUDPHardware::write(writeBuffer);
+	      writes.add(0x0030+i, ACCtrigMode);
 	  }
 	  else                  
 	  {
-	      OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x0030+i, 0);
-	      OtsUDPHardware::write(writeBuffer);
+	      writes.add(0x0030+i, 0);
 	  } 
     }
 	//ACDC hardware trigger
 	unsigned int command = 0x00B00000;
 	command = (command | (boardMask << 24)) | (unsigned short)ACDCtrigMode;
-	OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x100, command);
-	OtsUDPHardware::write(writeBuffer);
+	writes.add(0x100, command);
+	commitWrites(writes);
 }
 
 /*ID 20: Switch for the calibration input on the ACC*/
 void FEACCInterface::toggleCal(int onoff, unsigned int channelmask, unsigned int boardMask)
 {
 	unsigned int command = 0x00C00000;
-	std::string writeBuffer;
+	RegisterWrites writes;
 	//the firmware just uses the channel mask to toggle
 	//switch lines. So if the cal is off, all channel lines
 	//are set to be off. Else, uses channel mask
@@ -580,17 +578,15 @@ void FEACCInterface::toggleCal(int onoff, unsigned int channelmask, unsigned int
 	{
 		//channelmas is default 0x7FFF
 		command = (command | (boardMask << 24)) | channelmask;
-		OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x0100, 0x00c10001|(boardMask<<24));
-		OtsUDPHardware::write(writeBuffer);
+		writes.add(0x0100, 0x00c10001|(boardMask<<24));
 	}
 	else if(onoff == 0)
 	{
 		command = (command | (boardMask << 24));
-		OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x0100, 0x00c10000|(boardMask<<24));
-		OtsUDPHardware::write(writeBuffer);
+		writes.add(0x0100, 0x00c10000|(boardMask<<24));
 	}
-	OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x0100, command);
-	OtsUDPHardware::write(writeBuffer);
+	writes.add(0x0100, command);
+	commitWrites(writes);
           
 
 }
@@ -639,18 +635,17 @@ int FEACCInterface::listenForAcdcData()
 /*ID 19: Pedestal setting procedure.*/
 bool FEACCInterface::setPedestals(unsigned int boardmask, unsigned int chipmask, unsigned int adc)
 {
+    RegisterWrites writes;
     for(int iChip = 0; iChip < 5; ++iChip)
     {
 	if(chipmask & (0x01 << iChip))
 	{
 	    unsigned int command = 0x00A20000;
 	    command = (command | (boardmask << 24) ) | (iChip << 12) | adc;
-		std::string writeBuffer;
-	    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x0100, command);
-	    OtsUDPHardware::write(writeBuffer);
-          
+	    writes.add(0x0100, command);
 	}
     }
+    commitWrites(writes);
     return true;
 }
 
@@ -664,14 +659,14 @@ bool FEACCInterface::setPedestals(unsigned int boardmask, const std::vector<unsi
         return false;
     }
 
+    RegisterWrites writes;
     for(int iChip = 0; iChip < 5; ++iChip)
     {
         unsigned int command = 0x00A20000;
         command = (command | (boardmask << 24) ) | (iChip << 12) | pedestals[iChip];
-		std::string writeBuffer;
-		OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x0100, command);
-		OtsUDPHardware::write(writeBuffer);
+        writes.add(0x0100, command);
     }
+    commitWrites(writes);
     return true;
 }
 
@@ -833,17 +828,27 @@ void FEACCInterface::softwareTrigger()
 }
 
 /*ID 16: Used to dis/enable transfer data from the PSEC chips to the buffers*/
-void FEACCInterface::enableTransfer(int onoff, int acdcMask)
+void FEACCInterface::enableTransfer(int onoff, int acdcMask, RegisterWrites* writes)
 {
     unsigned int command;
     command = 0x00F60000;
+    if(writes) //queue into the caller's transaction
+    {
+        writes->add(0x0100, ((0xff&acdcMask) << 24) | command | onoff);
+        return;
+    }
     std::string writeBuffer;
     OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x0100, ((0xff&acdcMask) << 24) | command | onoff);
     OtsUDPHardware::write(writeBuffer);
 }
 /*ID 18: Tells ACDCs to clear their ram.*/ 
-void FEACCInterface::dumpData(unsigned int boardMask)
+void FEACCInterface::dumpData(unsigned int boardMask, RegisterWrites* writes)
 {
+    if(writes) //queue into the caller's transaction
+    {
+        writes->add(0x0001, boardMask);
+        return;
+    }
     //send and read.
 	std::string writeBuffer;
     OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x0001, /*data*/boardMask);
@@ -883,6 +888,9 @@ void FEACCInterface::resetACC()
     sleep(5);//TODO: I do not know if it is wise to stop the data processing thread like this. -Jin
     OtsUDPFirmwareCore::writeAdvanced(writeBuffer, /*address*/0x0, /*data*/1);
     OtsUDPHardware::write(writeBuffer);
+
+    //link phases are back to their defaults
+    for(int i = 0; i < 8; ++i) linkPhases_[i] = -1;
           
     __CFG_COUT__ << "ACC was reset" << std::endl;
 }
@@ -988,6 +996,7 @@ void FEACCInterface::scanLinkPhase(unsigned int boardMask, bool print)
                     }
                 }
                 int phaseSetting = (stop - length_best/2)%errors.size();
+                linkPhases_[iChan] = phaseSetting;
                 if(print) printout << setw(15) << phaseSetting << "          ";
 		std::string writeBuffer;
 		OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x0054, /*data*/0);
@@ -1021,23 +1030,215 @@ void FEACCInterface::scanLinkPhase(unsigned int boardMask, bool print)
 
 }
 
+/*ID 31: Checks the high speed links with the PRBS pattern, true if no masked link shows decode errors*/
+bool FEACCInterface::checkLinkHealth(unsigned int boardMask)
+{
+    std::vector<uint64_t> decode_errors = measureLinkErrors(boardMask & 0xff, params_.linkScanAlignTime, params_.linkScanWindow);
+
+    // set transmitter back to idle mode
+    enableTransfer(0);
+
+    for(int iChan = 0; iChan < 8; ++iChan)
+    {
+        if((boardMask & (1 << iChan)) && decode_errors[iChan] != 0) return false;
+    }
+    return true;
+}
+
+/*ID 30: Coarse-then-fine link phase scan. Every 3rd phase is measured first, then
+  only the phases next to the edges of each link's error free window. Each step
+  realigns on the idle pattern for linkScanAlignTime and polls the decode error
+  counters for at most linkScanWindow, stopping early once all links erred.*/
+void FEACCInterface::scanLinkPhaseFast(unsigned int boardMask, bool print)
+{
+    const int nPhases = 24; //phase steps in one clock cycle
+    const int coarseStep = 3;
+    unsigned int chanMask = boardMask & 0xff;
+    if(!chanMask) return;
+
+    //skip the scan if the phases found before still give clean links
+    bool cached = true;
+    for(int iChan = 0; iChan < 8; ++iChan)
+    {
+        if((chanMask & (1 << iChan)) && linkPhases_[iChan] < 0) cached = false;
+    }
+    if(cached && checkLinkHealth(chanMask))
+    {
+        if(print) __CFG_COUT__ << "Links are healthy, keeping cached link phases" << __E__;
+        return;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<std::vector<uint64_t>> errors(nPhases); //empty if the phase was not measured
+    int current = 0; //phase steps applied to all links since the start of the scan
+    int nMeasured = 0;
+    auto measureAt = [&](int phase)
+    {
+        RegisterWrites writes;
+        writes.add(0x0054, 0);
+        for(int iChan = 0; iChan < 8; ++iChan) advanceLinkPhase(writes, iChan, (phase - current + nPhases)%nPhases);
+        commitWrites(writes, false);
+        current = phase;
+        errors[phase] = measureLinkErrors(chanMask, params_.linkScanAlignTime, params_.linkScanWindow);
+        ++nMeasured;
+    };
+    //a phase counts as good if it was measured error free, or if it was skipped
+    //and both enclosing coarse phases were error free
+    auto isGood = [&](int iChan, int phase) -> bool
+    {
+        phase = (phase + nPhases)%nPhases;
+        if(!errors[phase].empty()) return errors[phase][iChan] == 0;
+        int below = phase - phase%coarseStep;
+        int above = (below + coarseStep)%nPhases;
+        return errors[below][iChan] == 0 && errors[above][iChan] == 0;
+    };
+
+    //coarse pass
+    for(int phase = 0; phase < nPhases; phase += coarseStep) measureAt(phase);
+
+    //fine pass: measure the skipped phases bordering good coarse phases
+    std::set<int> fine;
+    for(int iChan = 0; iChan < 8; ++iChan)
+    {
+        if(!(chanMask & (1 << iChan))) continue;
+        for(int phase = 0; phase < nPhases; phase += coarseStep)
+        {
+            bool good = errors[phase][iChan] == 0;
+            bool nextGood = errors[(phase + coarseStep)%nPhases][iChan] == 0;
+            if(good == nextGood) continue; //no edge in between
+            for(int i = 1; i < coarseStep; ++i) fine.insert((phase + i)%nPhases);
+        }
+    }
+    for(int phase : fine) measureAt(phase);
+
+    //pick the center of the longest error free window of each link
+    int phaseSetting[8];
+    for(int iChan = 0; iChan < 8; ++iChan)
+    {
+        phaseSetting[iChan] = 0;
+        if(!(chanMask & (1 << iChan))) continue;
+
+        int start = 0;
+        int length = 0;
+        int length_best = 0;
+        int start_best = 0;
+        for(int i = 0; i < 2*nPhases; ++i)
+        {
+            if(isGood(iChan, i) && length < nPhases)
+            {
+                if(length == 0) start = i;
+                ++length;
+                if(length > length_best)
+                {
+                    length_best = length;
+                    start_best = start;
+                }
+            }
+            else
+            {
+                length = 0;
+            }
+        }
+        if(length_best == 0)
+        {
+            __SS__ << "No error free link phase found for link " << iChan << "." << std::endl;
+            __CFG_COUT_ERR__ << ss.str();
+        }
+        phaseSetting[iChan] = (start_best + length_best/2)%nPhases;
+    }
+
+    // set transmitter back to idle mode
+    enableTransfer(0);
+
+    //move every link to its phase, unmasked links return to where they started
+    RegisterWrites writes;
+    writes.add(0x0054, 0);
+    for(int iChan = 0; iChan < 8; ++iChan) advanceLinkPhase(writes, iChan, (phaseSetting[iChan] - current + nPhases)%nPhases);
+    commitWrites(writes);
+
+    std::stringstream printout;
+    if(print) printout << "Fast link phase scan, " << nMeasured << " of " << nPhases << " phases measured\nSet:   ";
+    for(int iChan = 0; iChan < 8; ++iChan)
+    {
+        if(chanMask & (1 << iChan))
+        {
+            linkPhases_[iChan] = phaseSetting[iChan];
+            if(print) printout << setw(15) << phaseSetting[iChan] << "          ";
+        }
+        else
+        {
+            if(print) printout << setw(25) << " ";
+        }
+    }
+
+    // ensure at least 1 ms for links to realign (ensures at least 25 alignment markers)
+    usleep(1000);
+
+    //reset error counters
+    std::string writeBuffer;
+    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x0053, 0);
+    OtsUDPHardware::write(writeBuffer);
+
+    if(print) __CFG_COUT__ << printout.str() << "\nScan took " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() << " ms" << __E__;
+}
+
+//queues steps phase advances of one link, all sent as one command
+void FEACCInterface::advanceLinkPhase(RegisterWrites& writes, int chan, int steps)
+{
+    if(steps <= 0) return;
+    writes.add(0x0055, chan);
+    for(int i = 0; i < steps; ++i) writes.add(0x0056, 0);
+}
+
+//realigns the links on the idle pattern, switches to PRBS and polls the decode error
+//counters until the window ends or every masked link shows errors
+std::vector<uint64_t> FEACCInterface::measureLinkErrors(unsigned int chanMask, int alignTime, int window)
+{
+    // transmit idle pattern to make sure link is aligned 
+    enableTransfer(0);
+    usleep(alignTime);
+
+    //transmit PRBS pattern 
+    enableTransfer(1);
+    usleep(100);
+
+    //reset error counters 
+    std::string writeBuffer;
+    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x0053, 0);
+    OtsUDPHardware::write(writeBuffer);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(window);
+    std::vector<uint64_t> decode_errors;
+    while(true)
+    {
+        OtsUDPFirmwareCore::readAdvanced(writeBuffer, 0x1120, 8, 0, true);//flags=0, clear_buffer=true
+        OtsUDPHardware::read(writeBuffer, decode_errors);
+        decode_errors.resize(8, 0);
+
+        bool allFailed = true;
+        for(int iChan = 0; iChan < 8; ++iChan)
+        {
+            if((chanMask & (1 << iChan)) && decode_errors[iChan] == 0) allFailed = false;
+        }
+        if(allFailed || std::chrono::steady_clock::now() >= deadline) break;
+    }
+    return decode_errors;
+}
+
 void FEACCInterface::sendJCPLLSPIWord(unsigned int word, unsigned int boardMask, bool verbose)
 {
     unsigned int clearRequest = 0x00F10000 | (boardMask << 24);
     unsigned int lower16 = 0x00F30000 | (boardMask << 24) | (0xFFFF & word);
     unsigned int upper16 = 0x00F40000 | (boardMask << 24) | (0xFFFF & (word >> 16));
     unsigned int setPLL = 0x00F50000 | (boardMask << 24);
-    std::string writeBuffer;
-    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x100, clearRequest);
-    OtsUDPHardware::write(writeBuffer);
-    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x100, lower16);
-    OtsUDPHardware::write(writeBuffer);
-    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x100, upper16);
-    OtsUDPHardware::write(writeBuffer);
-    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x100, setPLL);
-    OtsUDPHardware::write(writeBuffer);
-    OtsUDPFirmwareCore::writeAdvanced(writeBuffer, 0x100, clearRequest);
-    OtsUDPHardware::write(writeBuffer);
+    RegisterWrites writes;
+    writes.add(0x100, clearRequest);
+    writes.add(0x100, lower16);
+    writes.add(0x100, upper16);
+    writes.add(0x100, setPLL);
+    writes.add(0x100, clearRequest);
+    commitWrites(writes);
 
     if(verbose)
     {
@@ -1083,6 +1284,43 @@ void FEACCInterface::configJCPLL(unsigned int boardMask)
 
 }
 
+/*ID 29: Sends collected register writes in as few datagrams as possible and clears them.
+  Consecutive writes to one address (e.g. the ACDC command register 0x100) become one
+  command with NO_ADDR_INC, writes to consecutive addresses one incrementing command.
+  Order is preserved. If requested, only the last datagram is acknowledged, which
+  also confirms the ones before it since the firmware processes them in order.*/
+void FEACCInterface::commitWrites(RegisterWrites& writes, bool acknowledge)
+{
+    const std::vector<std::pair<uint64_t, uint64_t>>& w = writes.writes();
+    std::string writeBuffer;
+    std::vector<uint64_t> data;
+    data.reserve(MAX_WRITE_WORDS);
+
+    size_t i = 0;
+    while(i < w.size())
+    {
+        uint64_t address = w[i].first;
+        bool sameAddress = i + 1 < w.size() && w[i + 1].first == address;
+
+        data.clear();
+        data.push_back(w[i].second);
+        size_t j = i + 1;
+        while(j < w.size() && data.size() < MAX_WRITE_WORDS && w[j].first == (sameAddress ? address : address + data.size()))
+        {
+            data.push_back(w[j].second);
+            ++j;
+        }
+        i = j;
+
+        if(data.size() == 1) OtsUDPFirmwareCore::writeAdvanced(writeBuffer, address, data[0]);
+        else                 OtsUDPFirmwareCore::writeAdvanced(writeBuffer, address, data, sameAddress ? 0x08 : 0);//NO_ADDR_INC=0x08
+
+        if(acknowledge && i == w.size()) OtsUDPHardware::writeAndAcknowledge(writeBuffer);
+        else                             OtsUDPHardware::write(writeBuffer);
+    }
+    writes.clear();
+}
+
 std::vector<uint64_t> FEACCInterface::readSlowControl(const int iacdc, const int timeout)
 {
     std::string writeBuffer;
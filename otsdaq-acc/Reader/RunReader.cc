@@ -0,0 +1,304 @@
+#include "RunReader.h"
+#include "otsdaq-acc/ACC/AccPacket.h"
+#include "otsdaq-acc/ACC/Crc32c.h"
+#include "otsdaq-acc/ACC/WaveformCodec.h"
+#include "otsdaq-acc/ACC/ZeroSuppressor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+RunFileReader::RunFileReader() : data_(nullptr), size_(0), format_(FORMAT_RAW), compressed_(false), recovered_(false)
+{
+}
+
+RunFileReader::~RunFileReader()
+{
+    close();
+}
+
+bool RunFileReader::open(const string& fileName, AccessHint hint)
+{
+    close();
+    fileName_ = fileName;
+    error_.clear();
+
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        error_ = "Can't open " + fileName + ": " + strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        error_ = "Can't read the size of " + fileName + " or it is empty";
+        ::close(fd);
+        return false;
+    }
+    size_ = st.st_size;
+    void* map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); //the mapping keeps the file referenced
+    if(map == MAP_FAILED)
+    {
+        error_ = "Can't map " + fileName + ": " + strerror(errno);
+        size_ = 0;
+        return false;
+    }
+    data_ = static_cast<const char*>(map);
+    setAccessHint(hint);
+
+    compressed_ = size_ >= sizeof(RunFileHeader) && memcmp(data_, RUNFILE_MAGIC_COMPRESSED, sizeof(RUNFILE_MAGIC_COMPRESSED)) == 0;
+    if(compressed_ || (size_ >= sizeof(RunFileHeader) && memcmp(data_, RUNFILE_MAGIC, sizeof(RUNFILE_MAGIC)) == 0))
+    {
+        format_ = FORMAT_INDEXED;
+        const RunFileHeader* header = getHeader();
+        if(header->version != RUNFILE_VERSION)
+        {
+            error_ = fileName + ": unsupported run file version " + to_string(header->version);
+            close();
+            return false;
+        }
+        if(!loadIndex()) recoverIndex();
+    }
+    else
+    {
+        format_ = FORMAT_RAW;
+        scanRaw();
+    }
+    return true;
+}
+
+void RunFileReader::close()
+{
+    if(data_) munmap(const_cast<char*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+    compressed_ = false;
+    recovered_ = false;
+    events_.clear();
+}
+
+void RunFileReader::setAccessHint(AccessHint hint)
+{
+#ifdef __linux__
+    if(!data_) return;
+    int advice = hint == ACCESS_SEQUENTIAL ? MADV_SEQUENTIAL : hint == ACCESS_RANDOM ? MADV_RANDOM : MADV_NORMAL;
+    madvise(const_cast<char*>(data_), size_, advice);
+#endif
+}
+
+span<const uint64_t> RunFileReader::event(size_t i) const
+{
+    const Entry& entry = events_[i];
+    return span<const uint64_t>(reinterpret_cast<const uint64_t*>(data_ + entry.offset), entry.bytes/sizeof(uint64_t));
+}
+
+span<const char> RunFileReader::payload(size_t i) const
+{
+    const Entry& entry = events_[i];
+    return span<const char>(data_ + entry.offset, entry.bytes);
+}
+
+bool RunFileReader::verify(size_t i) const
+{
+    if(format_ == FORMAT_RAW) return true;
+    const Entry& entry = events_[i];
+    return crc32c(data_ + entry.offset, entry.bytes) == entry.crc32c;
+}
+
+//reads the footer index, false if it is missing or damaged
+bool RunFileReader::loadIndex()
+{
+    const RunFileHeader* header = getHeader();
+    if(size_ < header->headerSize + sizeof(RunFileTrailer)) return false;
+
+    RunFileTrailer trailer;
+    memcpy(&trailer, data_ + size_ - sizeof(trailer), sizeof(trailer));
+    if(memcmp(trailer.magic, RUNFILE_INDEX_MAGIC, sizeof(trailer.magic)) != 0) return false;
+    if(trailer.indexOffset < header->headerSize || trailer.indexOffset > size_ - sizeof(trailer)) return false;
+    if(trailer.nEvents > (size_ - sizeof(trailer) - trailer.indexOffset)/sizeof(RunFileIndexEntry)) return false;
+
+    const RunFileIndexEntry* index = reinterpret_cast<const RunFileIndexEntry*>(data_ + trailer.indexOffset);
+    if(crc32c(index, trailer.nEvents*sizeof(RunFileIndexEntry)) != trailer.indexCrc32c) return false;
+
+    events_.resize(trailer.nEvents);
+    for(size_t i = 0; i < trailer.nEvents; ++i)
+    {
+        if(index[i].offset < header->headerSize || index[i].offset > trailer.indexOffset ||
+           trailer.indexOffset - index[i].offset < sizeof(RunFileRecord) + index[i].payloadBytes)
+        {
+            events_.clear();
+            return false;
+        }
+        events_[i] = {index[i].offset + sizeof(RunFileRecord), index[i].payloadBytes, index[i].crc32c};
+    }
+    return true;
+}
+
+//walks the record headers up to the first one that does not fit
+void RunFileReader::recoverIndex()
+{
+    recovered_ = true;
+    events_.clear();
+    uint64_t offset = getHeader()->headerSize;
+    while(offset + sizeof(RunFileRecord) <= size_)
+    {
+        RunFileRecord record;
+        memcpy(&record, data_ + offset, sizeof(record));
+        uint64_t padded = (record.payloadBytes + 7) & ~uint64_t(7);
+        if(record.magic != RUNFILE_RECORD_MAGIC || record.eventNumber != events_.size() || offset + sizeof(record) + padded > size_) break;
+        events_.push_back({offset + sizeof(record), record.payloadBytes, record.crc32c});
+        offset += sizeof(record) + padded;
+    }
+}
+
+//events start with the magic word of the first packet followed by the ACDC header word
+void RunFileReader::scanRaw()
+{
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(data_);
+    size_t nWords = size_/sizeof(uint64_t);
+    size_t start = nWords;
+    for(size_t i = 0; i + 1 < nWords; ++i)
+    {
+        if((words[i] & AccPacketView::EVENT_MAGIC_MASK) != AccPacketView::EVENT_MAGIC || (words[i + 1] & AccPacketView::ACDC_HEADER_MASK) != AccPacketView::ACDC_HEADER) continue;
+        if(start < nWords) events_.push_back({start*sizeof(uint64_t), (uint32_t)((i - start)*sizeof(uint64_t)), 0});
+        start = i;
+    }
+    if(start < nWords) events_.push_back({start*sizeof(uint64_t), (uint32_t)((nWords - start)*sizeof(uint64_t)), 0});
+}
+
+RunReader::RunReader() : decodedEvent_(0), decodedValid_(false)
+{
+}
+
+bool RunReader::open(const vector<string>& fileNames, AccessHint hint)
+{
+    close();
+    offsets_.push_back(0);
+    for(const string& fileName : fileNames)
+    {
+        //a writer that crashed before its first buffer leaves an empty file, it holds no events
+        error_code ec;
+        if(filesystem::is_regular_file(fileName, ec) && filesystem::file_size(fileName, ec) == 0 && !ec)
+        {
+            skippedFiles_.push_back(fileName);
+            continue;
+        }
+
+        files_.emplace_back(new RunFileReader());
+        if(!files_.back()->open(fileName, hint))
+        {
+            error_ = files_.back()->getError();
+            close();
+            return false;
+        }
+        offsets_.push_back(offsets_.back() + files_.back()->getNumEvents());
+    }
+    return true;
+}
+
+bool RunReader::openRun(const string& directory, const string& radix, const string& boardID, const string& runNumber, AccessHint hint)
+{
+    vector<string> fileNames = findRunFiles(directory, radix, boardID, runNumber);
+    if(fileNames.empty())
+    {
+        close();
+        error_ = "No files of run " + runNumber + " for " + boardID + " in " + directory;
+        return false;
+    }
+    return open(fileNames, hint);
+}
+
+void RunReader::close()
+{
+    files_.clear();
+    offsets_.clear();
+    skippedFiles_.clear();
+    error_.clear();
+    decodedValid_ = false;
+}
+
+void RunReader::setAccessHint(AccessHint hint)
+{
+    for(auto& file : files_) file->setAccessHint(hint);
+}
+
+RunReader::Event RunReader::getEvent(size_t i) const
+{
+    Event event;
+    event.file = upper_bound(offsets_.begin(), offsets_.end(), i) - offsets_.begin() - 1;
+    event.number = i;
+    const RunFileReader& file = *files_[event.file];
+    if(file.isCompressed())
+    {
+        long bytes = WaveformCodec::decode(file.payload(i - offsets_[event.file]), inflated_);
+        event.words = bytes < 0 ? span<const uint64_t>() : span<const uint64_t>(inflated_);
+    }
+    else
+    {
+        event.words = file.event(i - offsets_[event.file]);
+    }
+    if(ZeroSuppressor::isSuppressed(event.words))
+    {
+        event.words = ZeroSuppressor::expand(event.words, expanded_) ? span<const uint64_t>(expanded_) : span<const uint64_t>();
+    }
+    return event;
+}
+
+bool RunReader::verify(size_t i) const
+{
+    int file = upper_bound(offsets_.begin(), offsets_.end(), i) - offsets_.begin() - 1;
+    return files_[file]->verify(i - offsets_[file]);
+}
+
+const Waveforms* RunReader::waveforms(size_t i)
+{
+    if(!decodedValid_ || decodedEvent_ != i)
+    {
+        decodedEvent_ = i;
+        decodedValid_ = decoder_.parseDataFromBuffer(getEvent(i).words) >= 0;
+        if(!decodedValid_) return nullptr;
+    }
+    return &decoder_.getWaveforms();
+}
+
+//file names as written by ACCBurstDataSaverConsumer::openFile:
+//<radix>_<boardID>_Run<run>[_<subrun>]_Raw.{dat,accrun,accz}
+vector<string> RunReader::findRunFiles(const string& directory, const string& radix, const string& boardID, const string& runNumber)
+{
+    const string prefix = radix + "_" + boardID + "_Run" + runNumber;
+    vector<pair<long, string>> found;
+
+    error_code ec;
+    for(const auto& entry : filesystem::directory_iterator(directory, ec))
+    {
+        string name = entry.path().filename().string();
+        if(name.compare(0, prefix.size(), prefix) != 0) continue;
+
+        string rest = name.substr(prefix.size());
+        long subRun = -1;
+        size_t pos = 0;
+        if(rest.size() > 1 && rest[0] == '_' && isdigit((unsigned char)rest[1]))
+        {
+            subRun = strtol(rest.c_str() + 1, nullptr, 10);
+            pos = rest.find('_', 1);
+            if(pos == string::npos) continue;
+        }
+        rest = rest.substr(pos);
+        if(rest != "_Raw.dat" && rest != "_Raw.accrun" && rest != "_Raw.accz") continue;
+        found.emplace_back(subRun, entry.path().string());
+    }
+
+    sort(found.begin(), found.end());
+    vector<string> fileNames;
+    for(auto& file : found) fileNames.push_back(file.second);
+    return fileNames;
+}
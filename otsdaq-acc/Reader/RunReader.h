@@ -0,0 +1,161 @@
+#ifndef _RUNREADER_H_INCLUDED
+#define _RUNREADER_H_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+#include "otsdaq-acc/ACC/ACDC.h"
+#include "otsdaq-acc/ACC/RunFile.h"
+
+using namespace std;
+
+//Random-access readers for the files written by ACCBurstDataSaverConsumer.
+//Files are memory mapped; events are handed out as spans pointing into
+//the mapping, so iterating a run copies nothing. Waveforms are only
+//unpacked when asked for.
+//
+//Both formats are understood:
+//  indexed (.accrun, see RunFile.h): events come from the footer index; a
+//          file without index (writer crashed) is recovered by walking the
+//          record headers
+//  compressed (.accz): indexed layout with WaveformCodec payloads; these
+//          events are decompressed into a buffer of the reader on access
+//  raw (_Raw.dat): bare events back to back, located once on open by
+//          scanning for the event header words
+//Zero suppressed events (see ZeroSuppressor.h) in any of them are expanded
+//to full events on access, the dropped samples set to the pedestal.
+
+//How the kernel should read ahead (madvise, Linux only, ignored elsewhere)
+enum AccessHint
+{
+    ACCESS_NORMAL,
+    ACCESS_SEQUENTIAL, //aggressive read-ahead, pages behind are dropped early
+    ACCESS_RANDOM      //no read-ahead, for sparse seeks
+};
+
+//One mapped file
+class RunFileReader
+{
+public:
+    enum Format
+    {
+        FORMAT_INDEXED,
+        FORMAT_RAW
+    };
+
+    RunFileReader();
+    ~RunFileReader(); //unmaps the file
+    RunFileReader(const RunFileReader&) = delete;
+    RunFileReader& operator=(const RunFileReader&) = delete;
+
+    //----------control
+    bool open(const string& fileName, AccessHint hint = ACCESS_NORMAL); //returns false and sets getError() if the file is unreadable
+    void close();
+    bool is_open() const {return data_ != nullptr;}
+    void setAccessHint(AccessHint hint);
+
+    //----------event access, spans stay valid until close()
+    size_t getNumEvents() const {return events_.size();}
+    span<const uint64_t> event(size_t i) const; //unchecked, uncompressed files only
+    span<const char> payload(size_t i) const; //stored bytes of the event, compressed or not
+    bool verify(size_t i) const; //compares the CRC32C of an indexed file, raw events always pass
+
+    //----------local return functions
+    Format getFormat() const {return format_;}
+    bool isCompressed() const {return compressed_;}
+    bool isRecovered() const {return recovered_;} //indexed file without a valid index
+    const RunFileHeader* getHeader() const {return format_ == FORMAT_INDEXED ? reinterpret_cast<const RunFileHeader*>(data_) : nullptr;}
+    const string& getFileName() const {return fileName_;}
+    const string& getError() const {return error_;}
+    size_t getFileSize() const {return size_;}
+
+private:
+    struct Entry
+    {
+        uint64_t offset;  //of the payload, in bytes
+        uint32_t bytes;
+        uint32_t crc32c;
+    };
+
+    bool loadIndex();
+    void recoverIndex();
+    void scanRaw();
+
+    string fileName_;
+    string error_;
+    const char* data_;
+    size_t size_;
+    Format format_;
+    bool compressed_;
+    bool recovered_;
+    vector<Entry> events_;
+};
+
+//All files of one board and run, in subrun order, seen as one sequence of events
+class RunReader
+{
+public:
+    //one event of the run, only valid while the reader is open; for
+    //compressed files only until the next event is fetched
+    class Event
+    {
+    public:
+        span<const uint64_t> words;
+        size_t number; //position in the run
+        int file;      //file it came from
+        int board() const {return words.empty() ? -1 : (int)(words[0] & 0xff);}
+    };
+
+    class iterator
+    {
+    public:
+        iterator(const RunReader* reader, size_t i) : reader_(reader), i_(i) {}
+        Event operator*() const {return reader_->getEvent(i_);}
+        iterator& operator++() {++i_; return *this;}
+        bool operator!=(const iterator& other) const {return i_ != other.i_;}
+    private:
+        const RunReader* reader_;
+        size_t i_;
+    };
+
+    RunReader();
+
+    //----------control
+    bool open(const vector<string>& fileNames, AccessHint hint = ACCESS_NORMAL); //files in subrun order, empty ones are skipped (see getSkippedFiles())
+    bool openRun(const string& directory, const string& radix, const string& boardID, const string& runNumber, AccessHint hint = ACCESS_NORMAL);
+    void close();
+    void setAccessHint(AccessHint hint);
+
+    //----------event access
+    size_t getNumEvents() const {return offsets_.empty() ? 0 : offsets_.back();}
+    Event getEvent(size_t i) const; //unchecked, words are empty if a compressed or zero suppressed event is corrupt
+    iterator begin() const {return iterator(this, 0);}
+    iterator end() const {return iterator(this, getNumEvents());}
+    bool verify(size_t i) const;
+
+    //----------lazy decoding, through ACDC::parseDataFromBuffer
+    const Waveforms* waveforms(size_t i); //nullptr if the event is corrupt, valid until the next call
+
+    //----------local return functions
+    static vector<string> findRunFiles(const string& directory, const string& radix, const string& boardID, const string& runNumber); //sorted by subrun
+    int getNumFiles() const {return (int)files_.size();} //without the skipped ones
+    const RunFileReader& getFile(int i) const {return *files_[i];}
+    const vector<string>& getSkippedFiles() const {return skippedFiles_;} //empty files open() left out
+    const string& getError() const {return error_;}
+
+private:
+    vector<unique_ptr<RunFileReader>> files_;
+    vector<size_t> offsets_; //first event number of each file, plus the total
+    vector<string> skippedFiles_;
+    string error_;
+    mutable vector<uint64_t> inflated_; //decompressed event
+    mutable vector<uint64_t> expanded_; //zero suppressed event expanded to the full event
+    ACDC decoder_;
+    size_t decodedEvent_; //event currently unpacked in decoder_
+    bool decodedValid_;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef _BENCHMARKDATA_H_INCLUDED
+#define _BENCHMARKDATA_H_INCLUDED
+
+#include <algorithm>
+#include <span>
+#include <string>
+#include <vector>
+#include "otsdaq-acc/ACC/Metadata.h"
+#include "otsdaq-acc/ACC/PacketGenerator.h"
+
+using namespace std;
+
+//Input data shared by the benchmarks. Everything is synthetic and seeded,
+//so runs on different machines and builds see the same bytes.
+
+//one event per board, cut to nWords (the ACDC header stays intact)
+inline vector<vector<uint64_t>> makeEvents(int nBoards, size_t nWords = PacketGenerator::EVENT_WORDS)
+{
+    PacketGenerator::Options options;
+    options.boards.clear();
+    for(int i = 0; i < nBoards; ++i) options.boards.push_back(i);
+    options.poolSize = 1;
+    PacketGenerator generator;
+    generator.setOptions(options);
+
+    vector<vector<uint64_t>> events;
+    for(int i = 0; i < nBoards; ++i)
+    {
+        span<const uint64_t> event = generator.makeEvent(i);
+        events.emplace_back(event.begin(), event.begin() + min(nWords, event.size()));
+    }
+    return events;
+}
+
+//the 8 packets of every event, boards interleaved as the ACC sends them
+inline vector<string> makePackets(int nBoards, size_t nWords, int eventsPerBoard)
+{
+    vector<vector<uint64_t>> events = makeEvents(nBoards, nWords);
+    PacketGenerator generator;
+    vector<string> packets, eventPackets;
+    for(int n = 0; n < eventsPerBoard; ++n)
+    {
+        for(vector<uint64_t>& event : events)
+        {
+            ++event[1]; //event count
+            generator.packetize(event, eventPackets);
+            packets.insert(packets.end(), eventPackets.begin(), eventPackets.end());
+        }
+    }
+    return packets;
+}
+
+//psec buffer with the five metadata blocks where the firmware puts them
+inline vector<unsigned short> makePsecBuffer(int board)
+{
+    const int stride = NUM_CH_PER_PSEC*256 + NUM_INFO_WORDS + 2;
+    vector<unsigned short> buffer(7800, 0x800);
+    for(int chip = 0; chip < NUM_PSEC; ++chip)
+    {
+        int start = 1 + chip*stride;
+        buffer[start] = 0xBA11;
+        for(int i = 0; i < NUM_INFO_WORDS; ++i) buffer[start + 1 + i] = (unsigned short)(0x100*chip + i + board);
+        buffer[start + 1 + NUM_INFO_WORDS] = 0xFACE;
+    }
+    buffer.back() = 0x4321;
+    return buffer;
+}
+
+#endif
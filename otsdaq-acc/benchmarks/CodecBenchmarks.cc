@@ -0,0 +1,74 @@
+#include "BenchmarkData.h"
+#include "otsdaq-acc/ACC/WaveformCodec.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace std;
+
+//WaveformCodec over the events of 8 boards, arg: zstd level (levels > 0
+//are skipped if the library was built without zstd). Bytes are counted
+//uncompressed, the "ratio" counter is uncompressed/compressed size.
+static bool hasLevel(benchmark::State& state)
+{
+    if(state.range(0) > 0 && !WaveformCodec::hasZstd())
+    {
+        state.SkipWithError("built without zstd");
+        return false;
+    }
+    return true;
+}
+
+static void BM_EncodeEvents(benchmark::State& state)
+{
+    if(!hasLevel(state)) return;
+    vector<vector<uint64_t>> events = makeEvents(8);
+    vector<char> encoded;
+    size_t i = 0;
+    uint64_t bytes = 0, encodedBytes = 0;
+    for(auto _ : state)
+    {
+        WaveformCodec::encode(events[i], events[i].size()*sizeof(uint64_t), encoded, state.range(0));
+        benchmark::DoNotOptimize(encoded.data());
+        bytes += events[i].size()*sizeof(uint64_t);
+        encodedBytes += encoded.size();
+        i = (i + 1) % events.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(bytes);
+    state.counters["ratio"] = encodedBytes ? (double)bytes/encodedBytes : 0;
+}
+BENCHMARK(BM_EncodeEvents)->ArgName("zstd")->Arg(0)->Arg(3);
+
+static void BM_DecodeEvents(benchmark::State& state)
+{
+    if(!hasLevel(state)) return;
+    vector<vector<uint64_t>> events = makeEvents(8);
+    vector<vector<char>> encoded(events.size());
+    uint64_t eventBytes = 0, encodedBytes = 0;
+    for(size_t i = 0; i < events.size(); ++i)
+    {
+        WaveformCodec::encode(events[i], events[i].size()*sizeof(uint64_t), encoded[i], state.range(0));
+        eventBytes += events[i].size()*sizeof(uint64_t);
+        encodedBytes += encoded[i].size();
+    }
+
+    vector<uint64_t> words;
+    size_t i = 0;
+    uint64_t bytes = 0;
+    for(auto _ : state)
+    {
+        long size = WaveformCodec::decode(encoded[i], words);
+        if(size < 0)
+        {
+            state.SkipWithError("decode failed");
+            return;
+        }
+        benchmark::DoNotOptimize(words.data());
+        bytes += size;
+        i = (i + 1) % encoded.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(bytes);
+    state.counters["ratio"] = (double)eventBytes/encodedBytes;
+}
+BENCHMARK(BM_DecodeEvents)->ArgName("zstd")->Arg(0)->Arg(3);
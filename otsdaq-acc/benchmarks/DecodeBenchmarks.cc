@@ -0,0 +1,81 @@
+#include "BenchmarkData.h"
+#include "otsdaq-acc/ACC/ACDC.h"
+#include "otsdaq-acc/ACC/SampleUnpacker.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace std;
+
+//ACDC::parseDataFromBuffer over the events of n boards, arg: boards
+static void BM_ParseDataFromBuffer(benchmark::State& state)
+{
+    vector<vector<uint64_t>> events = makeEvents(state.range(0));
+    ACDC acdc;
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(acdc.parseDataFromBuffer(events[i]));
+        benchmark::DoNotOptimize(acdc.getWaveforms());
+        i = (i + 1) % events.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations()*PacketGenerator::EVENT_WORDS*sizeof(uint64_t));
+}
+BENCHMARK(BM_ParseDataFromBuffer)->Arg(1)->Arg(4)->Arg(8);
+
+//the unpacking kernel alone, arg: SampleUnpacker::Implementation
+static void BM_UnpackSamples(benchmark::State& state)
+{
+    SampleUnpacker::Implementation impl = (SampleUnpacker::Implementation)state.range(0);
+    if(!SampleUnpacker::isSupported(impl))
+    {
+        state.SkipWithError("not supported by this CPU");
+        return;
+    }
+    vector<vector<uint64_t>> events = makeEvents(1);
+    vector<uint16_t> samples(NUM_CH*NUM_SAMP);
+    const uint64_t* words = events[0].data() + PacketGenerator::HEADER_WORDS;
+    for(auto _ : state)
+    {
+        if(impl == SampleUnpacker::SCALAR) SampleUnpacker::unpackScalar(words, PacketGenerator::SAMPLE_WORDS, samples.data());
+        else if(impl == SampleUnpacker::SSE4) SampleUnpacker::unpackSSE4(words, PacketGenerator::SAMPLE_WORDS, samples.data());
+        else SampleUnpacker::unpackAVX2(words, PacketGenerator::SAMPLE_WORDS, samples.data());
+        benchmark::DoNotOptimize(samples.data());
+    }
+    state.SetLabel(SampleUnpacker::getName(impl));
+    state.SetItemsProcessed(state.iterations()*NUM_CH*NUM_SAMP);
+}
+BENCHMARK(BM_UnpackSamples)->Arg(SampleUnpacker::SCALAR)->Arg(SampleUnpacker::SSE4)->Arg(SampleUnpacker::AVX2);
+
+//Metadata::parseBuffer of one psec buffer per board, arg: boards
+static void BM_MetadataParseBuffer(benchmark::State& state)
+{
+    vector<vector<unsigned short>> buffers;
+    for(int i = 0; i < state.range(0); ++i) buffers.push_back(makePsecBuffer(i));
+    Metadata meta;
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        benchmark::DoNotOptimize(meta.parseBuffer(buffers[i], i));
+        benchmark::DoNotOptimize(meta.getEventMeta());
+        i = (i + 1) % buffers.size();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MetadataParseBuffer)->Arg(1)->Arg(4)->Arg(8);
+
+//Metadata::decodeBatch, arg: events per batch
+static void BM_MetadataDecodeBatch(benchmark::State& state)
+{
+    Metadata meta;
+    meta.parseBuffer(makePsecBuffer(0), 0);
+    vector<AcdcEventMeta> in(state.range(0), meta.getEventMeta());
+    vector<AcdcDecodedMeta> out(in.size());
+    for(auto _ : state)
+    {
+        Metadata::decodeBatch(in, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations()*in.size());
+}
+BENCHMARK(BM_MetadataDecodeBatch)->Arg(8)->Arg(256);
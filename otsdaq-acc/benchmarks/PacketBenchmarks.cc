@@ -0,0 +1,117 @@
+#include "BenchmarkData.h"
+#include "otsdaq-acc/ACC/AccPacket.h"
+#include "otsdaq-acc/ACC/EventAssembler.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace std;
+
+namespace
+{
+const int EVENTS_PER_BOARD = 64; //packets cycled by the benchmarks, about 6 MB for 8 full boards
+
+void eventArgs(benchmark::internal::Benchmark* b)
+{
+    for(int boards : {1, 4, 8})
+    {
+        for(int words : {386, (int)PacketGenerator::EVENT_WORDS}) b->Args({boards, words});
+    }
+    b->ArgNames({"boards", "words"});
+}
+
+uint64_t totalBytes(const vector<string>& packets)
+{
+    uint64_t bytes = 0;
+    for(const string& packet : packets) bytes += packet.size();
+    return bytes;
+}
+}
+
+//the per packet validation at the top of ACCBurstDataSaverConsumer::save
+static void BM_PacketValidation(benchmark::State& state)
+{
+    vector<string> packets = makePackets(state.range(0), state.range(1), EVENTS_PER_BOARD);
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        AccPacketView packet(packets[i]);
+        benchmark::DoNotOptimize(packet.isValid());
+        benchmark::DoNotOptimize(packet.isEventHeader());
+        benchmark::DoNotOptimize(packet.packetID());
+        if(++i == packets.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PacketValidation)->Apply(eventArgs);
+
+//the checks save() did before AccPacketView: misaligned casts on every header, reference for BM_PacketValidation
+static void BM_PacketValidationLegacy(benchmark::State& state)
+{
+    vector<string> packets = makePackets(state.range(0), state.range(1), EVENTS_PER_BOARD);
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        const string& data = packets[i];
+        unsigned int packetID = (unsigned int)*(reinterpret_cast<const unsigned char*>(data.c_str() + 1));
+        const uint64_t* packet_data = reinterpret_cast<const uint64_t*>(data.c_str() + 2);
+        bool header = (packet_data[0] & 0xffffffffffffff00) == 0x123456789abcde00 && (packet_data[1] & 0xffff000000000000) == 0xac9c000000000000;
+        benchmark::DoNotOptimize(packetID);
+        benchmark::DoNotOptimize(header);
+        if(++i == packets.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PacketValidationLegacy)->Apply(eventArgs);
+
+//handing the payload on through the view's span against copying it out of the packet first
+static void BM_PacketPayload(benchmark::State& state)
+{
+    vector<string> packets = makePackets(4, PacketGenerator::EVENT_WORDS, EVENTS_PER_BOARD);
+    bool copy = state.range(0);
+    uint64_t sum = 0;
+    size_t i = 0;
+    for(auto _ : state)
+    {
+        AccPacketView packet(packets[i]);
+        if(copy)
+        {
+            string payload(packet.payloadData(), packet.payloadSize());
+            sum += payload.size() + (unsigned char)payload[payload.size()/2];
+        }
+        else
+        {
+            span<const char> payload = packet.payload();
+            sum += payload.size() + (unsigned char)payload[payload.size()/2];
+        }
+        benchmark::DoNotOptimize(sum);
+        if(++i == packets.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations()*packets[0].size());
+}
+BENCHMARK(BM_PacketPayload)->ArgName("copy")->Arg(0)->Arg(1);
+
+//validation and reassembly of every packet, as save() does, events are complete and in order
+static void BM_AssembleEvents(benchmark::State& state)
+{
+    vector<string> packets = makePackets(state.range(0), state.range(1), EVENTS_PER_BOARD);
+    vector<int> boards;
+    for(int i = 0; i < state.range(0); ++i) boards.push_back(i);
+    EventAssembler assembler;
+    assembler.setBoards(boards);
+
+    uint64_t nComplete = 0;
+    for(auto _ : state)
+    {
+        for(const string& data : packets)
+        {
+            AccPacketView packet(data);
+            if(assembler.addPacket(packet) == EventAssembler::EVENT_COMPLETE) ++nComplete;
+        }
+        benchmark::DoNotOptimize(nComplete);
+    }
+    if(nComplete != state.iterations()*(uint64_t)boards.size()*EVENTS_PER_BOARD) state.SkipWithError("events lost in reassembly");
+    state.SetItemsProcessed(state.iterations()*boards.size()*EVENTS_PER_BOARD);
+    state.SetBytesProcessed(state.iterations()*totalBytes(packets));
+}
+BENCHMARK(BM_AssembleEvents)->Apply(eventArgs);
@@ -0,0 +1,187 @@
+#include "otsdaq-acc/ACC/RingBuffer.h"
+
+#include <benchmark/benchmark.h>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+//The ring buffers replaced BlockingQueue between the receiving thread and
+//the workers; these cover their push/pop cost with and without contention,
+//their throughput and their latency against a queue built like
+//BlockingQueue (std::queue under a mutex, condition variable wake-ups).
+
+namespace
+{
+//BlockingQueue as it was, with predicate waits and a moving pop so it can be measured safely
+template<typename T>
+class LockedQueue
+{
+public:
+    void push(T&& value)
+    {
+        unique_lock<mutex> lock(mut_);
+        queue_.push(std::move(value));
+        block_.notify_all();
+    }
+
+    void popWait(T& value)
+    {
+        unique_lock<mutex> lock(mut_);
+        block_.wait(lock, [this] { return !queue_.empty(); });
+        value = std::move(queue_.front());
+        queue_.pop();
+    }
+
+private:
+    queue<T> queue_;
+    mutex mut_;
+    condition_variable block_;
+};
+}
+
+//push and pop on one thread, no contention
+static void BM_SPSCPushPop(benchmark::State& state)
+{
+    SPSCRingBuffer<uint64_t> ring(1024);
+    uint64_t value = 0;
+    for(auto _ : state)
+    {
+        ring.push(std::move(value));
+        ring.pop(value);
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SPSCPushPop);
+
+//a producer thread streaming events (moved strings) to the benchmark thread, arg: event bytes
+static void BM_SPSCStream(benchmark::State& state)
+{
+    SPSCRingBuffer<string> ring(256, YIELD_WAIT);
+    string event(state.range(0), 'x');
+    thread producer([&]
+    {
+        string e = event;
+        while(ring.pushWait(std::move(e))) e = event;
+    });
+
+    string received;
+    for(auto _ : state)
+    {
+        ring.popWait(received);
+        benchmark::DoNotOptimize(received.data());
+    }
+    ring.close();
+    producer.join();
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_SPSCStream)->Arg(64)->Arg(12328)->UseRealTime();
+
+//every benchmark thread pushes and pops on one shared ring
+static void BM_MPMCPushPop(benchmark::State& state)
+{
+    static MPMCRingBuffer<uint64_t> ring(4096);
+    uint64_t value = state.thread_index();
+    for(auto _ : state)
+    {
+        ring.push(std::move(value));
+        ring.pop(value);
+        benchmark::DoNotOptimize(value);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MPMCPushPop)->ThreadRange(1, 8)->UseRealTime();
+
+//BM_SPSCStream through the BlockingQueue scheme
+static void BM_LockedQueueStream(benchmark::State& state)
+{
+    LockedQueue<string> queue;
+    atomic<bool> stop(false);
+    atomic<int> inFlight(0);
+    string event(state.range(0), 'x');
+    thread producer([&]
+    {
+        //bounded like the ring, BlockingQueue itself grew without limit
+        while(!stop)
+        {
+            if(inFlight.load(memory_order_acquire) >= 256)
+            {
+                this_thread::yield();
+                continue;
+            }
+            string e = event;
+            ++inFlight;
+            queue.push(std::move(e));
+        }
+    });
+
+    string received;
+    for(auto _ : state)
+    {
+        queue.popWait(received);
+        --inFlight;
+        benchmark::DoNotOptimize(received.data());
+    }
+    stop = true;
+    producer.join();
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_LockedQueueStream)->Arg(64)->Arg(12328)->UseRealTime();
+
+//round trip latency: a value goes to an echo thread and back, arg: wait strategy
+static void BM_SPSCPingPong(benchmark::State& state)
+{
+    RingWaitStrategy strategy = (RingWaitStrategy)state.range(0);
+    SPSCRingBuffer<uint64_t> ping(16, strategy), pong(16, strategy);
+    thread echo([&]
+    {
+        uint64_t value;
+        while(ping.popWait(value)) pong.pushWait(std::move(value));
+    });
+
+    uint64_t value = 0;
+    for(auto _ : state)
+    {
+        ping.pushWait(std::move(value));
+        pong.popWait(value);
+        ++value;
+    }
+    ping.close();
+    echo.join();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SPSCPingPong)->ArgName("strategy")->Arg(YIELD_WAIT)->Arg(BLOCK_WAIT)->UseRealTime();
+
+//BM_SPSCPingPong through the BlockingQueue scheme
+static void BM_LockedQueuePingPong(benchmark::State& state)
+{
+    LockedQueue<uint64_t> ping, pong;
+    thread echo([&]
+    {
+        uint64_t value;
+        while(true)
+        {
+            ping.popWait(value);
+            if(value == ~uint64_t(0)) break;
+            pong.push(std::move(value));
+        }
+    });
+
+    uint64_t value = 0;
+    for(auto _ : state)
+    {
+        ping.push(std::move(value));
+        pong.popWait(value);
+        ++value;
+    }
+    ping.push(~uint64_t(0));
+    echo.join();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LockedQueuePingPong)->UseRealTime();
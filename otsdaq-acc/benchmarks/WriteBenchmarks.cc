@@ -0,0 +1,51 @@
+#include "BenchmarkData.h"
+#include "otsdaq-acc/ACC/AsyncFileWriter.h"
+
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <unistd.h>
+
+using namespace std;
+
+//The file write path of ACCBurstDataSaverConsumer: whole events copied
+//into AsyncFileWriter's buffer ring, one file per board. The files go to
+//$ACC_BENCHMARK_DIR (default /tmp) and are removed afterwards. Close is
+//timed as well, so the rate includes getting the data to the kernel.
+static void BM_WriteEvents(benchmark::State& state)
+{
+    int nBoards = state.range(0);
+    vector<vector<uint64_t>> events = makeEvents(nBoards, state.range(1));
+    const char* directory = getenv("ACC_BENCHMARK_DIR");
+    string prefix = string(directory ? directory : "/tmp") + "/acc_benchmark_" + to_string(getpid()) + "_";
+    const int eventsPerFile = 2048;
+
+    uint64_t bytes = 0;
+    for(auto _ : state)
+    {
+        vector<unique_ptr<AsyncFileWriter>> files;
+        for(int i = 0; i < nBoards; ++i)
+        {
+            files.emplace_back(new AsyncFileWriter());
+            if(!files.back()->open(prefix + to_string(i) + "_Raw.dat"))
+            {
+                state.SkipWithError("can't open the output file");
+                return;
+            }
+        }
+        for(int n = 0; n < eventsPerFile; ++n)
+        {
+            for(int i = 0; i < nBoards; ++i) files[i]->write(events[i].data(), events[i].size()*sizeof(uint64_t));
+        }
+        for(unique_ptr<AsyncFileWriter>& file : files)
+        {
+            file->close();
+            bytes += file->getStats().bytesWritten;
+        }
+    }
+    for(int i = 0; i < nBoards; ++i) remove((prefix + to_string(i) + "_Raw.dat").c_str());
+    state.SetItemsProcessed(state.iterations()*eventsPerFile*nBoards);
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_WriteEvents)->ArgNames({"boards", "words"})
+    ->Args({1, (int)PacketGenerator::EVENT_WORDS})->Args({4, (int)PacketGenerator::EVENT_WORDS})->Args({4, 386})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+"""Compares a Google Benchmark JSON result against a stored baseline.
+
+A benchmark regresses if its wall time per iteration (in ns) grew by more than the
+threshold (relative). Benchmarks missing on either side are listed but do
+not fail the comparison. Exits with 1 if anything regressed.
+
+    compare_benchmarks.py baseline.json current.json [--threshold 0.10]
+"""
+
+import argparse
+import json
+import sys
+
+UNITS = {"ns": 1.0, "us": 1e3, "ms": 1e6, "s": 1e9}
+
+
+def load(fileName):
+    with open(fileName) as f:
+        results = json.load(f)
+    times = {}
+    for b in results.get("benchmarks", []):
+        # with repetitions only the median is compared
+        if b.get("run_type") == "aggregate" and b.get("aggregate_name") != "median":
+            continue
+        if "error_occurred" in b and b["error_occurred"]:
+            continue
+        name = b.get("run_name", b["name"])
+        times[name] = b["real_time"]*UNITS[b.get("time_unit", "ns")]
+    return results.get("context", {}), times
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.10, help="allowed relative slowdown (default 0.10)")
+    args = parser.parse_args()
+
+    baselineContext, baseline = load(args.baseline)
+    currentContext, current = load(args.current)
+    if baselineContext.get("host_name") != currentContext.get("host_name"):
+        print("warning: baseline from %s, current run on %s" % (baselineContext.get("host_name"), currentContext.get("host_name")))
+
+    regressions = []
+    width = max([len(name) for name in current] + [10])
+    print("%-*s %14s %14s %8s" % (width, "benchmark", "baseline ns", "current ns", "change"))
+    for name in sorted(set(baseline) | set(current)):
+        if name not in baseline or name not in current:
+            print("%-*s %s" % (width, name, "only in the baseline" if name in baseline else "new, not in the baseline"))
+            continue
+        change = current[name]/baseline[name] - 1 if baseline[name] > 0 else 0
+        flag = ""
+        if change > args.threshold:
+            regressions.append(name)
+            flag = "  REGRESSION"
+        print("%-*s %14.1f %14.1f %+7.1f%%%s" % (width, name, baseline[name], current[name], 100*change, flag))
+
+    if regressions:
+        print("%d of %d benchmarks slower than the baseline by more than %.0f%%" % (len(regressions), len(current), 100*args.threshold))
+        return 1
+    print("no regressions above %.0f%%" % (100*args.threshold))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
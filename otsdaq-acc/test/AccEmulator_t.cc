@@ -0,0 +1,150 @@
+#include "AccTest.h"
+#include "otsdaq-acc/Emulator/AccEmulator.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+//Talks to the emulator the way FEACCInterface::commitWrites does: the
+//coalesced write datagrams are sent back to back and only the last one
+//waits for an acknowledgement, which has to arrive well within the
+//OtsUDPHardware timeout. Every write datagram is acknowledged; reads skip
+//the acknowledgements still queued and see the effect of the writes.
+
+namespace
+{
+const int TIMEOUT_MS = 1000;
+
+class Client
+{
+public:
+    Client(uint16_t port) : socket_(socket(AF_INET, SOCK_DGRAM, 0))
+    {
+        memset(&address_, 0, sizeof(address_));
+        address_.sin_family = AF_INET;
+        address_.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address_.sin_port = htons(port);
+    }
+    ~Client() {close(socket_);}
+
+    //one command per datagram, consecutive writes to one address with NO_ADDR_INC, to consecutive addresses incrementing
+    bool commitWrites(const vector<pair<uint64_t, uint64_t>>& writes)
+    {
+        size_t i = 0;
+        while(i < writes.size())
+        {
+            uint64_t address = writes[i].first;
+            bool sameAddress = i + 1 < writes.size() && writes[i + 1].first == address;
+            vector<uint64_t> data = {writes[i].second};
+            size_t j = i + 1;
+            while(j < writes.size() && data.size() < 255 && writes[j].first == (sameAddress ? address : address + data.size())) data.push_back(writes[j++].second);
+            i = j;
+
+            send(data.size() > 1 && sameAddress ? 0x09 : 0x01, address, data);
+            ++nWriteDatagrams;
+            //writeAndAcknowledge
+            if(i == writes.size() && !receiveAck()) return false;
+        }
+        return true;
+    }
+
+    bool read(uint64_t address, uint64_t& value)
+    {
+        send(0x00, address, vector<uint64_t>(1, 0));
+        string reply;
+        while(receive(reply) && isAck(reply)) ++nAcks;
+        if(reply.size() != 2 + sizeof(uint64_t) || (reply[0] & 0x01)) return false;
+        memcpy(&value, reply.data() + 2, sizeof(value));
+        return true;
+    }
+
+    bool receiveAck()
+    {
+        string ack;
+        if(!receive(ack) || !isAck(ack)) return false;
+        ++nAcks;
+        return true;
+    }
+
+    int nWriteDatagrams = 0;
+    int nAcks = 0;
+
+private:
+    static bool isAck(const string& datagram) {return datagram.size() == 2 && (datagram[0] & 0x01);}
+
+    void send(uint8_t type, uint64_t address, const vector<uint64_t>& data)
+    {
+        string datagram(2 + sizeof(uint64_t), '\0');
+        datagram[0] = type;
+        datagram[1] = data.size();
+        memcpy(&datagram[2], &address, sizeof(address));
+        if(type & 0x01) datagram.append((const char*)data.data(), data.size()*sizeof(uint64_t));
+        sendto(socket_, datagram.data(), datagram.size(), 0, (const sockaddr*)&address_, sizeof(address_));
+    }
+
+    bool receive(string& datagram, int timeoutMs = TIMEOUT_MS)
+    {
+        pollfd fd = {socket_, POLLIN, 0};
+        if(poll(&fd, 1, timeoutMs) <= 0) return false;
+        char buffer[65536];
+        ssize_t size = recv(socket_, buffer, sizeof(buffer), 0);
+        if(size < 0) return false;
+        datagram.assign(buffer, size);
+        return true;
+    }
+
+    int socket_;
+    sockaddr_in address_;
+};
+} //namespace
+
+int main()
+{
+    AccEmulator::Options options;
+    options.controlPort = 20000 + getpid()%20000;
+    options.dataPort = options.controlPort + 1;
+    options.eventRate = 0;
+    AccEmulator emulator;
+    ACC_CHECK(emulator.start(options));
+    if(!emulator.isRunning()) return ACC_TEST_RESULT();
+
+    Client client(options.controlPort);
+
+    //a configure-like transaction: clear the FIFOs, trigger modes of 8 boards, two info frame requests to board 0
+    vector<pair<uint64_t, uint64_t>> writes = {{0x0002, 0xff}};
+    for(uint64_t board = 0; board < 8; ++board) writes.emplace_back(0x0030 + board, 1);
+    writes.emplace_back(0x0100, 0x01D00000);
+    writes.emplace_back(0x0100, 0x01D00001);
+    writes.emplace_back(0x0023, 1);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int transaction = 0; transaction < 20; ++transaction)
+    {
+        ACC_CHECK(client.commitWrites(writes));
+        uint64_t fifoWords = 0;
+        ACC_CHECK(client.read(0x1138, fifoWords));
+        ACC_CHECK(fifoWords == 2*AccEmulator::INFO_FRAME_WORDS);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    ACC_CHECK(seconds < 20*TIMEOUT_MS/1000.0);
+
+    //the acknowledgements not waited for are all there
+    while(client.nAcks < client.nWriteDatagrams && client.receiveAck()) {}
+    ACC_CHECK(client.nWriteDatagrams == 20*4);
+    ACC_CHECK(client.nAcks == client.nWriteDatagrams);
+
+    AccEmulator::Stats stats = emulator.getStats();
+    ACC_CHECK(stats.nWrites == 20*4);
+    ACC_CHECK(stats.nReads == 20);
+    emulator.stop();
+
+    return ACC_TEST_RESULT();
+}
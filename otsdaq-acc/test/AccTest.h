@@ -0,0 +1,29 @@
+#ifndef _ACCTEST_H_INCLUDED
+#define _ACCTEST_H_INCLUDED
+
+#include <iostream>
+
+//Minimal checks for the cet_test executables: a failed check prints its
+//location and makes the test return a non-zero exit code.
+namespace acctest
+{
+inline int& failures()
+{
+    static int n = 0;
+    return n;
+}
+}
+
+#define ACC_CHECK(cond)                                                                            \
+    do                                                                                             \
+    {                                                                                              \
+        if(!(cond))                                                                                \
+        {                                                                                          \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #cond << std::endl;    \
+            ++acctest::failures();                                                                 \
+        }                                                                                          \
+    } while(0)
+
+#define ACC_TEST_RESULT() (acctest::failures() == 0 ? 0 : 1)
+
+#endif
@@ -0,0 +1,51 @@
+#include "AccTest.h"
+#include "otsdaq-acc/ACC/ACDC.h"
+#include "otsdaq-acc/ACC/DQMHistograms.h"
+#include "otsdaq-acc/ACC/PacketGenerator.h"
+
+#include <cmath>
+#include <memory>
+
+using namespace std;
+
+//Monitoring of pulse free events as the ACC sends them: no channel has
+//hits, channel 28 (32 samples in the event) is marked partial with its
+//real pedestal, channel 29 (not sent) is marked absent and left empty.
+
+int main()
+{
+    PacketGenerator::Options options;
+    options.pulseProbability = 0;
+    PacketGenerator generator;
+    generator.setOptions(options);
+
+    unique_ptr<ACDC> acdc(new ACDC(0));
+    unique_ptr<DQMAccumulator> accumulator(new DQMAccumulator());
+    unique_ptr<DQMSnapshot::Board> board(new DQMSnapshot::Board());
+    accumulator->fill(*board);
+    ACC_CHECK(board->channels[0].status == DQMSnapshot::CHANNEL_NOT_ANALYSED);
+
+    const int N_EVENTS = 50;
+    for(int i = 0; i < N_EVENTS; ++i)
+    {
+        span<const uint64_t> event = generator.makeEvent(0);
+        accumulator->addEvent(event.size_bytes());
+        ACC_CHECK(acdc->parseDataFromBuffer(event) == 0);
+        accumulator->addWaveforms(acdc->getWaveforms(), acdc->getNumSamples());
+    }
+    accumulator->fill(*board);
+
+    ACC_CHECK(board->nAnalysed == N_EVENTS);
+    for(int ch = 0; ch < NUM_CH; ++ch)
+    {
+        const DQMSnapshot::Channel& channel = board->channels[ch];
+        ACC_CHECK(channel.nHits == 0);
+        if(ch < 29) ACC_CHECK(channel.nAnalysed == N_EVENTS && fabs(channel.pedestalMean - options.pedestal) < 5 && channel.meanAmplitude < 20);
+    }
+    ACC_CHECK(board->channels[0].status == DQMSnapshot::CHANNEL_COMPLETE && board->channels[0].nSamples == NUM_SAMP);
+    ACC_CHECK(board->channels[28].status == DQMSnapshot::CHANNEL_PARTIAL && board->channels[28].nSamples == 32);
+    ACC_CHECK(board->channels[29].status == DQMSnapshot::CHANNEL_ABSENT && board->channels[29].nSamples == 0);
+    ACC_CHECK(board->channels[29].nAnalysed == 0 && board->channels[29].pedestalMean == 0 && board->channels[29].amplitude[0] == 0);
+
+    return ACC_TEST_RESULT();
+}
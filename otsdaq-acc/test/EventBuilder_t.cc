@@ -0,0 +1,76 @@
+#include "AccTest.h"
+#include "otsdaq-acc/ACC/EventBuilder.h"
+#include "otsdaq-acc/ACC/PacketGenerator.h"
+
+#include <vector>
+
+using namespace std;
+
+//The builder keys fragments on the event counter (word 1, bits 31-0) and
+//the timestamp (word 2) of the ACDC header, see AccEventFormat. Checks
+//that layout on generated events and the matching on top of it.
+
+namespace
+{
+vector<uint64_t> fragment(uint32_t eventCount, uint64_t timestamp)
+{
+    vector<uint64_t> event(AccEventFormat::EVENT_WORDS, 0);
+    event[0] = AccPacketView::EVENT_MAGIC;
+    event[AccEventFormat::EVENT_COUNT_WORD] = AccPacketView::ACDC_HEADER | eventCount;
+    event[AccEventFormat::TIMESTAMP_WORD] = timestamp;
+    event[AccEventFormat::HEADER_END_WORD] = AccEventFormat::HEADER_END_MARKER;
+    return event;
+}
+}
+
+int main()
+{
+    //the key of a generated event is where the header layout puts it
+    PacketGenerator generator;
+    span<const uint64_t> generated = generator.makeEvent(0);
+    uint32_t eventCount = 0;
+    uint64_t timestamp = 0;
+    ACC_CHECK(EventBuilder::extractKey(generated, eventCount, timestamp));
+    ACC_CHECK(eventCount == 1);
+    ACC_CHECK(timestamp == generator.getOptions().timestampStep);
+
+    //no ACDC header marker or too short: not a fragment
+    vector<uint64_t> bad = fragment(1, 100);
+    bad[AccEventFormat::EVENT_COUNT_WORD] &= 0xffffffff;
+    ACC_CHECK(!EventBuilder::extractKey(bad, eventCount, timestamp));
+    ACC_CHECK(!EventBuilder::extractKey(span<const uint64_t>(generated.data(), 3), eventCount, timestamp));
+
+    vector<EventBuilder::BuiltEvent> built;
+    EventBuilder builder;
+    builder.setCallback([&](const EventBuilder::BuiltEvent& event) {built.push_back(event);});
+
+    EventBuilder::Options options;
+    options.timestampTolerance = 2;
+    options.reorderDepth = 4;
+    options.timeout = chrono::seconds(100);
+    builder.start(3, options);
+
+    //boards out of order and with timestamps within the tolerance build one event
+    ACC_CHECK(builder.add(2, fragment(7, 1000)));
+    ACC_CHECK(builder.add(0, fragment(8, 2000)));
+    ACC_CHECK(builder.add(0, fragment(7, 1001)));
+    ACC_CHECK(builder.add(1, fragment(7, 999)));
+    ACC_CHECK(built.size() == 1);
+    ACC_CHECK(built.size() == 1 && built[0].complete && built[0].eventCount == 7 && built[0].boardMask == 0x7);
+
+    //same counter but a timestamp outside the tolerance, or the same timestamp with another counter, is another event
+    ACC_CHECK(builder.add(1, fragment(8, 2003)));
+    ACC_CHECK(builder.add(2, fragment(9, 2000)));
+    ACC_CHECK(built.size() == 1);
+    ACC_CHECK(builder.getNumOpen() == 3);
+
+    ACC_CHECK(!builder.add(1, bad));
+    ACC_CHECK(builder.getStats().nBadFragments == 1);
+
+    builder.flush();
+    ACC_CHECK(built.size() == 4);
+    ACC_CHECK(builder.getStats().nComplete == 1);
+    ACC_CHECK(builder.getStats().nTimedOut == 3);
+
+    return ACC_TEST_RESULT();
+}
@@ -0,0 +1,56 @@
+#include "AccTest.h"
+#include "otsdaq-acc/ACC/ACDC.h"
+#include "otsdaq-acc/ACC/FeatureExtractor.h"
+#include "otsdaq-acc/ACC/PacketGenerator.h"
+#include "otsdaq-acc/ACC/SampleUnpacker.h"
+
+#include <memory>
+
+using namespace std;
+
+//Hits of events as the ACC sends them (1445 words, channel 28 partly and
+//channel 29 not read out): pulse free events give no hits at all, the
+//zero filled rest of the waveforms must not look like a pulse, and the
+//hits of events with pulses stay within the samples present.
+
+namespace
+{
+int extractHits(double pulseProbability, vector<ChannelHit>& hits)
+{
+    PacketGenerator::Options options;
+    options.pulseProbability = pulseProbability;
+    PacketGenerator generator;
+    generator.setOptions(options);
+
+    unique_ptr<ACDC> acdc(new ACDC(0));
+    unique_ptr<FeatureExtractor> extractor(new FeatureExtractor());
+    hits.clear();
+    for(int i = 0; i < 100; ++i)
+    {
+        span<const uint64_t> event = generator.makeEvent(0);
+        ACC_CHECK(event.size() == AccEventFormat::EVENT_WORDS);
+        ACC_CHECK(acdc->parseDataFromBuffer(event) == 0);
+        ACC_CHECK(acdc->getNumSamples() == (int)(AccEventFormat::SAMPLE_WORDS*SampleUnpacker::SAMPLES_PER_WORD));
+        extractor->extract(acdc->getWaveforms(), 0, i, hits, acdc->getNumSamples());
+    }
+    return hits.size();
+}
+} //namespace
+
+int main()
+{
+    vector<ChannelHit> hits;
+    ACC_CHECK(extractHits(0, hits) == 0);
+
+    //channel 28 holds 7200 - 28*256 = 32 samples
+    const int nPartial = AccEventFormat::SAMPLE_WORDS*SampleUnpacker::SAMPLES_PER_WORD - 28*NUM_SAMP;
+    ACC_CHECK(extractHits(1, hits) > 0);
+    for(const ChannelHit& hit : hits)
+    {
+        ACC_CHECK(hit.channel < 29);
+        ACC_CHECK(hit.channel < 28 || hit.peakSample < nPartial);
+        ACC_CHECK(hit.amplitude < 4096);
+    }
+
+    return ACC_TEST_RESULT();
+}
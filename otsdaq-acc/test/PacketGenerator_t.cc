@@ -0,0 +1,79 @@
+#include "AccTest.h"
+#include "otsdaq-acc/ACC/EventAssembler.h"
+#include "otsdaq-acc/ACC/PacketGenerator.h"
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//A generated burst has to come out of the EventAssembler as complete
+//events of the size the ACC sends, identical to what was generated.
+
+int main()
+{
+    PacketGenerator::Options options;
+    options.boards = {0, 2, 5};
+    PacketGenerator generator;
+    generator.setOptions(options);
+
+    EventAssembler assembler;
+    assembler.setBoards(options.boards);
+
+    vector<string> packets;
+    int nComplete = 0;
+    for(int event = 0; event < 100; ++event)
+    {
+        for(int slot = 0; slot < (int)options.boards.size(); ++slot)
+        {
+            span<const uint64_t> generated = generator.makeEvent(options.boards[slot]);
+            ACC_CHECK(generated.size() == AccEventFormat::EVENT_WORDS);
+            generator.packetize(generated, packets);
+            ACC_CHECK(packets.size() == (size_t)AccEventFormat::PACKETS_PER_EVENT);
+
+            for(size_t i = 0; i < packets.size(); ++i)
+            {
+                EventAssembler::Status status = assembler.addPacket(packets[i].data(), packets[i].size());
+                if(i + 1 < packets.size())
+                {
+                    ACC_CHECK(status == EventAssembler::PACKET_ACCEPTED);
+                    continue;
+                }
+                ACC_CHECK(status == EventAssembler::EVENT_COMPLETE);
+                ACC_CHECK(assembler.completedSlot() == slot);
+                if(status != EventAssembler::EVENT_COMPLETE || assembler.completedSlot() != slot) continue;
+
+                ++nComplete;
+                span<const uint64_t> assembled = assembler.eventWords(slot);
+                ACC_CHECK(assembler.eventSize(slot) == AccEventFormat::EVENT_WORDS*sizeof(uint64_t));
+                ACC_CHECK(assembled.size() == generated.size() && equal(assembled.begin(), assembled.end(), generated.begin()));
+            }
+        }
+    }
+    ACC_CHECK(nComplete == 300);
+    ACC_CHECK(assembler.getNLostPackets() == 0);
+    ACC_CHECK(assembler.getNDroppedEvents() == 0);
+
+    //with every 50th packet lost the assembler sees each gap and drops exactly the hit events,
+    //the last packets are intact so the last gap is seen too
+    options.lossEvery = 50;
+    generator.setOptions(options);
+    assembler.reset();
+    nComplete = 0;
+    for(int event = 0; event < 101; ++event)
+    {
+        for(int board : options.boards)
+        {
+            generator.makeEventPackets(board, packets);
+            for(const string& packet : packets)
+            {
+                if(assembler.addPacket(packet.data(), packet.size()) == EventAssembler::EVENT_COMPLETE) ++nComplete;
+            }
+        }
+    }
+    ACC_CHECK(assembler.getNLostPackets() == generator.getStats().nLost);
+    ACC_CHECK(generator.getStats().nLost == 48);
+    ACC_CHECK(nComplete == 303 - (int)generator.getStats().nLost);
+
+    return ACC_TEST_RESULT();
+}
@@ -0,0 +1,61 @@
+#include "AccTest.h"
+#include "otsdaq-acc/ACC/PedestalCalculator.h"
+
+#include <cmath>
+#include <filesystem>
+#include <memory>
+#include <unistd.h>
+
+using namespace std;
+
+//Pedestals computed from known waveforms, saved the way the data saver
+//does at the end of a run and read back: the file has to give the same
+//board, event count, means and RMS values. A truncated file is rejected.
+
+int main()
+{
+    string dir = (filesystem::temp_directory_path() / ("PedestalCalculator_t." + to_string(getpid()))).string();
+    filesystem::create_directories(dir);
+    string fileName = dir + "/acc_board_Run1_Pedestals.dat";
+
+    //every capacitor alternates between pedestal - 1 and pedestal + 1, pedestal = 1000 + channel + capacitor
+    unique_ptr<Waveforms> waveforms(new Waveforms());
+    unique_ptr<PedestalCalculator> calculator(new PedestalCalculator());
+    const int N_EVENTS = 100;
+    for(int event = 0; event < N_EVENTS; ++event)
+    {
+        for(int ch = 0; ch < NUM_CH; ++ch)
+        {
+            for(int cap = 0; cap < NUM_SAMP; ++cap) waveforms->samples[ch][cap] = 1000 + ch + cap + (event % 2 ? 1 : -1);
+        }
+        calculator->add(*waveforms);
+    }
+
+    unique_ptr<PedestalCalibration> saved(new PedestalCalibration());
+    calculator->getCalibration(*saved);
+    saved->boardIndex = 3;
+    ACC_CHECK(saved->nEvents == N_EVENTS);
+    ACC_CHECK(saved->mean[7][100] == 1107);
+    ACC_CHECK(fabs(saved->rms[7][100] - sqrt(N_EVENTS/(N_EVENTS - 1.0))) < 1e-5);
+    ACC_CHECK(saved->save(fileName));
+
+    unique_ptr<PedestalCalibration> loaded(new PedestalCalibration());
+    ACC_CHECK(loaded->load(fileName));
+    ACC_CHECK(loaded->boardIndex == 3);
+    ACC_CHECK(loaded->nEvents == N_EVENTS);
+    for(int ch = 0; ch < NUM_CH; ++ch)
+    {
+        for(int cap = 0; cap < NUM_SAMP; ++cap)
+        {
+            ACC_CHECK(loaded->mean[ch][cap] == saved->mean[ch][cap]);
+            ACC_CHECK(loaded->rms[ch][cap] == saved->rms[ch][cap]);
+        }
+    }
+
+    filesystem::resize_file(fileName, filesystem::file_size(fileName) - 4);
+    ACC_CHECK(!loaded->load(fileName));
+    ACC_CHECK(!loaded->load(dir + "/missing_Pedestals.dat"));
+
+    filesystem::remove_all(dir);
+    return ACC_TEST_RESULT();
+}
@@ -0,0 +1,140 @@
+#include "AccTest.h"
+#include "otsdaq-acc/ACC/RingBuffer.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//Stress test of the ring buffers with move-only elements, meant to be run
+//under ThreadSanitizer as well (ACC_TEST_TSAN). Every value pushed has to
+//come out exactly once, and threads blocked in pushWait()/popWait() have
+//to return once the ring is closed.
+
+namespace
+{
+const int N_PER_PRODUCER = 200000;
+
+//runs f on its own thread and fails the test (without hanging it) if f does not return in time
+template<typename F>
+void withDeadline(const char* what, F f)
+{
+    packaged_task<void()> task(f);
+    future<void> done = task.get_future();
+    thread runner(std::move(task));
+    if(done.wait_for(chrono::seconds(60)) != future_status::ready)
+    {
+        cerr << what << " did not finish, a blocked thread was never woken" << endl;
+        _Exit(1);
+    }
+    runner.join();
+}
+
+template<typename Ring>
+void stress(Ring& ring, int nProducers, int nConsumers)
+{
+    vector<uint64_t> sums(nConsumers, 0), counts(nConsumers, 0);
+    vector<thread> consumers;
+    for(int c = 0; c < nConsumers; ++c)
+    {
+        consumers.emplace_back([&, c]
+        {
+            unique_ptr<uint64_t> value;
+            while(ring.popWait(value))
+            {
+                sums[c] += *value;
+                ++counts[c];
+            }
+        });
+    }
+
+    vector<thread> producers;
+    for(int p = 0; p < nProducers; ++p)
+    {
+        producers.emplace_back([&, p]
+        {
+            for(int i = 0; i < N_PER_PRODUCER; ++i)
+            {
+                uint64_t v = (uint64_t)p*N_PER_PRODUCER + i + 1;
+                ACC_CHECK(ring.pushWait(make_unique<uint64_t>(v)));
+            }
+        });
+    }
+    for(thread& t : producers) t.join();
+    ring.close(); //the consumers drain the ring, then popWait fails
+    for(thread& t : consumers) t.join();
+
+    uint64_t n = (uint64_t)nProducers*N_PER_PRODUCER, sum = 0, count = 0;
+    for(int c = 0; c < nConsumers; ++c)
+    {
+        sum += sums[c];
+        count += counts[c];
+    }
+    ACC_CHECK(count == n);
+    ACC_CHECK(sum == n*(n + 1)/2);
+    ACC_CHECK(ring.empty());
+}
+
+//close() has to wake a consumer sleeping on an empty ring and a producer sleeping on a full one
+template<typename Ring>
+void closeWakesWaiters()
+{
+    Ring empty(4, BLOCK_WAIT);
+    thread consumer([&]
+    {
+        unique_ptr<uint64_t> value;
+        ACC_CHECK(!empty.popWait(value));
+    });
+    this_thread::sleep_for(chrono::milliseconds(50)); //past the spin and yield phases, asleep
+    empty.close();
+    consumer.join();
+
+    Ring full(4, BLOCK_WAIT);
+    while(full.push(make_unique<uint64_t>(1))) {}
+    thread producer([&] {ACC_CHECK(!full.pushWait(make_unique<uint64_t>(2)));});
+    this_thread::sleep_for(chrono::milliseconds(50));
+    full.close();
+    producer.join();
+}
+}
+
+int main()
+{
+    for(RingWaitStrategy strategy : {SPIN_WAIT, YIELD_WAIT, BLOCK_WAIT})
+    {
+        //spinning threads never give up their core, only meaningful with a core per thread
+        if(strategy == SPIN_WAIT && thread::hardware_concurrency() < 8)
+        {
+            cout << "fewer than 8 cores, spin waiting skipped" << endl;
+            continue;
+        }
+        withDeadline("SPSC stress", [&]
+        {
+            SPSCRingBuffer<unique_ptr<uint64_t>> ring(64, strategy);
+            stress(ring, 1, 1);
+        });
+        withDeadline("MPMC stress", [&]
+        {
+            MPMCRingBuffer<unique_ptr<uint64_t>> ring(64, strategy);
+            stress(ring, 4, 4);
+        });
+    }
+
+    withDeadline("SPSC close", closeWakesWaiters<SPSCRingBuffer<unique_ptr<uint64_t>>>);
+    withDeadline("MPMC close", closeWakesWaiters<MPMCRingBuffer<unique_ptr<uint64_t>>>);
+
+    //batches
+    SPSCRingBuffer<unique_ptr<uint64_t>> ring(8);
+    unique_ptr<uint64_t> values[16];
+    for(int i = 0; i < 16; ++i) values[i] = make_unique<uint64_t>(i);
+    ACC_CHECK(ring.pushBatch(values, 16) == 8);
+    unique_ptr<uint64_t> out[16];
+    ACC_CHECK(ring.popBatch(out, 16) == 8);
+    for(int i = 0; i < 8; ++i) ACC_CHECK(out[i] && *out[i] == (uint64_t)i);
+
+    return ACC_TEST_RESULT();
+}
@@ -0,0 +1,122 @@
+#include "AccTest.h"
+#include "otsdaq-acc/ACC/AsyncFileWriter.h"
+#include "otsdaq-acc/ACC/Crc32c.h"
+#include "otsdaq-acc/ACC/PacketGenerator.h"
+#include "otsdaq-acc/Reader/RunReader.h"
+
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+using namespace std;
+
+//Reads back indexed run files, also with a damaged trailer or index
+//(they are recovered from the records instead of read out of bounds) and
+//with an empty subrun file in the run (skipped).
+
+namespace
+{
+const int N_EVENTS = 10;
+
+string writeRun(const string& fileName, PacketGenerator& generator)
+{
+    AsyncFileWriter out;
+    ACC_CHECK(out.open(fileName));
+    RunFileWriter writer(out);
+    writer.begin(RunFileWriter::Info());
+    for(int i = 0; i < N_EVENTS; ++i)
+    {
+        span<const uint64_t> event = generator.makeEvent(0);
+        writer.writeEvent(event.data(), event.size_bytes());
+    }
+    writer.finish();
+    out.close();
+
+    ifstream in(fileName, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+void writeFile(const string& fileName, const string& content)
+{
+    ofstream out(fileName, ios::binary | ios::trunc);
+    out.write(content.data(), content.size());
+}
+
+RunFileTrailer getTrailer(const string& content)
+{
+    RunFileTrailer trailer;
+    memcpy(&trailer, content.data() + content.size() - sizeof(trailer), sizeof(trailer));
+    return trailer;
+}
+
+void setTrailer(string& content, const RunFileTrailer& trailer)
+{
+    memcpy(&content[content.size() - sizeof(trailer)], &trailer, sizeof(trailer));
+}
+
+//the file has to open and give all events, from the index or recovered from the records
+void checkFile(const string& fileName, bool recovered)
+{
+    RunFileReader file;
+    ACC_CHECK(file.open(fileName));
+    ACC_CHECK(file.isRecovered() == recovered);
+    ACC_CHECK(file.getNumEvents() == N_EVENTS);
+    for(size_t i = 0; i < file.getNumEvents(); ++i)
+    {
+        ACC_CHECK(file.verify(i));
+        ACC_CHECK(file.event(i).size() == AccEventFormat::EVENT_WORDS);
+    }
+}
+}
+
+int main()
+{
+    string dir = (filesystem::temp_directory_path() / ("RunReader_t." + to_string(getpid()))).string();
+    filesystem::create_directories(dir);
+
+    PacketGenerator generator;
+    string good = writeRun(dir + "/good.accrun", generator);
+    checkFile(dir + "/good.accrun", false);
+
+    //index offset behind the trailer, and far past the end of the file
+    for(uint64_t indexOffset : {(uint64_t)good.size() - 8, (uint64_t)good.size(), uint64_t(1) << 63})
+    {
+        string bad = good;
+        RunFileTrailer trailer = getTrailer(bad);
+        trailer.indexOffset = indexOffset;
+        setTrailer(bad, trailer);
+        writeFile(dir + "/bad.accrun", bad);
+        checkFile(dir + "/bad.accrun", true);
+    }
+
+    //index entry pointing far past the end, with a valid index CRC
+    {
+        string bad = good;
+        RunFileTrailer trailer = getTrailer(bad);
+        RunFileIndexEntry* index = reinterpret_cast<RunFileIndexEntry*>(&bad[trailer.indexOffset]);
+        index[3].offset = ~uint64_t(0) - 8;
+        trailer.indexCrc32c = crc32c(index, trailer.nEvents*sizeof(RunFileIndexEntry));
+        setTrailer(bad, trailer);
+        writeFile(dir + "/bad.accrun", bad);
+        checkFile(dir + "/bad.accrun", true);
+    }
+
+    //an empty subrun file does not stop the run
+    writeRun(dir + "/second.accrun", generator);
+    writeFile(dir + "/empty.accrun", "");
+    RunReader run;
+    ACC_CHECK(run.open({dir + "/good.accrun", dir + "/empty.accrun", dir + "/second.accrun"}));
+    ACC_CHECK(run.getNumFiles() == 2);
+    ACC_CHECK(run.getSkippedFiles().size() == 1);
+    ACC_CHECK(run.getNumEvents() == 2*N_EVENTS);
+    uint32_t expected = 1;
+    for(RunReader::Event event : run)
+    {
+        ACC_CHECK(event.words.size() == AccEventFormat::EVENT_WORDS);
+        ACC_CHECK(event.words.size() > 1 && (event.words[1] & 0xffffffff) == expected);
+        ++expected;
+    }
+
+    filesystem::remove_all(dir);
+    return ACC_TEST_RESULT();
+}
@@ -0,0 +1,69 @@
+#include "AccTest.h"
+#include "otsdaq-acc/ACC/SampleUnpacker.h"
+
+#include <random>
+#include <vector>
+
+using namespace std;
+
+//The SIMD unpackers have to agree bit for bit with a plain shift and mask
+//decode, for every block/remainder split, for unaligned input and with
+//garbage in the unused bits 63-60.
+
+namespace
+{
+void reference(const uint64_t* words, size_t nWords, uint16_t* out)
+{
+    for(size_t i = 0; i < nWords; i++)
+    {
+        for(int s = 0; s < SampleUnpacker::SAMPLES_PER_WORD; s++) out[5*i + s] = (words[i] >> (48 - 12*s)) & 0xfff;
+    }
+}
+
+void check(SampleUnpacker::Implementation impl, const vector<uint64_t>& words, size_t offset, size_t nWords)
+{
+    vector<uint16_t> expected(5*nWords + 1, 0xbeef), decoded(5*nWords + 1, 0xbeef);
+    reference(words.data() + offset, nWords, expected.data());
+
+    switch(impl)
+    {
+    case SampleUnpacker::SCALAR: SampleUnpacker::unpackScalar(words.data() + offset, nWords, decoded.data()); break;
+    case SampleUnpacker::SSE4: SampleUnpacker::unpackSSE4(words.data() + offset, nWords, decoded.data()); break;
+    case SampleUnpacker::AVX2: SampleUnpacker::unpackAVX2(words.data() + offset, nWords, decoded.data()); break;
+    default: SampleUnpacker::unpack(words.data() + offset, nWords, decoded.data()); break;
+    }
+
+    ACC_CHECK(decoded == expected); //includes the guard sample behind the output
+    if(decoded != expected) cerr << "  " << SampleUnpacker::getName(impl) << ", offset " << offset << ", " << nWords << " words" << endl;
+}
+}
+
+int main()
+{
+    mt19937_64 random(42);
+    vector<uint64_t> words(2048);
+    for(uint64_t& word : words) word = random();
+
+    for(SampleUnpacker::Implementation impl : {SampleUnpacker::SCALAR, SampleUnpacker::SSE4, SampleUnpacker::AVX2})
+    {
+        if(!SampleUnpacker::isSupported(impl))
+        {
+            cout << SampleUnpacker::getName(impl) << " not supported by this CPU, skipped" << endl;
+            continue;
+        }
+        for(size_t offset = 0; offset < 3; offset++)
+        {
+            for(size_t nWords = 0; nWords <= 40; nWords++) check(impl, words, offset, nWords);
+            check(impl, words, offset, 1440);
+            check(impl, words, offset, 1536);
+        }
+
+        //the dispatching entry point
+        ACC_CHECK(SampleUnpacker::setImplementation(impl));
+        ACC_CHECK(SampleUnpacker::getImplementation() == impl);
+        check(SampleUnpacker::AUTO, words, 1, 1536);
+    }
+    ACC_CHECK(SampleUnpacker::setImplementation(SampleUnpacker::AUTO));
+
+    return ACC_TEST_RESULT();
+}
@@ -0,0 +1,65 @@
+#include "AccTest.h"
+#include "otsdaq-acc/ACC/WaveformCalibration.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+//Loads linearity files: a complete one replaces the table, a truncated
+//one is rejected and leaves the calibration as it was. Without pedestals
+//the conversion subtracts the table value of count 0.
+
+namespace
+{
+//mV = scale*count + channel
+void writeLinearity(const string& fileName, float scale, size_t nValues)
+{
+    vector<float> table(NUM_CH*WaveformCalibration::NUM_COUNTS);
+    for(size_t i = 0; i < table.size(); ++i) table[i] = scale*(i%WaveformCalibration::NUM_COUNTS) + i/WaveformCalibration::NUM_COUNTS;
+
+    uint32_t header[6] = {0, 0, WaveformCalibration::FILE_VERSION, NUM_CH, WaveformCalibration::NUM_COUNTS, 0};
+    memcpy(header, "ACCLIN\0\0", 8);
+    ofstream out(fileName, ios::binary | ios::trunc);
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(table.data()), nValues*sizeof(float));
+}
+
+float toMV(const WaveformCalibration& calibration, int ch, unsigned short count)
+{
+    float mV;
+    calibration.toMV(&count, ch*NUM_SAMP, 1, &mV);
+    return mV;
+}
+} //namespace
+
+int main()
+{
+    string dir = (filesystem::temp_directory_path() / ("WaveformCalibration_t." + to_string(getpid()))).string();
+    filesystem::create_directories(dir);
+
+    unique_ptr<WaveformCalibration> calibration(new WaveformCalibration());
+    ACC_CHECK(toMV(*calibration, 3, 1000) == 1000*WaveformCalibration::DEFAULT_MV_PER_COUNT);
+
+    //only half of the table in the file
+    writeLinearity(dir + "/short.dat", 3, NUM_CH*WaveformCalibration::NUM_COUNTS/2);
+    ACC_CHECK(!calibration->loadLinearity(dir + "/short.dat"));
+    ACC_CHECK(!calibration->hasLinearity());
+    for(int ch : {0, 3, NUM_CH - 1}) ACC_CHECK(toMV(*calibration, ch, 1000) == 1000*WaveformCalibration::DEFAULT_MV_PER_COUNT);
+
+    writeLinearity(dir + "/full.dat", 2, NUM_CH*WaveformCalibration::NUM_COUNTS);
+    ACC_CHECK(calibration->loadLinearity(dir + "/full.dat"));
+    ACC_CHECK(calibration->hasLinearity());
+    for(int ch : {0, 3, NUM_CH - 1}) ACC_CHECK(toMV(*calibration, ch, 1000) == 2000);
+
+    //a short file after a good one keeps the good table
+    ACC_CHECK(!calibration->loadLinearity(dir + "/short.dat"));
+    for(int ch : {0, 3, NUM_CH - 1}) ACC_CHECK(toMV(*calibration, ch, 1000) == 2000);
+
+    filesystem::remove_all(dir);
+    return ACC_TEST_RESULT();
+}
@@ -0,0 +1,125 @@
+#include "AccTest.h"
+#include "otsdaq-acc/ACC/PacketGenerator.h"
+#include "otsdaq-acc/ACC/WaveformCodec.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+//encode() followed by decode() has to give back the event byte for byte,
+//for generated events, complete readouts, odd sizes and non ACDC data,
+//with and without zstd. Truncated and corrupted input has to be rejected
+//without allocating what the corrupt sizes claim.
+
+namespace
+{
+void put32(vector<char>& out, size_t pos, uint32_t value) {memcpy(out.data() + pos, &value, sizeof(value));}
+
+void roundTrip(const vector<uint64_t>& event, size_t bytes, int zstdLevel, WaveformCodec::Format expected)
+{
+    vector<char> encoded;
+    WaveformCodec::encode(event, bytes, encoded, zstdLevel);
+    ACC_CHECK(!encoded.empty());
+    ACC_CHECK(encoded[0] == expected || (expected == WaveformCodec::WAVEFORM_ZSTD && encoded[0] == WaveformCodec::WAVEFORM));
+
+    vector<uint64_t> decoded;
+    ACC_CHECK(WaveformCodec::decode(encoded, decoded) == (long)bytes);
+    ACC_CHECK(decoded.size() == (bytes + 7)/8);
+    ACC_CHECK(bytes == 0 || memcmp(decoded.data(), event.data(), bytes) == 0);
+
+    //every truncation is corrupt input
+    for(size_t size = 0; size < encoded.size(); size += 1 + size/16)
+    {
+        ACC_CHECK(WaveformCodec::decode(span<const char>(encoded.data(), size), decoded) == -1);
+    }
+}
+
+vector<uint64_t> fullReadout(mt19937_64& random)
+{
+    vector<uint64_t> event(AccEventFormat::HEADER_WORDS + AccEventFormat::FULL_SAMPLE_WORDS, 0);
+    event[0] = AccPacketView::EVENT_MAGIC;
+    event[1] = AccPacketView::ACDC_HEADER | 4;
+    event[AccEventFormat::HEADER_END_WORD] = AccEventFormat::HEADER_END_MARKER;
+    for(size_t w = AccEventFormat::HEADER_WORDS; w < event.size(); ++w)
+    {
+        for(int k = 0; k < 5; ++k) event[w] |= (0x7f0 + random() % 32) << (48 - 12*k);
+    }
+    return event;
+}
+} //namespace
+
+int main()
+{
+    vector<int> levels = {0};
+    if(WaveformCodec::hasZstd()) levels.push_back(3);
+
+    PacketGenerator generator;
+    PacketGenerator::Options options;
+    options.boards = {0, 1, 2, 3};
+    generator.setOptions(options);
+    mt19937_64 random(15);
+    for(int level : levels)
+    {
+        WaveformCodec::Format waveform = level > 0 ? WaveformCodec::WAVEFORM_ZSTD : WaveformCodec::WAVEFORM;
+        for(int i = 0; i < 10; ++i)
+        {
+            span<const uint64_t> event = generator.makeEvent(i % 4);
+            ACC_CHECK(event.size() == AccEventFormat::EVENT_WORDS);
+            roundTrip(vector<uint64_t>(event.begin(), event.end()), event.size()*8, level, waveform);
+        }
+        roundTrip(fullReadout(random), (AccEventFormat::HEADER_WORDS + AccEventFormat::FULL_SAMPLE_WORDS)*8, level, waveform);
+
+        //a short event still has a partial channel
+        vector<uint64_t> shortEvent = fullReadout(random);
+        shortEvent.resize(AccEventFormat::HEADER_WORDS + 60);
+        roundTrip(shortEvent, shortEvent.size()*8, level, waveform);
+
+        //odd sizes, unused sample bits and header only events are stored
+        vector<uint64_t> odd = fullReadout(random);
+        roundTrip(odd, odd.size()*8 - 3, level, WaveformCodec::STORED);
+        odd[AccEventFormat::HEADER_WORDS + 7] |= uint64_t(1) << 62;
+        roundTrip(odd, odd.size()*8, level, WaveformCodec::STORED);
+        roundTrip(vector<uint64_t>(AccEventFormat::HEADER_WORDS, 1), AccEventFormat::HEADER_WORDS*8, level, WaveformCodec::STORED);
+        roundTrip(vector<uint64_t>(), 0, level, WaveformCodec::STORED);
+    }
+
+    //sizes beyond the maximum or the input are rejected before allocating
+    span<const uint64_t> event = generator.makeEvent(0);
+    vector<char> encoded;
+    vector<uint64_t> decoded;
+    for(int format : {WaveformCodec::STORED, WaveformCodec::WAVEFORM, WaveformCodec::WAVEFORM_ZSTD})
+    {
+        WaveformCodec::encode(event, event.size()*8, encoded, format == WaveformCodec::WAVEFORM_ZSTD ? 3 : 0);
+        encoded[0] = format;
+        for(uint32_t bytes : {0x7fffffffu, uint32_t(WaveformCodec::MAX_EVENT_BYTES + 8), uint32_t(event.size()*8*4)})
+        {
+            vector<char> corrupt = encoded;
+            put32(corrupt, 1, bytes);
+            decoded.clear();
+            ACC_CHECK(WaveformCodec::decode(corrupt, decoded) == -1);
+            ACC_CHECK(decoded.capacity() < WaveformCodec::MAX_EVENT_BYTES/8);
+        }
+    }
+    if(WaveformCodec::hasZstd())
+    {
+        WaveformCodec::encode(event, event.size()*8, encoded, 3);
+        ACC_CHECK(encoded[0] == WaveformCodec::WAVEFORM_ZSTD);
+        vector<char> corrupt = encoded;
+        put32(corrupt, 5, 0x7fffffff);
+        ACC_CHECK(WaveformCodec::decode(corrupt, decoded) == -1);
+    }
+
+    //random damage in a waveform body must not crash the decoder
+    WaveformCodec::encode(event, event.size()*8, encoded, 0);
+    for(int i = 0; i < 1000; ++i)
+    {
+        vector<char> corrupt = encoded;
+        for(int k = 0; k < 4; ++k) corrupt[5 + random() % (corrupt.size() - 5)] = random();
+        long result = WaveformCodec::decode(corrupt, decoded);
+        ACC_CHECK(result == -1 || result == (long)event.size()*8);
+    }
+
+    return ACC_TEST_RESULT();
+}
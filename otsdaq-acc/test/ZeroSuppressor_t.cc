@@ -0,0 +1,107 @@
+#include "AccTest.h"
+#include "otsdaq-acc/ACC/ZeroSuppressor.h"
+
+#include <random>
+#include <vector>
+
+using namespace std;
+
+//suppress() followed by expand() has to give back the event word for word
+//(outside the dropped samples, which come back as the fill value), for
+//events as the ACC sends them as well as complete readouts with trailing
+//words.
+
+namespace
+{
+vector<uint64_t> makeEvent(size_t nWords, mt19937_64& random)
+{
+    vector<uint64_t> event(nWords, 0);
+    event[0] = AccPacketView::EVENT_MAGIC | 3;
+    event[1] = AccPacketView::ACDC_HEADER | 17;
+    event[2] = 123456;
+    if(nWords > 4) event[4] = 0xcac9;
+
+    //pedestal 0x800 with a little noise, a negative pulse in every third channel
+    size_t nSampleWords = min(nWords - AccEventFormat::HEADER_WORDS, AccEventFormat::FULL_SAMPLE_WORDS);
+    for(size_t w = 0; w < nSampleWords; ++w)
+    {
+        uint64_t word = 0;
+        for(int k = 0; k < 5; ++k)
+        {
+            size_t sample = 5*w + k;
+            uint64_t value = 0x800 + random() % 4;
+            if((sample/NUM_SAMP) % 3 == 0 && sample % NUM_SAMP >= 100 && sample % NUM_SAMP < 110) value = 0x500;
+            word |= value << (48 - 12*k);
+        }
+        event[AccEventFormat::HEADER_WORDS + w] = word;
+    }
+    for(size_t w = AccEventFormat::HEADER_WORDS + nSampleWords; w < nWords; ++w) event[w] = random();
+    return event;
+}
+
+void roundTrip(ZeroSuppressor::Mode mode, size_t nWords)
+{
+    mt19937_64 random(nWords);
+    vector<uint64_t> event = makeEvent(nWords, random);
+
+    ZeroSuppressor::Options options;
+    options.mode = mode;
+    ZeroSuppressor suppressor;
+    suppressor.setOptions(options);
+
+    span<const uint64_t> suppressed = suppressor.suppress(event);
+    ACC_CHECK(suppressed.data() != event.data());
+    ACC_CHECK(ZeroSuppressor::isSuppressed(suppressed));
+    ACC_CHECK(suppressed.size() < event.size());
+    ACC_CHECK(suppressor.getStats().nPassedThrough == 0);
+
+    vector<uint64_t> expanded;
+    ACC_CHECK(ZeroSuppressor::expand(suppressed, expanded));
+    ACC_CHECK(expanded.size() == event.size());
+    if(expanded.size() != event.size()) return;
+
+    //header and trailing words exact, samples exact in the kept windows and the fill value elsewhere
+    size_t nSampleWords = min(nWords - AccEventFormat::HEADER_WORDS, AccEventFormat::FULL_SAMPLE_WORDS);
+    for(size_t w = 0; w < nWords; ++w)
+    {
+        if(w < AccEventFormat::HEADER_WORDS || w >= AccEventFormat::HEADER_WORDS + nSampleWords)
+        {
+            ACC_CHECK(expanded[w] == event[w]);
+            continue;
+        }
+        for(int k = 0; k < 5; ++k)
+        {
+            size_t sample = 5*(w - AccEventFormat::HEADER_WORDS) + k;
+            uint64_t original = (event[w] >> (48 - 12*k)) & 0xfff, restored = (expanded[w] >> (48 - 12*k)) & 0xfff;
+            bool pulseChannel = (sample/NUM_SAMP) % 3 == 0;
+            bool kept = pulseChannel && (mode == ZeroSuppressor::DROP_QUIET_CHANNELS || (sample % NUM_SAMP >= 90 && sample % NUM_SAMP <= 130));
+            ACC_CHECK(restored == (kept ? original : 0x800));
+        }
+    }
+}
+}
+
+int main()
+{
+    for(ZeroSuppressor::Mode mode : {ZeroSuppressor::DROP_QUIET_CHANNELS, ZeroSuppressor::PEAK_WINDOW})
+    {
+        roundTrip(mode, AccEventFormat::EVENT_WORDS);
+        roundTrip(mode, AccEventFormat::HEADER_WORDS + AccEventFormat::FULL_SAMPLE_WORDS);
+        roundTrip(mode, AccEventFormat::HEADER_WORDS + AccEventFormat::FULL_SAMPLE_WORDS + 3);
+    }
+
+    //events without samples or ACDC header are saved unchanged and counted
+    ZeroSuppressor::Options options;
+    options.mode = ZeroSuppressor::DROP_QUIET_CHANNELS;
+    ZeroSuppressor suppressor;
+    suppressor.setOptions(options);
+    mt19937_64 random(1);
+    vector<uint64_t> headerOnly = makeEvent(AccEventFormat::HEADER_WORDS, random);
+    vector<uint64_t> noMarker = makeEvent(AccEventFormat::EVENT_WORDS, random);
+    noMarker[4] = 0;
+    ACC_CHECK(suppressor.suppress(headerOnly).data() == headerOnly.data());
+    ACC_CHECK(suppressor.suppress(noMarker).data() == noMarker.data());
+    ACC_CHECK(suppressor.getStats().nPassedThrough == 2);
+
+    return ACC_TEST_RESULT();
+}